@@ -23,7 +23,8 @@ setup(
         "litex",
     ],
     package_data={
-        'iCE40_I2C_LiteX_integration.c_driver_library': ['*.c', '*.h'],
+        'iCE40_I2C_LiteX_integration.c_driver_library': ['*.c', '*.h', '*.hpp'],
+        'iCE40_I2C_LiteX_integration.sim': ['firmware/*'],
     },
     keywords="HDL ASIC FPGA hardware design LiteX I2C Lattice iCE40",
     classifiers=[
@@ -0,0 +1,88 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+
+/*
+ * 	Scenarios of the benchmark on the header-only C++ driver, driving the sb_i2c instance.
+ */
+
+#include <generated/csr.h>
+#include <generated/soc.h>
+#include "../ice40_i2c.hpp"
+
+using I2c = Ice40I2c<CSR_SB_I2C_BASE, CONFIG_CLOCK_FREQUENCY, kSB_I2C_CONFIG_TARGET_I2C_FREQUENCY>;
+
+static_assert(I2c::prescaler == I2C_BUS_PRESCALER(kSB_I2C_CONFIG_TARGET_I2C_FREQUENCY), "Prescaler of the C++ driver differs from the C driver");
+
+extern "C" I2C_STATUS_t
+bench_cpp_reg_write(uint8_t address, uint8_t reg, const uint8_t *data, size_t len)
+{
+	return I2c::reg_write(address, reg, data, len);
+}
+
+extern "C" I2C_STATUS_t
+bench_cpp_reg_read(uint8_t address, uint8_t reg, uint8_t *data, size_t len)
+{
+	return I2c::reg_read(address, reg, data, len);
+}
+
+extern "C" I2C_STATUS_t
+bench_cpp_write_buf(uint8_t address, const uint8_t *data, size_t len)
+{
+	return I2c::write_buf(address, data, len);
+}
+
+extern "C" I2C_STATUS_t
+bench_cpp_read_buf(uint8_t address, uint8_t *data, size_t len)
+{
+	return I2c::read_buf(address, data, len);
+}
+
+extern "C" bool
+bench_cpp_write(uint8_t address, uint8_t data)
+{
+	bool ack = I2c::begin(address, false) && I2c::write(data);
+
+	I2c::end();
+
+	return ack;
+}
+
+extern "C" bool
+bench_cpp_scan(uint8_t address)
+{
+	return I2c::scan(address);
+}
+
+extern "C" void
+bench_cpp_init(void)
+{
+	I2c::init();
+}
+
+extern "C" i2c_bus_t *
+bench_cpp_c_bus(void)
+{
+	return &I2c::c_bus();
+}
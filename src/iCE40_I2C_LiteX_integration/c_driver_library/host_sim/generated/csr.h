@@ -0,0 +1,194 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+/*
+ * 	Host simulation stand-in for the LiteX generated/csr.h of an ICE40UP_I2C instance named sb_i2c.
+ * 	The optional CSRs are enabled with -DSIM_WITH_SB_COMMAND, -DSIM_WITH_STATUS_MIRROR and
+ * 	-DSIM_WITH_BUS_RECOVERY, and the uptime of timer0 with -DSIM_WITH_TIMER_UPTIME.
+ */
+
+#ifndef __GENERATED_CSR_H
+#define __GENERATED_CSR_H
+
+#include <stdint.h>
+#include <generated/soc.h>
+#include <hw/common.h>
+
+#define CSR_BASE 0xf0000000L
+#define CSR_SB_I2C_BASE (CSR_BASE + 0x0L)
+
+#define CSR_SB_I2C_SBCTRL_ADDR (CSR_BASE + 0x0L)
+#define CSR_SB_I2C_SBCTRL_SIZE 1
+static inline uint32_t sb_i2c_sbctrl_read(void) {
+	return csr_read_simple(CSR_SB_I2C_SBCTRL_ADDR);
+}
+static inline void sb_i2c_sbctrl_write(uint32_t v) {
+	csr_write_simple(v, CSR_SB_I2C_SBCTRL_ADDR);
+}
+#define CSR_SB_I2C_SBCTRL_SBRWI_OFFSET 0
+#define CSR_SB_I2C_SBCTRL_SBRWI_SIZE 1
+#define CSR_SB_I2C_SBCTRL_SBSTBI_OFFSET 1
+#define CSR_SB_I2C_SBCTRL_SBSTBI_SIZE 1
+
+#define CSR_SB_I2C_SBSTATUS_ADDR (CSR_BASE + 0x4L)
+#define CSR_SB_I2C_SBSTATUS_SIZE 1
+static inline uint32_t sb_i2c_sbstatus_read(void) {
+	return csr_read_simple(CSR_SB_I2C_SBSTATUS_ADDR);
+}
+static inline void sb_i2c_sbstatus_write(uint32_t v) {
+	csr_write_simple(v, CSR_SB_I2C_SBSTATUS_ADDR);
+}
+#define CSR_SB_I2C_SBSTATUS_SBACKO_OFFSET 0
+#define CSR_SB_I2C_SBSTATUS_SBACKO_SIZE 1
+
+#define CSR_SB_I2C_SBADRI_ADDR (CSR_BASE + 0x8L)
+#define CSR_SB_I2C_SBADRI_SIZE 1
+static inline uint32_t sb_i2c_sbadri_read(void) {
+	return csr_read_simple(CSR_SB_I2C_SBADRI_ADDR);
+}
+static inline void sb_i2c_sbadri_write(uint32_t v) {
+	csr_write_simple(v, CSR_SB_I2C_SBADRI_ADDR);
+}
+
+#define CSR_SB_I2C_SBDATI_ADDR (CSR_BASE + 0xcL)
+#define CSR_SB_I2C_SBDATI_SIZE 1
+static inline uint32_t sb_i2c_sbdati_read(void) {
+	return csr_read_simple(CSR_SB_I2C_SBDATI_ADDR);
+}
+static inline void sb_i2c_sbdati_write(uint32_t v) {
+	csr_write_simple(v, CSR_SB_I2C_SBDATI_ADDR);
+}
+
+#define CSR_SB_I2C_SBDATO_ADDR (CSR_BASE + 0x10L)
+#define CSR_SB_I2C_SBDATO_SIZE 1
+static inline uint32_t sb_i2c_sbdato_read(void) {
+	return csr_read_simple(CSR_SB_I2C_SBDATO_ADDR);
+}
+static inline void sb_i2c_sbdato_write(uint32_t v) {
+	csr_write_simple(v, CSR_SB_I2C_SBDATO_ADDR);
+}
+
+#ifdef SIM_WITH_SB_COMMAND
+#define CSR_SB_I2C_SBCMD_ADDR (CSR_BASE + 0x14L)
+#define CSR_SB_I2C_SBCMD_SIZE 1
+static inline uint32_t sb_i2c_sbcmd_read(void) {
+	return csr_read_simple(CSR_SB_I2C_SBCMD_ADDR);
+}
+static inline void sb_i2c_sbcmd_write(uint32_t v) {
+	csr_write_simple(v, CSR_SB_I2C_SBCMD_ADDR);
+}
+#define CSR_SB_I2C_SBCMD_DATA_OFFSET 0
+#define CSR_SB_I2C_SBCMD_DATA_SIZE 8
+#define CSR_SB_I2C_SBCMD_ADDR_OFFSET 8
+#define CSR_SB_I2C_SBCMD_ADDR_SIZE 4
+#define CSR_SB_I2C_SBCMD_RW_OFFSET 12
+#define CSR_SB_I2C_SBCMD_RW_SIZE 1
+
+#define CSR_SB_I2C_SBCMD_STATUS_ADDR (CSR_BASE + 0x18L)
+#define CSR_SB_I2C_SBCMD_STATUS_SIZE 1
+static inline uint32_t sb_i2c_sbcmd_status_read(void) {
+	return csr_read_simple(CSR_SB_I2C_SBCMD_STATUS_ADDR);
+}
+static inline void sb_i2c_sbcmd_status_write(uint32_t v) {
+	csr_write_simple(v, CSR_SB_I2C_SBCMD_STATUS_ADDR);
+}
+#define CSR_SB_I2C_SBCMD_STATUS_DATA_OFFSET 0
+#define CSR_SB_I2C_SBCMD_STATUS_DATA_SIZE 8
+#define CSR_SB_I2C_SBCMD_STATUS_BUSY_OFFSET 8
+#define CSR_SB_I2C_SBCMD_STATUS_BUSY_SIZE 1
+#define CSR_SB_I2C_SBCMD_STATUS_FULL_OFFSET 9
+#define CSR_SB_I2C_SBCMD_STATUS_FULL_SIZE 1
+#endif
+
+#ifdef SIM_WITH_STATUS_MIRROR
+#define CSR_SB_I2C_SBMIRROR_ADDR (CSR_BASE + 0x1cL)
+#define CSR_SB_I2C_SBMIRROR_SIZE 1
+static inline uint32_t sb_i2c_sbmirror_read(void) {
+	return csr_read_simple(CSR_SB_I2C_SBMIRROR_ADDR);
+}
+static inline void sb_i2c_sbmirror_write(uint32_t v) {
+	csr_write_simple(v, CSR_SB_I2C_SBMIRROR_ADDR);
+}
+#define CSR_SB_I2C_SBMIRROR_I2CSR_OFFSET 0
+#define CSR_SB_I2C_SBMIRROR_I2CSR_SIZE 8
+#define CSR_SB_I2C_SBMIRROR_I2CIRQ_OFFSET 8
+#define CSR_SB_I2C_SBMIRROR_I2CIRQ_SIZE 8
+#define CSR_SB_I2C_SBMIRROR_VALID_OFFSET 16
+#define CSR_SB_I2C_SBMIRROR_VALID_SIZE 1
+#endif
+
+#ifdef SIM_WITH_BUS_RECOVERY
+#define CSR_SB_I2C_RECOVERY_CONTROL_ADDR (CSR_BASE + 0x20L)
+#define CSR_SB_I2C_RECOVERY_CONTROL_SIZE 1
+static inline uint32_t sb_i2c_recovery_control_read(void) {
+	return csr_read_simple(CSR_SB_I2C_RECOVERY_CONTROL_ADDR);
+}
+static inline void sb_i2c_recovery_control_write(uint32_t v) {
+	csr_write_simple(v, CSR_SB_I2C_RECOVERY_CONTROL_ADDR);
+}
+#define CSR_SB_I2C_RECOVERY_CONTROL_START_OFFSET 0
+#define CSR_SB_I2C_RECOVERY_CONTROL_START_SIZE 1
+#define CSR_SB_I2C_RECOVERY_CONTROL_HALF_PERIOD_OFFSET 1
+#define CSR_SB_I2C_RECOVERY_CONTROL_HALF_PERIOD_SIZE 16
+
+#define CSR_SB_I2C_RECOVERY_STATUS_ADDR (CSR_BASE + 0x24L)
+#define CSR_SB_I2C_RECOVERY_STATUS_SIZE 1
+static inline uint32_t sb_i2c_recovery_status_read(void) {
+	return csr_read_simple(CSR_SB_I2C_RECOVERY_STATUS_ADDR);
+}
+static inline void sb_i2c_recovery_status_write(uint32_t v) {
+	csr_write_simple(v, CSR_SB_I2C_RECOVERY_STATUS_ADDR);
+}
+#define CSR_SB_I2C_RECOVERY_STATUS_SCL_OFFSET 0
+#define CSR_SB_I2C_RECOVERY_STATUS_SCL_SIZE 1
+#define CSR_SB_I2C_RECOVERY_STATUS_SDA_OFFSET 1
+#define CSR_SB_I2C_RECOVERY_STATUS_SDA_SIZE 1
+#define CSR_SB_I2C_RECOVERY_STATUS_BUSY_OFFSET 2
+#define CSR_SB_I2C_RECOVERY_STATUS_BUSY_SIZE 1
+#define CSR_SB_I2C_RECOVERY_STATUS_PULSES_OFFSET 3
+#define CSR_SB_I2C_RECOVERY_STATUS_PULSES_SIZE 4
+#endif
+
+#ifdef SIM_WITH_TIMER_UPTIME
+#define CSR_TIMER0_BASE (CSR_BASE + 0x800L)
+
+#define CSR_TIMER0_UPTIME_LATCH_ADDR (CSR_BASE + 0x800L)
+#define CSR_TIMER0_UPTIME_LATCH_SIZE 1
+static inline uint32_t timer0_uptime_latch_read(void) {
+	return csr_read_simple(CSR_TIMER0_UPTIME_LATCH_ADDR);
+}
+static inline void timer0_uptime_latch_write(uint32_t v) {
+	csr_write_simple(v, CSR_TIMER0_UPTIME_LATCH_ADDR);
+}
+
+#define CSR_TIMER0_UPTIME_CYCLES_ADDR (CSR_BASE + 0x804L)
+#define CSR_TIMER0_UPTIME_CYCLES_SIZE 2
+static inline uint64_t timer0_uptime_cycles_read(void) {
+	uint64_t r = csr_read_simple(CSR_TIMER0_UPTIME_CYCLES_ADDR);
+	r <<= 32;
+	r |= csr_read_simple(CSR_TIMER0_UPTIME_CYCLES_ADDR + 4);
+	return r;
+}
+#endif
+
+#endif
@@ -0,0 +1,1097 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+/*
+ * 	Host benchmark of the C driver library, against the behavioral SB_I2C model.
+ *
+ * 	Each scenario reports the CSR and System Bus accesses per I2C byte, and the elapsed simulated
+ * 	time against the time the I2C bus was actually busy. The data read back is checked against the
+ * 	simulated devices, and the program exits with a non-zero status on a mismatch.
+ */
+
+#include <generated/csr.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "sb_i2c_model.h"
+#include "../i2c.h"
+#include "../i2c_async.h"
+#include "../i2c_sample.h"
+#include "../i2c_slave.h"
+#include "../sb_i2c.h"
+
+#define BENCH_EEPROM_ADDRESS	0x50
+#define BENCH_SENSOR_ADDRESS	0x48
+#define BENCH_NACK_ADDRESS	0x20
+#define BENCH_ABSENT_ADDRESS	0x30
+#define BENCH_SLAVE_ADDRESS	(0x40 | SIM_SLAVE_ADDRESS_LSB)
+
+/*
+ * 	Addresses of the remote master which win and lose arbitration against the I2C Hard IP
+ */
+#define BENCH_ARB_WIN_ADDRESS	0x08
+#define BENCH_ARB_LOSE_ADDRESS	0x7F
+
+/*
+ * 	SCL periods of the delay scenario
+ */
+#define BENCH_DELAY_PERIODS	100
+#define BENCH_LEN		16
+
+/*
+ * 	Bytes of the throughput scenarios, and the time in percent by which a buffered transfer may
+ * 	exceed the same transfer a byte per call, or the time the I2C bus was busy, as the simulated
+ * 	time is kept in whole ns per access
+ */
+#define BENCH_THROUGHPUT_LEN		128
+#define BENCH_THROUGHPUT_TOLERANCE	1
+
+/*
+ * 	System clock cycles of application work between two i2c_poll() calls
+ */
+#define BENCH_POLL_WORK_CYCLES	64
+
+/*
+ * 	System clock cycles of application work between two i2c_poll() calls of a slow consumer, which
+ * 	exceed the time of a byte on the I2C bus
+ */
+#define BENCH_STRETCH_WORK_CYCLES	4000
+
+/*
+ * 	Sampler ticks, and system clock cycles between two ticks
+ */
+#define BENCH_SAMPLE_TICKS		32
+#define BENCH_SAMPLE_TICK_CYCLES	4096
+
+static sim_device_t eeprom_dev;
+static sim_regfile_t eeprom;
+static sim_device_t sensor_dev;
+static sim_regfile_t sensor;
+static sim_device_t nack_dev;
+
+/*
+ * 	Scenarios on the C++ driver, in bench_cpp.cpp
+ */
+I2C_STATUS_t bench_cpp_reg_write(uint8_t address, uint8_t reg, const uint8_t *data, size_t len);
+I2C_STATUS_t bench_cpp_reg_read(uint8_t address, uint8_t reg, uint8_t *data, size_t len);
+I2C_STATUS_t bench_cpp_write_buf(uint8_t address, const uint8_t *data, size_t len);
+I2C_STATUS_t bench_cpp_read_buf(uint8_t address, uint8_t *data, size_t len);
+bool bench_cpp_write(uint8_t address, uint8_t data);
+bool bench_cpp_scan(uint8_t address);
+void bench_cpp_init(void);
+i2c_bus_t *bench_cpp_c_bus(void);
+
+static int failures = 0;
+static uint64_t start_ns;
+
+static void
+bench_setup(void)
+{
+	sim_reset();
+
+	sim_regfile_init(&eeprom_dev, &eeprom, BENCH_EEPROM_ADDRESS, true);
+	sim_regfile_init(&sensor_dev, &sensor, BENCH_SENSOR_ADDRESS, false);
+	sim_nack_init(&nack_dev, BENCH_NACK_ADDRESS);
+
+	for (size_t i = 0; i < sizeof(sensor.regs); i++)
+	{
+		sensor.regs[i] = i * 7 + 3;
+	}
+
+	sim_attach(&eeprom_dev);
+	sim_attach(&sensor_dev);
+	sim_attach(&nack_dev);
+
+	i2c_init();
+	sim_drain();
+}
+
+static void
+bench_begin(void)
+{
+	sim_drain();
+	sim_stats_clear();
+	start_ns = sim_stats.time_ns;
+}
+
+static void
+bench_report(const char *name, size_t payload)
+{
+	sim_drain();
+
+	double elapsed_us = (sim_stats.time_ns - start_ns) / 1000.0;
+	double bus_us = sim_stats.bus_ns / 1000.0;
+
+	printf("%-28s %8.1f %8.1f %8.1f %9.1f %9.1f %6.0f%%\n",
+		name,
+		(double)(sim_stats.csr_reads + sim_stats.csr_writes) / payload,
+		(double)(sim_stats.sb_reads + sim_stats.sb_writes) / payload,
+		(double)sim_stats.bytes / payload,
+		elapsed_us,
+		bus_us,
+		elapsed_us > 0 ? 100.0 * bus_us / elapsed_us : 0.0
+	);
+
+	if (sim_stats.overruns != 0)
+	{
+		printf("  FAIL: %llu receive overruns\n", (unsigned long long)sim_stats.overruns);
+		failures++;
+	}
+}
+
+static void
+bench_check(const char *name, const uint8_t *data, const uint8_t *expected, size_t len)
+{
+	if (memcmp(data, expected, len) != 0)
+	{
+		printf("  FAIL: %s data mismatch\n", name);
+		failures++;
+	}
+}
+
+static void
+bench_status(const char *name, I2C_STATUS_t status, I2C_STATUS_t expected)
+{
+	if (status != expected)
+	{
+		printf("  FAIL: %s status %d, expected %d\n", name, status, expected);
+		failures++;
+	}
+}
+
+static void
+bench_write(void)
+{
+	uint8_t data[BENCH_LEN];
+
+	for (size_t i = 0; i < BENCH_LEN; i++)
+	{
+		data[i] = 0xA0 + i;
+	}
+
+	memset(eeprom.regs, 0, sizeof(eeprom.regs));
+	bench_begin();
+	i2c_begin(BENCH_EEPROM_ADDRESS, false);
+	i2c_write(0x10);
+	for (size_t i = 0; i < BENCH_LEN; i++)
+	{
+		i2c_write(data[i]);
+	}
+	bench_status("i2c_end()", i2c_end(), kI2C_STATUS_OK);
+	bench_report("write: i2c_write()", BENCH_LEN);
+	bench_check("i2c_write()", &eeprom.regs[0x10], data, BENCH_LEN);
+
+	memset(eeprom.regs, 0, sizeof(eeprom.regs));
+	bench_begin();
+	bench_status("i2c_reg_write()", i2c_reg_write(BENCH_EEPROM_ADDRESS, 0x10, data, BENCH_LEN), kI2C_STATUS_OK);
+	bench_report("write: i2c_reg_write()", BENCH_LEN);
+	bench_check("i2c_reg_write()", &eeprom.regs[0x10], data, BENCH_LEN);
+
+	memset(eeprom.regs, 0, sizeof(eeprom.regs));
+	bench_begin();
+	bench_status("Ice40I2c::reg_write()", bench_cpp_reg_write(BENCH_EEPROM_ADDRESS, 0x10, data, BENCH_LEN), kI2C_STATUS_OK);
+	bench_report("write: Ice40I2c::reg_write()", BENCH_LEN);
+	bench_check("Ice40I2c::reg_write()", &eeprom.regs[0x10], data, BENCH_LEN);
+}
+
+static void
+bench_read(void)
+{
+	uint8_t data[BENCH_LEN];
+
+	memset(data, 0, sizeof(data));
+	bench_begin();
+	i2c_begin(BENCH_SENSOR_ADDRESS, false);
+	i2c_write(0x20);
+	i2c_restart(BENCH_SENSOR_ADDRESS, true);
+	for (size_t i = 0; i < BENCH_LEN; i++)
+	{
+		data[i] = i2c_read(i + 1 == BENCH_LEN);
+	}
+	i2c_end();
+	bench_report("read: i2c_read()", BENCH_LEN);
+	bench_check("i2c_read()", data, &sensor.regs[0x20], BENCH_LEN);
+
+	memset(data, 0, sizeof(data));
+	bench_begin();
+	bench_status("i2c_reg_read()", i2c_reg_read(BENCH_SENSOR_ADDRESS, 0x20, data, BENCH_LEN), kI2C_STATUS_OK);
+	bench_report("read: i2c_reg_read()", BENCH_LEN);
+	bench_check("i2c_reg_read()", data, &sensor.regs[0x20], BENCH_LEN);
+
+	memset(data, 0, sizeof(data));
+	bench_begin();
+	bench_status("Ice40I2c::reg_read()", bench_cpp_reg_read(BENCH_SENSOR_ADDRESS, 0x20, data, BENCH_LEN), kI2C_STATUS_OK);
+	bench_report("read: Ice40I2c::reg_read()", BENCH_LEN);
+	bench_check("Ice40I2c::reg_read()", data, &sensor.regs[0x20], BENCH_LEN);
+
+	/*
+	 * 	The C API on the I2C bus of the C++ driver, a single one with the defaults of I2C_BUS_INIT()
+	 */
+	i2c_bus_t *bus = bench_cpp_c_bus();
+
+	if (bus != bench_cpp_c_bus() || bus->arb_retries != kSB_I2C_CONFIG_ARB_RETRIES)
+	{
+		printf("  FAIL: Ice40I2c::c_bus() is not a single I2C_BUS_INIT() bus\n");
+		failures++;
+	}
+
+	memset(data, 0, sizeof(data));
+	bench_begin();
+	bench_status("i2c_bus_reg_read() c_bus()", i2c_bus_reg_read(bus, BENCH_SENSOR_ADDRESS, 0x20, data, BENCH_LEN), kI2C_STATUS_OK);
+	bench_report("read: Ice40I2c::c_bus()", BENCH_LEN);
+	bench_check("i2c_bus_reg_read() c_bus()", data, &sensor.regs[0x20], BENCH_LEN);
+
+	/*
+	 * 	Ice40I2c::init() rewrites the prescaler at its own speed, which the C driver writes back
+	 * 	at its next call
+	 */
+	i2c_bus_set_speed(bus, kSB_I2C_CONFIG_TARGET_I2C_FREQUENCY / 2);
+	bench_cpp_init();
+	bench_status("i2c_bus_reg_read() after Ice40I2c::init()", i2c_bus_reg_read(bus, BENCH_SENSOR_ADDRESS, 0x20, data, 1), kI2C_STATUS_OK);
+	if (sb_i2c_get_register(bus, kSB_I2C_REGS_I2CBRLSB) != (bus->prescaler & 0xFF))
+	{
+		printf("  FAIL: c_bus() prescaler not written after Ice40I2c::init()\n");
+		failures++;
+	}
+	i2c_bus_set_speed(bus, kSB_I2C_CONFIG_TARGET_I2C_FREQUENCY);
+
+	memset(data, 0, sizeof(data));
+	bench_begin();
+	i2c_reg_read(BENCH_SENSOR_ADDRESS, 0x40, data, 1);
+	bench_report("read: i2c_reg_read() x1", 1);
+	bench_check("i2c_reg_read() x1", data, &sensor.regs[0x40], 1);
+
+	/*
+	 * 	Two register reads in one transaction, the first split in two messages
+	 */
+	uint8_t regs[2] = {0x20, 0x40};
+	uint8_t last = 0;
+	struct i2c_msg msgs[] = {
+		{.addr = BENCH_SENSOR_ADDRESS, .flags = 0, .len = 1, .buf = &regs[0]},
+		{.addr = BENCH_SENSOR_ADDRESS, .flags = I2C_M_RD, .len = BENCH_LEN / 2, .buf = data},
+		{.addr = BENCH_SENSOR_ADDRESS, .flags = I2C_M_RD | I2C_M_NOSTART, .len = BENCH_LEN - BENCH_LEN / 2, .buf = &data[BENCH_LEN / 2]},
+		{.addr = BENCH_SENSOR_ADDRESS, .flags = 0, .len = 1, .buf = &regs[1]},
+		{.addr = BENCH_SENSOR_ADDRESS, .flags = I2C_M_RD, .len = 1, .buf = &last},
+	};
+
+	memset(data, 0, sizeof(data));
+	bench_begin();
+	int result = i2c_transfer(msgs, sizeof(msgs) / sizeof(msgs[0]));
+	bench_report("read: i2c_transfer()", BENCH_LEN + 1);
+
+	if (result != (int)(sizeof(msgs) / sizeof(msgs[0])))
+	{
+		printf("  FAIL: i2c_transfer() result %d\n", result);
+		failures++;
+	}
+	bench_check("i2c_transfer()", data, &sensor.regs[0x20], BENCH_LEN);
+	bench_check("i2c_transfer()", &last, &sensor.regs[0x40], 1);
+
+	/*
+	 * 	The sensor at Fast-mode Plus, next to the EEPROM at the default speed
+	 */
+	uint32_t frequency = i2c_set_device_speed(BENCH_SENSOR_ADDRESS, 1000000);
+
+	memset(data, 0, sizeof(data));
+	bench_begin();
+	i2c_reg_read(BENCH_SENSOR_ADDRESS, 0x20, data, BENCH_LEN);
+	bench_report("read: i2c_reg_read() Fm+", BENCH_LEN);
+	bench_check("i2c_reg_read() Fm+", data, &sensor.regs[0x20], BENCH_LEN);
+
+	i2c_set_device_speed(BENCH_SENSOR_ADDRESS, 0);
+
+	if (frequency != 1000000)
+	{
+		printf("  FAIL: i2c_set_device_speed() achieved %u Hz\n", (unsigned)frequency);
+		failures++;
+	}
+
+	/*
+	 * 	A frequency below that of the largest prescaler can not be reached, and is rejected
+	 */
+	uint32_t lowest = (CONFIG_CLOCK_FREQUENCY + 4095) / 4096;
+
+	if (i2c_set_speed(0) != 0 || i2c_set_speed(lowest - 1) != 0 || i2c_set_device_speed(BENCH_SENSOR_ADDRESS, lowest - 1) != 0)
+	{
+		printf("  FAIL: i2c_set_speed() accepted a frequency below %u Hz\n", (unsigned)lowest);
+		failures++;
+	}
+
+	frequency = i2c_set_speed(lowest);
+	i2c_set_speed(kSB_I2C_CONFIG_TARGET_I2C_FREQUENCY);
+
+	if (frequency == 0 || frequency > lowest)
+	{
+		printf("  FAIL: i2c_set_speed() lowest achieved %u Hz\n", (unsigned)frequency);
+		failures++;
+	}
+}
+
+/**
+ * 	@brief Gets the simulated time since bench_begin(), in ns.
+ */
+static uint64_t
+bench_elapsed_ns(void)
+{
+	return sim_stats.time_ns - start_ns;
+}
+
+/**
+ * 	@brief Checks that the I2C bus was busy for the whole of a transfer since bench_begin(), that
+ * 	is that the bytes went out back-to-back.
+ *
+ * 	@param name is the name of the transfer.
+ * 	@param elapsed_ns is the elapsed time of the transfer, in ns.
+ */
+static void
+bench_back_to_back(const char *name, uint64_t elapsed_ns)
+{
+	if (100 * sim_stats.bus_ns < (100 - BENCH_THROUGHPUT_TOLERANCE) * elapsed_ns)
+	{
+		printf("  FAIL: %s left the I2C bus idle between bytes\n", name);
+		failures++;
+	}
+}
+
+static void
+bench_throughput(void)
+{
+	static uint8_t data[1 + BENCH_THROUGHPUT_LEN];
+	uint8_t pointer = 0x00;
+	uint64_t byte_ns;
+	uint64_t buf_ns;
+
+	/*
+	 * 	At Fast-mode Plus, so the bus time does not hide the time spent by the CPU between bytes
+	 */
+	i2c_set_device_speed(BENCH_EEPROM_ADDRESS, 1000000);
+
+	/*
+	 * 	Writes of a long buffer, a byte per call against i2c_write_buf()
+	 */
+	data[0] = 0x00;
+	for (size_t i = 1; i < sizeof(data); i++)
+	{
+		data[i] = i * 5 + 1;
+	}
+
+	memset(eeprom.regs, 0, sizeof(eeprom.regs));
+	bench_begin();
+	i2c_begin(BENCH_EEPROM_ADDRESS, false);
+	for (size_t i = 0; i < sizeof(data); i++)
+	{
+		i2c_write(data[i]);
+	}
+	bench_status("throughput i2c_end()", i2c_end(), kI2C_STATUS_OK);
+	bench_report("throughput: i2c_write()", sizeof(data));
+	byte_ns = bench_elapsed_ns();
+	bench_check("throughput i2c_write()", eeprom.regs, &data[1], BENCH_THROUGHPUT_LEN);
+
+	memset(eeprom.regs, 0, sizeof(eeprom.regs));
+	bench_begin();
+	bench_status("throughput i2c_write_buf()", i2c_write_buf(BENCH_EEPROM_ADDRESS, data, sizeof(data)), kI2C_STATUS_OK);
+	bench_report("throughput: i2c_write_buf()", sizeof(data));
+	buf_ns = bench_elapsed_ns();
+	bench_check("throughput i2c_write_buf()", eeprom.regs, &data[1], BENCH_THROUGHPUT_LEN);
+	bench_back_to_back("i2c_write_buf()", buf_ns);
+
+	printf("  write %.1f kB/s per byte, %.1f kB/s buffered\n",
+		1e6 * sizeof(data) / byte_ns, 1e6 * sizeof(data) / buf_ns);
+	if (100 * buf_ns > (100 + BENCH_THROUGHPUT_TOLERANCE) * byte_ns)
+	{
+		printf("  FAIL: i2c_write_buf() slower than i2c_write()\n");
+		failures++;
+	}
+
+	/*
+	 * 	Reads of a long buffer, from the first register
+	 */
+	i2c_write_buf(BENCH_EEPROM_ADDRESS, &pointer, 1);
+	memset(data, 0, sizeof(data));
+	bench_begin();
+	i2c_begin(BENCH_EEPROM_ADDRESS, true);
+	for (size_t i = 0; i < BENCH_THROUGHPUT_LEN; i++)
+	{
+		data[i] = i2c_read(i + 1 == BENCH_THROUGHPUT_LEN);
+	}
+	i2c_end();
+	bench_report("throughput: i2c_read()", BENCH_THROUGHPUT_LEN);
+	byte_ns = bench_elapsed_ns();
+	bench_check("throughput i2c_read()", data, eeprom.regs, BENCH_THROUGHPUT_LEN);
+
+	i2c_write_buf(BENCH_EEPROM_ADDRESS, &pointer, 1);
+	memset(data, 0, sizeof(data));
+	bench_begin();
+	bench_status("throughput i2c_read_buf()", i2c_read_buf(BENCH_EEPROM_ADDRESS, data, BENCH_THROUGHPUT_LEN), kI2C_STATUS_OK);
+	bench_report("throughput: i2c_read_buf()", BENCH_THROUGHPUT_LEN);
+	buf_ns = bench_elapsed_ns();
+	bench_check("throughput i2c_read_buf()", data, eeprom.regs, BENCH_THROUGHPUT_LEN);
+	bench_back_to_back("i2c_read_buf()", buf_ns);
+
+	printf("  read %.1f kB/s per byte, %.1f kB/s buffered\n",
+		1e6 * BENCH_THROUGHPUT_LEN / byte_ns, 1e6 * BENCH_THROUGHPUT_LEN / buf_ns);
+	if (100 * buf_ns > (100 + BENCH_THROUGHPUT_TOLERANCE) * byte_ns)
+	{
+		printf("  FAIL: i2c_read_buf() slower than i2c_read()\n");
+		failures++;
+	}
+
+	i2c_set_device_speed(BENCH_EEPROM_ADDRESS, 0);
+}
+
+static void
+bench_scan(void)
+{
+	size_t found = 0;
+	size_t count = 0;
+
+	bench_begin();
+	for (uint8_t address = 0x08; address < 0x78; address++)
+	{
+		found += i2c_scan(address);
+		count++;
+	}
+	bench_report("scan: i2c_scan()", count);
+
+	if (found != 3)
+	{
+		printf("  FAIL: %zu devices found, expected 3\n", found);
+		failures++;
+	}
+
+	found = 0;
+	count = 0;
+	bench_begin();
+	for (uint8_t address = 0x08; address < 0x78; address++)
+	{
+		found += bench_cpp_scan(address);
+		count++;
+	}
+	bench_report("scan: Ice40I2c::scan()", count);
+
+	if (found != 3)
+	{
+		printf("  FAIL: %zu devices found with Ice40I2c::scan(), expected 3\n", found);
+		failures++;
+	}
+
+	/*
+	 * 	The address-only probes of i2c_scan_all() do not move the register pointer of the EEPROM
+	 */
+	uint8_t bitmap[16];
+	uint8_t expected[16] = {0};
+
+	expected[BENCH_EEPROM_ADDRESS >> 3] |= 1 << (BENCH_EEPROM_ADDRESS & 7);
+	expected[BENCH_SENSOR_ADDRESS >> 3] |= 1 << (BENCH_SENSOR_ADDRESS & 7);
+	expected[BENCH_NACK_ADDRESS >> 3] |= 1 << (BENCH_NACK_ADDRESS & 7);
+	eeprom.pointer = 0x5A;
+
+	bench_begin();
+	bench_status("i2c_scan_all()", i2c_scan_all(bitmap), kI2C_STATUS_OK);
+	bench_report("scan: i2c_scan_all()", 0x78 - 0x08);
+	bench_check("i2c_scan_all()", bitmap, expected, sizeof(bitmap));
+
+	if (eeprom.pointer != 0x5A)
+	{
+		printf("  FAIL: i2c_scan_all() wrote to the EEPROM\n");
+		failures++;
+	}
+}
+
+static void
+bench_errors(void)
+{
+	uint8_t data[4] = {0x01, 0x02, 0x03, 0x04};
+	struct i2c_msg msg = {.addr = BENCH_NACK_ADDRESS, .flags = 0, .len = sizeof(data), .buf = data};
+
+	/*
+	 * 	The NACK of a slave address
+	 */
+	bench_begin();
+	bench_status("i2c_write_buf() absent", i2c_write_buf(BENCH_ABSENT_ADDRESS, data, 1), kI2C_STATUS_NACK);
+	bench_report("error: i2c_write_buf()", 1);
+
+	/*
+	 * 	A read command to an absent slave ends with its address phase, without the receiving mode
+	 */
+	bench_begin();
+	bench_status("i2c_read_buf() absent", i2c_read_buf(BENCH_ABSENT_ADDRESS, data, sizeof(data)), kI2C_STATUS_NACK);
+	bench_report("error: i2c_read_buf()", sizeof(data));
+
+	/*
+	 * 	The NACK of data bytes, of the last one and of the register before a repeated START
+	 */
+	bench_status("i2c_write_buf() NACK", i2c_write_buf(BENCH_NACK_ADDRESS, data, sizeof(data)), kI2C_STATUS_NACK);
+	bench_status("i2c_write_buf() NACK x1", i2c_write_buf(BENCH_NACK_ADDRESS, data, 1), kI2C_STATUS_NACK);
+	bench_status("i2c_reg_read() NACK", i2c_reg_read(BENCH_NACK_ADDRESS, 0x00, data, 1), kI2C_STATUS_NACK);
+	bench_status("i2c_status()", i2c_status(), kI2C_STATUS_NACK);
+
+	int result = i2c_transfer(&msg, 1);
+
+	if (result != -kI2C_STATUS_NACK)
+	{
+		printf("  FAIL: i2c_transfer() NACK result %d\n", result);
+		failures++;
+	}
+
+	msg.flags = I2C_M_IGNORE_NAK;
+	result = i2c_transfer(&msg, 1);
+
+	if (result != 1)
+	{
+		printf("  FAIL: i2c_transfer() I2C_M_IGNORE_NAK result %d\n", result);
+		failures++;
+	}
+
+	/*
+	 * 	An empty read message is rejected, without holding the I2C bus
+	 */
+	msg.addr = BENCH_SENSOR_ADDRESS;
+	msg.flags = I2C_M_RD;
+	msg.len = 0;
+	result = i2c_transfer(&msg, 1);
+
+	if (result != -kI2C_STATUS_INVALID)
+	{
+		printf("  FAIL: i2c_transfer() empty read result %d\n", result);
+		failures++;
+	}
+
+	/*
+	 * 	No message does not touch the I2C Hard IP, so no STOP is sent on the idle I2C bus
+	 */
+	sim_stats_clear();
+	result = i2c_transfer(&msg, 0);
+
+	if (result != 0 || sim_stats.sb_reads + sim_stats.sb_writes != 0)
+	{
+		printf("  FAIL: i2c_transfer() no message result %d, %llu System Bus accesses\n", result,
+			(unsigned long long)(sim_stats.sb_reads + sim_stats.sb_writes));
+		failures++;
+	}
+
+	/*
+	 * 	The I2C bus is usable after the errors
+	 */
+	/*
+	 * 	The errors of the C++ driver, of a data byte and of the slave address
+	 */
+	bench_status("Ice40I2c::write_buf() NACK", bench_cpp_write_buf(BENCH_NACK_ADDRESS, data, sizeof(data)), kI2C_STATUS_NACK);
+	bench_status("Ice40I2c::write_buf() NACK x1", bench_cpp_write_buf(BENCH_NACK_ADDRESS, data, 1), kI2C_STATUS_NACK);
+	bench_status("Ice40I2c::reg_read() absent", bench_cpp_reg_read(BENCH_ABSENT_ADDRESS, 0x00, data, 1), kI2C_STATUS_NACK);
+	bench_status("Ice40I2c::read_buf() absent", bench_cpp_read_buf(BENCH_ABSENT_ADDRESS, data, sizeof(data)), kI2C_STATUS_NACK);
+	if (bench_cpp_write(BENCH_NACK_ADDRESS, 0x00))
+	{
+		printf("  FAIL: Ice40I2c::write() NACK returned true\n");
+		failures++;
+	}
+
+	bench_status("i2c_reg_read() after errors", i2c_reg_read(BENCH_SENSOR_ADDRESS, 0x20, data, sizeof(data)), kI2C_STATUS_OK);
+	bench_check("i2c_reg_read() after errors", data, &sensor.regs[0x20], sizeof(data));
+}
+
+#ifdef CSR_SB_I2C_RECOVERY_CONTROL_ADDR
+static void
+bench_recover(void)
+{
+	uint8_t data[4];
+
+	/*
+	 * 	A slave holding SDA low stalls a transaction, whose timeout runs the bus recovery
+	 */
+	sim_hold_sda(5);
+	bench_status("i2c_reg_read() SDA held", i2c_reg_read(BENCH_SENSOR_ADDRESS, 0x20, data, sizeof(data)), kI2C_STATUS_TIMEOUT);
+	bench_status("i2c_reg_read() after timeout", i2c_reg_read(BENCH_SENSOR_ADDRESS, 0x20, data, sizeof(data)), kI2C_STATUS_OK);
+	bench_check("i2c_reg_read() after timeout", data, &sensor.regs[0x20], sizeof(data));
+
+	sim_hold_sda(8);
+	bench_begin();
+	bench_status("i2c_recover()", i2c_recover(), kI2C_STATUS_OK);
+	bench_report("recover: i2c_recover()", 1);
+
+	/*
+	 * 	A slave which still holds SDA after 9 SCL pulses
+	 */
+	sim_hold_sda(12);
+	bench_status("i2c_recover() SDA held", i2c_recover(), kI2C_STATUS_TIMEOUT);
+	bench_status("i2c_recover() again", i2c_recover(), kI2C_STATUS_OK);
+	bench_status("i2c_reg_read() after recovery", i2c_reg_read(BENCH_SENSOR_ADDRESS, 0x20, data, sizeof(data)), kI2C_STATUS_OK);
+}
+#endif
+
+/**
+ * 	@brief Runs a transfer with i2c_poll(), and checks its result.
+ *
+ * 	@param name is the name of the check.
+ * 	@param xfer is the transfer.
+ * 	@param expected is the expected result.
+ */
+static void
+bench_poll_result(const char *name, i2c_xfer_t *xfer, I2C_ASYNC_RESULT_t expected)
+{
+	i2c_poll_start(xfer);
+	while (i2c_poll());
+
+	bench_status(name, (I2C_STATUS_t)xfer->result, (I2C_STATUS_t)expected);
+}
+
+static void
+bench_poll(void)
+{
+	uint8_t reg = 0x30;
+	uint8_t data[BENCH_LEN];
+	i2c_xfer_t xfer = {
+		.address = BENCH_SENSOR_ADDRESS,
+		.wr      = &reg,
+		.wr_len  = 1,
+		.rd      = data,
+		.rd_len  = BENCH_LEN,
+	};
+
+	memset(data, 0, sizeof(data));
+	bench_begin();
+	i2c_poll_start(&xfer);
+	while (i2c_poll())
+	{
+		sim_delay_cycles(BENCH_POLL_WORK_CYCLES);
+	}
+	bench_report("read: i2c_poll()", BENCH_LEN);
+
+	if (xfer.result != kI2C_ASYNC_RESULT_OK)
+	{
+		printf("  FAIL: i2c_poll() result %d\n", xfer.result);
+		failures++;
+	}
+	bench_check("i2c_poll()", data, &sensor.regs[0x30], BENCH_LEN);
+
+	/*
+	 * 	The NACK of a read command address, and of the last byte written, before the STOP and
+	 * 	before the repeated START
+	 */
+	xfer.address = BENCH_ABSENT_ADDRESS;
+	xfer.wr_len = 0;
+	bench_poll_result("i2c_poll() absent", &xfer, kI2C_ASYNC_RESULT_NACK);
+
+	xfer.address = BENCH_NACK_ADDRESS;
+	xfer.wr_len = 1;
+	xfer.rd_len = 0;
+	bench_poll_result("i2c_poll() NACK", &xfer, kI2C_ASYNC_RESULT_NACK);
+
+	xfer.rd_len = BENCH_LEN;
+	bench_poll_result("i2c_poll() NACK before read", &xfer, kI2C_ASYNC_RESULT_NACK);
+}
+
+/**
+ * 	@brief Reads a register of the sensor with i2c_poll(), with BENCH_STRETCH_WORK_CYCLES between
+ * 	the calls.
+ */
+static I2C_ASYNC_RESULT_t
+bench_stretch_read(uint8_t *data)
+{
+	uint8_t reg = 0x30;
+	i2c_xfer_t xfer = {
+		.address = BENCH_SENSOR_ADDRESS,
+		.wr      = &reg,
+		.wr_len  = 1,
+		.rd      = data,
+		.rd_len  = BENCH_LEN,
+	};
+
+	memset(data, 0, BENCH_LEN);
+	i2c_poll_start(&xfer);
+	while (i2c_poll())
+	{
+		sim_delay_cycles(BENCH_STRETCH_WORK_CYCLES);
+	}
+
+	return xfer.result;
+}
+
+static void
+bench_stretch(void)
+{
+	uint8_t data[BENCH_LEN];
+
+	if (!i2c_set_device_stretch(BENCH_SENSOR_ADDRESS, kI2C_STRETCH_AUTO))
+	{
+		printf("  FAIL: i2c_set_device_stretch()\n");
+		failures++;
+	}
+
+	/*
+	 * 	Without clock stretching, the slow consumer loses received bytes, which turns it on
+	 */
+	bench_begin();
+	bench_status("i2c_poll() without stretching", (I2C_STATUS_t)bench_stretch_read(data), kI2C_STATUS_OVERRUN);
+	if (i2c_device_overruns(BENCH_SENSOR_ADDRESS) != 1)
+	{
+		printf("  FAIL: %u device overruns, expected 1\n", (unsigned)i2c_device_overruns(BENCH_SENSOR_ADDRESS));
+		failures++;
+	}
+
+	bench_begin();
+	bench_status("i2c_poll() with stretching", (I2C_STATUS_t)bench_stretch_read(data), kI2C_STATUS_OK);
+	bench_report("read: stretched i2c_poll()", BENCH_LEN);
+	bench_check("stretched i2c_poll()", data, &sensor.regs[0x30], BENCH_LEN);
+
+	if (i2c_device_overruns(BENCH_SENSOR_ADDRESS) != 1)
+	{
+		printf("  FAIL: %u device overruns, expected 1\n", (unsigned)i2c_device_overruns(BENCH_SENSOR_ADDRESS));
+		failures++;
+	}
+
+	i2c_set_device_speed(BENCH_SENSOR_ADDRESS, 0);
+}
+
+static void
+bench_sample(void)
+{
+	static i2c_sample_entry_t entries[] = {
+		{.address = BENCH_SENSOR_ADDRESS, .reg = 0x40, .len = 4, .period = 1},
+		{.address = BENCH_SENSOR_ADDRESS, .reg = 0x48, .len = 2, .period = 4},
+	};
+	static i2c_sample_t ring[64];
+	i2c_sample_t samples[16];
+	i2c_sampler_t sampler;
+	size_t count[2] = {0, 0};
+	size_t bytes = 0;
+
+	/*
+	 * 	The same reads, by hand
+	 */
+	bench_begin();
+	for (unsigned tick = 0; tick < BENCH_SAMPLE_TICKS; tick++)
+	{
+		for (size_t e = 0; e < 2; e++)
+		{
+			uint8_t data[kI2C_SAMPLE_CONFIG_MAX_LEN];
+
+			if (tick % entries[e].period != 0)
+			{
+				continue;
+			}
+
+			i2c_begin(entries[e].address, false);
+			i2c_write(entries[e].reg);
+			i2c_restart(entries[e].address, true);
+			for (unsigned i = 0; i < entries[e].len; i++)
+			{
+				data[i] = i2c_read(i + 1 == entries[e].len);
+			}
+			i2c_end();
+			bench_check("i2c_read() sample", data, &sensor.regs[entries[e].reg], entries[e].len);
+			bytes += entries[e].len;
+		}
+		sim_delay_cycles(BENCH_SAMPLE_TICK_CYCLES);
+	}
+	bench_report("sample: i2c_read()", bytes);
+
+	bytes = 0;
+	i2c_sampler_init(&sampler, &i2c_bus_default, entries, 2, ring, sizeof(ring) / sizeof(ring[0]));
+
+	bench_begin();
+	for (unsigned tick = 0; tick < BENCH_SAMPLE_TICKS; tick++)
+	{
+		i2c_sampler_tick(&sampler);
+		sim_delay_cycles(BENCH_SAMPLE_TICK_CYCLES);
+	}
+
+	for (size_t n; (n = i2c_sampler_read(&sampler, samples, sizeof(samples) / sizeof(samples[0]))) > 0;)
+	{
+		for (size_t i = 0; i < n; i++)
+		{
+			i2c_sample_entry_t *entry = &entries[samples[i].entry];
+
+			bench_status("i2c_sampler_tick()", samples[i].status, kI2C_STATUS_OK);
+			bench_check("i2c_sampler_tick()", samples[i].data, &sensor.regs[entry->reg], entry->len);
+			count[samples[i].entry]++;
+			bytes += samples[i].len;
+		}
+	}
+	bench_report("sample: i2c_sampler_tick()", bytes);
+
+	if (count[0] != BENCH_SAMPLE_TICKS || count[1] != BENCH_SAMPLE_TICKS / 4 || i2c_sampler_dropped(&sampler) != 0)
+	{
+		printf("  FAIL: %zu and %zu samples, %u dropped\n", count[0], count[1], (unsigned)i2c_sampler_dropped(&sampler));
+		failures++;
+	}
+
+	/*
+	 * 	A tick which interrupts the blocking API before its START is held off, although the I2C
+	 * 	bus is not busy yet
+	 */
+	i2c_bus_default.owned = true;
+	i2c_sampler_tick(&sampler);
+	i2c_bus_default.owned = false;
+
+	if (i2c_sampler_read(&sampler, samples, sizeof(samples) / sizeof(samples[0])) != 0)
+	{
+		printf("  FAIL: i2c_sampler_tick() read an owned I2C bus\n");
+		failures++;
+	}
+}
+
+static void
+bench_shadow(void)
+{
+	uint32_t skipped = i2c_skipped_writes();
+
+	/*
+	 * 	A polling loop, which reads the same System Bus register in the same direction
+	 */
+	bench_begin();
+	for (unsigned i = 0; i < BENCH_LEN; i++)
+	{
+		sb_i2c_get_status(&i2c_bus_default);
+	}
+	bench_report("status: sb_i2c_get_status()", BENCH_LEN);
+
+	/*
+	 * 	Reinitializes the I2C core, at the prescaler it already has
+	 */
+	bench_begin();
+	i2c_init();
+	bench_report("init: i2c_init()", 1);
+
+	printf("%-28s %8lu\n", "skipped writes", (unsigned long)(i2c_skipped_writes() - skipped));
+}
+
+/**
+ * 	@brief Runs the transaction of the remote master, and services the slave whenever the SB_I2C
+ * 	interrupt is asserted, with BENCH_POLL_WORK_CYCLES of application work in between.
+ */
+static void
+bench_slave_run(void)
+{
+	while (sim_host_busy())
+	{
+		if (sim_irq_pending())
+		{
+			i2c_slave_isr();
+		}
+		else
+		{
+			sim_delay_cycles(BENCH_POLL_WORK_CYCLES);
+		}
+	}
+}
+
+static void
+bench_slave(void)
+{
+	uint8_t rx_ring[32];
+	uint8_t tx_ring[32];
+	uint8_t wr[BENCH_LEN + 4];
+	uint8_t data[BENCH_LEN + 4];
+	uint8_t command = 0x06;
+	i2c_slave_t slave = {
+		.address      = BENCH_SLAVE_ADDRESS,
+		.general_call = true,
+		.rx_ring      = rx_ring,
+		.rx_size      = sizeof(rx_ring),
+		.tx_ring      = tx_ring,
+		.tx_size      = sizeof(tx_ring),
+	};
+
+	for (size_t i = 0; i < sizeof(wr); i++)
+	{
+		wr[i] = 0x5A ^ (i * 13);
+	}
+
+	i2c_slave_init(&slave);
+
+	memset(data, 0, sizeof(data));
+	bench_begin();
+	sim_host_transfer(BENCH_SLAVE_ADDRESS, wr, BENCH_LEN, NULL, 0);
+	bench_slave_run();
+	bench_report("slave: host write", BENCH_LEN);
+	if (i2c_slave_read(&slave, data, sizeof(data)) != BENCH_LEN)
+	{
+		printf("  FAIL: i2c_slave_read() length\n");
+		failures++;
+	}
+	bench_check("i2c_slave_read()", data, wr, BENCH_LEN);
+
+	/*
+	 * 	The byte loaded after the last one read by the host stays queued for the next read
+	 */
+	i2c_slave_write(&slave, wr, sizeof(wr));
+	memset(data, 0, sizeof(data));
+	bench_begin();
+	sim_host_transfer(BENCH_SLAVE_ADDRESS, NULL, 0, data, BENCH_LEN);
+	bench_slave_run();
+	bench_report("slave: host read", BENCH_LEN);
+	sim_host_transfer(BENCH_SLAVE_ADDRESS, NULL, 0, &data[BENCH_LEN], 4);
+	bench_slave_run();
+	bench_check("i2c_slave_write()", data, wr, sizeof(wr));
+
+	sim_host_transfer(0x00, &command, 1, NULL, 0);
+	bench_slave_run();
+	if (slave.gc_count != 1 || slave.gc_data != command || slave.rx_dropped != 0 || slave.tx_underruns != 0)
+	{
+		printf("  FAIL: %u general calls (0x%02x), %u dropped, %u underruns\n",
+			(unsigned)slave.gc_count,
+			slave.gc_data,
+			(unsigned)slave.rx_dropped,
+			(unsigned)slave.tx_underruns
+		);
+		failures++;
+	}
+
+	i2c_slave_stop();
+	bench_status("i2c_reg_read() after i2c_slave_stop()", i2c_reg_read(BENCH_SENSOR_ADDRESS, 0x20, data, BENCH_LEN), kI2C_STATUS_OK);
+}
+
+/**
+ * 	@brief Waits for the transaction of the remote master to complete.
+ */
+static void
+bench_host_wait(void)
+{
+	while (sim_host_busy())
+	{
+		sim_delay_cycles(BENCH_POLL_WORK_CYCLES);
+	}
+}
+
+static void
+bench_arbitration(void)
+{
+	uint8_t data[BENCH_LEN];
+	uint8_t wr[2] = {0x01, 0x02};
+	uint32_t losses = i2c_arbitration_losses();
+
+	/*
+	 * 	The remote master wins, and the transaction is sent again once it has released the bus
+	 */
+	memset(data, 0, sizeof(data));
+	bench_begin();
+	sim_host_contend(BENCH_ARB_WIN_ADDRESS, wr, sizeof(wr), NULL, 0);
+	bench_status("i2c_reg_read() after arbitration loss", i2c_reg_read(BENCH_SENSOR_ADDRESS, 0x20, data, BENCH_LEN), kI2C_STATUS_OK);
+	bench_report("arbitration: i2c_reg_read()", BENCH_LEN);
+	bench_check("i2c_reg_read() after arbitration loss", data, &sensor.regs[0x20], BENCH_LEN);
+	bench_host_wait();
+
+	bench_begin();
+	sim_host_contend(BENCH_ARB_WIN_ADDRESS, wr, sizeof(wr), NULL, 0);
+	bench_status("i2c_begin() after arbitration loss", i2c_begin(BENCH_SENSOR_ADDRESS, false), kI2C_STATUS_OK);
+	i2c_write(0x20);
+	bench_status("i2c_end() after arbitration loss", i2c_end(), kI2C_STATUS_OK);
+	bench_report("arbitration: i2c_begin()", 1);
+	bench_host_wait();
+
+	/*
+	 * 	The I2C Hard IP wins, and the remote master waits for it
+	 */
+	sim_host_contend(BENCH_ARB_LOSE_ADDRESS, wr, sizeof(wr), NULL, 0);
+	bench_status("i2c_reg_read() winning arbitration", i2c_reg_read(BENCH_SENSOR_ADDRESS, 0x20, data, BENCH_LEN), kI2C_STATUS_OK);
+	bench_host_wait();
+
+	/*
+	 * 	Without retry, the loss is returned
+	 */
+	i2c_set_arbitration_retry(0, kSB_I2C_CONFIG_ARB_BACKOFF_PERIODS);
+	sim_host_contend(BENCH_ARB_WIN_ADDRESS, wr, sizeof(wr), NULL, 0);
+	bench_status("i2c_reg_read() without retry", i2c_reg_read(BENCH_SENSOR_ADDRESS, 0x20, data, BENCH_LEN), kI2C_STATUS_ARB_LOST);
+	bench_host_wait();
+	i2c_set_arbitration_retry(kSB_I2C_CONFIG_ARB_RETRIES, kSB_I2C_CONFIG_ARB_BACKOFF_PERIODS);
+	bench_status("i2c_reg_read() after the other master", i2c_reg_read(BENCH_SENSOR_ADDRESS, 0x20, data, BENCH_LEN), kI2C_STATUS_OK);
+
+	if (i2c_arbitration_losses() - losses != 3)
+	{
+		printf("  FAIL: %lu arbitration losses, expected 3\n", (unsigned long)(i2c_arbitration_losses() - losses));
+		failures++;
+	}
+}
+
+#ifdef CSR_TIMER0_UPTIME_CYCLES_ADDR
+static void
+bench_delay(void)
+{
+	/*
+	 * 	An SCL period at the I2C bus frequency in use, in ns
+	 */
+	uint64_t period_ns = (uint64_t)4 * (i2c_bus_default.active_prescaler + 1) * 1000000000ull / sim_config.clock_frequency;
+
+	bench_begin();
+	i2c_wait_for_i2c_cycles(BENCH_DELAY_PERIODS);
+
+	uint64_t elapsed_ns = sim_stats.time_ns - start_ns;
+
+	bench_report("delay: i2c_wait_for_i2c_cycles()", BENCH_DELAY_PERIODS);
+	if (elapsed_ns < BENCH_DELAY_PERIODS * period_ns || elapsed_ns >= (BENCH_DELAY_PERIODS + 1) * period_ns)
+	{
+		printf("  FAIL: delay of %llu ns, expected %llu ns\n",
+			(unsigned long long)elapsed_ns,
+			(unsigned long long)(BENCH_DELAY_PERIODS * period_ns)
+		);
+		failures++;
+	}
+}
+#endif
+
+int
+main(int argc, char *argv[])
+{
+	if (argc > 1)
+	{
+		sim_config.csr_access_cycles = strtoul(argv[1], NULL, 0);
+	}
+
+	printf("System clock %u Hz, %u cycles per CSR access, %s\n",
+		(unsigned)sim_config.clock_frequency,
+		(unsigned)sim_config.csr_access_cycles,
+#if defined(CSR_SB_I2C_SBCMD_ADDR) && defined(CSR_SB_I2C_SBMIRROR_ADDR)
+		"sbcmd and sbmirror CSRs"
+#elif defined(CSR_SB_I2C_SBCMD_ADDR)
+		"sbcmd CSR"
+#elif defined(CSR_SB_I2C_SBMIRROR_ADDR)
+		"sbmirror CSR"
+#else
+		"legacy System Bus CSRs"
+#endif
+	);
+	printf("%-28s %8s %8s %8s %9s %9s %7s\n", "scenario", "CSR/B", "SB/B", "I2C/B", "time us", "bus us", "bus");
+
+	bench_setup();
+	bench_write();
+	bench_read();
+	bench_throughput();
+	bench_scan();
+	bench_errors();
+#ifdef CSR_SB_I2C_RECOVERY_CONTROL_ADDR
+	bench_recover();
+#endif
+	bench_poll();
+	bench_stretch();
+	bench_sample();
+	bench_shadow();
+	bench_slave();
+	bench_arbitration();
+#ifdef CSR_TIMER0_UPTIME_CYCLES_ADDR
+	bench_delay();
+#endif
+
+	return failures != 0 ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -0,0 +1,1095 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+#include <generated/csr.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "sb_i2c_model.h"
+#include "../sb_i2c_regs.h"
+
+#define SIM_MAX_DEVICES 8
+
+sim_config_t sim_config = {
+	.clock_frequency   = CONFIG_CLOCK_FREQUENCY,
+	.csr_access_cycles = 8,
+};
+
+sim_stats_t sim_stats;
+
+typedef enum SIM_SHIFT_enum
+{
+	kSIM_SHIFT_IDLE,
+	kSIM_SHIFT_TX,
+	kSIM_SHIFT_RX,
+	kSIM_SHIFT_STOP,
+} SIM_SHIFT_t;
+
+/*
+ * 	Phases of a transaction of the remote master
+ */
+typedef enum SIM_REMOTE_enum
+{
+	kSIM_REMOTE_IDLE,
+	kSIM_REMOTE_ADDRESS,
+	kSIM_REMOTE_WRITE,
+	kSIM_REMOTE_READ,
+	kSIM_REMOTE_STOP,
+} SIM_REMOTE_t;
+
+static struct
+{
+	/*
+	 * 	System Bus CSRs
+	 */
+	uint8_t		sbctrl;
+	uint8_t		sbadri;
+	uint8_t		sbdati;
+	uint8_t		sbdato;
+	bool		sbacko;
+	uint8_t		sbcmd_data;
+
+	/*
+	 * 	SB_I2C registers
+	 */
+	uint8_t		cr1;
+	uint8_t		brlsb;
+	uint8_t		brmsb;
+	uint8_t		txdr;
+	uint8_t		rxdr;
+	uint8_t		saddr;
+	uint8_t		gcdr;
+	uint8_t		irqen;
+	uint8_t		irq;
+	uint8_t		last_status;
+
+	/*
+	 * 	I2C engine
+	 */
+	bool		txdr_full;
+	bool		tx_start;
+	bool		rxdr_full;
+	bool		busy;
+	bool		srw;
+	bool		rarc;
+	bool		troe;
+	bool		cksdis;
+	bool		rx_enabled;
+	bool		rx_last;
+	bool		rx_stop;
+	bool		stop_pending;
+	SIM_SHIFT_t	shift;
+	bool		shift_start;
+	bool		shift_last;
+	uint8_t		shift_data;
+	uint64_t	shift_time;
+	uint64_t	shift_done;
+	uint64_t	time;
+
+	/*
+	 * 	Slave port, addressed by the remote master, and by a hardware general call
+	 */
+	bool		slave;
+	bool		general_call;
+	bool		hgc;
+
+	/*
+	 * 	Remote master. A phase starts at remote_time, or when a stretch of SCL ends. remote_bus is
+	 * 	set while it holds the I2C bus, and remote_contend while its START waits for the one of
+	 * 	the I2C Hard IP, which lost arbitration when arbl is set.
+	 */
+	SIM_REMOTE_t	remote;
+	bool		remote_bus;
+	bool		remote_contend;
+	bool		arbl;
+	bool		remote_started;
+	bool		remote_stalled;
+	bool		remote_read;
+	uint8_t		remote_address;
+	uint8_t		remote_data;
+	const uint8_t *	remote_wr;
+	size_t		remote_wr_len;
+	size_t		remote_wr_index;
+	uint8_t *	remote_rd;
+	size_t		remote_rd_len;
+	size_t		remote_rd_index;
+	uint64_t	remote_time;
+	uint64_t	remote_done;
+
+	/*
+	 * 	Uptime of timer0, in system clock cycles, latched by a write to its latch CSR
+	 */
+	uint64_t	uptime_cycles;
+
+	/*
+	 * 	Bus recovery, and SCL pulses until a slave releases SDA
+	 */
+	unsigned	sda_held;
+	unsigned	recovery_pulses;
+	uint64_t	recovery_done;
+
+	/*
+	 * 	I2C bus
+	 */
+	sim_device_t *	devices[SIM_MAX_DEVICES];
+	size_t		device_count;
+	sim_device_t *	addressed;
+} sim;
+
+/**
+ * 	@brief Gets the SCL period set by the prescaler registers.
+ *
+ * 	@return uint64_t the SCL period in ns.
+ */
+static uint64_t
+sim_scl_period_ns(void)
+{
+	uint32_t prescale = sim.brlsb | (sim.brmsb & kI2CBRMSB_bm) << 8;
+
+	return (uint64_t)4 * (prescale + 1) * 1000000000ull / sim_config.clock_frequency;
+}
+
+/**
+ * 	@brief Resets the I2C engine, as a write to I2CCR1 or I2CBRMSB does.
+ */
+static void
+sim_core_reset(void)
+{
+	if (sim.addressed != NULL && sim.addressed->stop != NULL)
+	{
+		sim.addressed->stop(sim.addressed);
+	}
+
+	sim.addressed = NULL;
+	sim.txdr_full = false;
+	sim.tx_start = false;
+	sim.rxdr_full = false;
+	sim.busy = false;
+	sim.srw = false;
+	sim.rarc = false;
+	sim.troe = false;
+	sim.rx_enabled = false;
+	sim.rx_last = false;
+	sim.rx_stop = false;
+	sim.stop_pending = false;
+	sim.shift = kSIM_SHIFT_IDLE;
+	sim.slave = false;
+	sim.general_call = false;
+	sim.hgc = false;
+	sim.remote = kSIM_REMOTE_IDLE;
+	sim.remote_bus = false;
+	sim.remote_contend = false;
+	sim.arbl = false;
+}
+
+/**
+ * 	@brief Starts the next bus operation, if any.
+ *
+ * 	@return true if an operation has started.
+ */
+static bool
+sim_engine_start(void)
+{
+	uint64_t periods;
+
+	if (!(sim.cr1 & kI2CCR1_I2CEN_bm))
+	{
+		return false;
+	}
+
+	/*
+	 * 	The remote master holds the I2C bus
+	 */
+	if (sim.busy && sim.remote_bus)
+	{
+		return false;
+	}
+
+	/*
+	 * 	No START can be sent while SDA is held low, or while the bus recovery drives the lines
+	 */
+	if (sim.sda_held > 0 || sim_stats.time_ns < sim.recovery_done)
+	{
+		return false;
+	}
+
+	if (sim.txdr_full && sim.tx_start && sim.remote_contend)
+	{
+		/*
+		 * 	Both masters START together. The one which sends a 1 while the other sends a 0
+		 * 	loses, so the lower address byte wins
+		 */
+		uint8_t remote_byte = sim.remote_address << 1 | (sim.remote_read ? 0b1 : 0b0);
+
+		sim.remote_contend = false;
+		sim.remote_time = sim.time;
+		if (remote_byte < sim.txdr)
+		{
+			sim.arbl = true;
+			sim.txdr_full = false;
+			sim.tx_start = false;
+
+			return false;
+		}
+	}
+
+	if (sim.txdr_full)
+	{
+		sim.shift = kSIM_SHIFT_TX;
+		sim.shift_start = sim.tx_start;
+		sim.shift_data = sim.txdr;
+		sim.txdr_full = false;
+		sim.tx_start = false;
+		periods = 9;
+
+		if (sim.shift_start)
+		{
+			/*
+			 * 	(Repeated) START
+			 */
+			periods += 1;
+			sim.busy = true;
+			sim.arbl = false;
+			sim.slave = false;
+			sim.srw = false;
+			sim.rarc = false;
+			sim.troe = false;
+			sim.rx_enabled = false;
+			sim.rx_last = false;
+			sim.rx_stop = false;
+		}
+	}
+	else if (sim.srw && sim.rx_enabled && !sim.stop_pending)
+	{
+		if (sim.rxdr_full && !sim.cksdis)
+		{
+			/*
+			 * 	Stretch the clock until the receive register is read
+			 */
+			return false;
+		}
+
+		sim.shift = kSIM_SHIFT_RX;
+		sim.shift_last = sim.rx_last;
+		sim.rx_last = false;
+		periods = 9;
+	}
+	else if (sim.stop_pending)
+	{
+		sim.shift = kSIM_SHIFT_STOP;
+		sim.stop_pending = false;
+		periods = 1;
+	}
+	else
+	{
+		return false;
+	}
+
+	sim.shift_time = sim.time;
+	sim.shift_done = sim.time + periods * sim_scl_period_ns();
+
+	return true;
+}
+
+/**
+ * 	@brief Completes the bus operation in progress.
+ */
+static void
+sim_engine_complete(void)
+{
+	bool ack;
+
+	switch (sim.shift)
+	{
+	case kSIM_SHIFT_TX:
+		if (sim.shift_start)
+		{
+			bool is_read = sim.shift_data & 0b1;
+
+			if (sim.addressed != NULL && sim.addressed->stop != NULL)
+			{
+				sim.addressed->stop(sim.addressed);
+			}
+			sim.addressed = NULL;
+
+			for (size_t i = 0; i < sim.device_count; i++)
+			{
+				if (sim.devices[i]->address == sim.shift_data >> 1)
+				{
+					sim.addressed = sim.devices[i];
+				}
+			}
+
+			ack = sim.addressed != NULL && sim.addressed->start(sim.addressed, is_read);
+			if (!ack)
+			{
+				sim.addressed = NULL;
+			}
+			sim.srw = ack && is_read;
+		}
+		else
+		{
+			ack = sim.addressed != NULL && !sim.srw && sim.addressed->write(sim.addressed, sim.shift_data);
+		}
+		sim.rarc = !ack;
+		break;
+
+	case kSIM_SHIFT_RX:
+		if (sim.rxdr_full)
+		{
+			sim.troe = true;
+			sim_stats.overruns++;
+		}
+		else
+		{
+			sim.rxdr = sim.addressed != NULL ? sim.addressed->read(sim.addressed) : 0xFF;
+			sim.rxdr_full = true;
+		}
+		if (sim.shift_last)
+		{
+			sim.rx_enabled = false;
+			sim.stop_pending = sim.rx_stop;
+		}
+		break;
+
+	case kSIM_SHIFT_STOP:
+		if (sim.addressed != NULL && sim.addressed->stop != NULL)
+		{
+			sim.addressed->stop(sim.addressed);
+		}
+		sim.addressed = NULL;
+		sim.busy = false;
+		sim.srw = false;
+		sim.rx_enabled = false;
+		break;
+
+	default:
+		break;
+	}
+
+	if (sim.shift != kSIM_SHIFT_STOP)
+	{
+		sim_stats.bytes++;
+	}
+	sim_stats.bus_ns += sim.shift_done - sim.shift_time;
+	sim.time = sim.shift_done;
+	sim.shift = kSIM_SHIFT_IDLE;
+}
+
+/**
+ * 	@brief Moves the remote master to its next phase, once one has completed.
+ */
+static void
+sim_remote_next(void)
+{
+	if (sim.remote == kSIM_REMOTE_STOP)
+	{
+		sim.remote = kSIM_REMOTE_IDLE;
+	}
+	else if (sim.remote == kSIM_REMOTE_ADDRESS && !sim.slave && !sim.general_call)
+	{
+		sim.remote = kSIM_REMOTE_STOP;
+	}
+	else if (sim.remote_read)
+	{
+		sim.remote = sim.remote_rd_index < sim.remote_rd_len ? kSIM_REMOTE_READ : kSIM_REMOTE_STOP;
+	}
+	else if (sim.remote_wr_index < sim.remote_wr_len)
+	{
+		sim.remote = kSIM_REMOTE_WRITE;
+	}
+	else if (sim.remote_rd_len > 0 && !sim.general_call)
+	{
+		sim.remote = kSIM_REMOTE_ADDRESS;
+		sim.remote_read = true;
+	}
+	else
+	{
+		sim.remote = kSIM_REMOTE_STOP;
+	}
+
+	sim.remote_started = false;
+}
+
+/**
+ * 	@brief Starts the phase of the remote master, unless the slave stretches SCL.
+ *
+ * 	@param now is the simulated time.
+ * 	@return true if the phase has started.
+ */
+static bool
+sim_remote_start(uint64_t now)
+{
+	uint64_t periods = 9;
+
+	switch (sim.remote)
+	{
+	case kSIM_REMOTE_ADDRESS:
+		periods = 10;
+		sim.remote_bus = true;
+		sim.busy = true;
+		break;
+
+	case kSIM_REMOTE_READ:
+		if (!sim.txdr_full && !sim.cksdis)
+		{
+			return false;
+		}
+		if (!sim.txdr_full)
+		{
+			sim_stats.overruns++;
+		}
+		sim.remote_data = sim.txdr;
+		sim.txdr_full = false;
+		break;
+
+	case kSIM_REMOTE_STOP:
+		periods = 1;
+		break;
+
+	default:
+		break;
+	}
+
+	sim.remote_time = sim.remote_stalled && sim.remote_time < now ? now : sim.remote_time;
+	sim.remote_stalled = false;
+	sim.remote_done = sim.remote_time + periods * sim_scl_period_ns();
+	sim.remote_started = true;
+
+	return true;
+}
+
+/**
+ * 	@brief Completes the phase of the remote master, unless the slave stretches SCL.
+ *
+ * 	@return true if the phase has completed.
+ */
+static bool
+sim_remote_complete(void)
+{
+	uint8_t data;
+
+	switch (sim.remote)
+	{
+	case kSIM_REMOTE_ADDRESS:
+		sim.busy = true;
+		sim.troe = false;
+		sim.hgc = false;
+		if (sim.remote_address == 0x00 && !sim.remote_read)
+		{
+			sim.general_call = sim.cr1 & kI2CCR1_GCEN_bm;
+		}
+		else
+		{
+			sim.slave = 0
+				|| (sim.remote_address >> 2 == (sim.saddr & kI2CSADDR_7BIT_ADDR_bm)
+				&& (sim.remote_address & 0b11) == SIM_SLAVE_ADDRESS_LSB);
+		}
+		sim.srw = sim.slave && sim.remote_read;
+		break;
+
+	case kSIM_REMOTE_WRITE:
+		data = sim.remote_wr[sim.remote_wr_index];
+		if (sim.general_call)
+		{
+			sim.gcdr = data;
+			sim.hgc = true;
+		}
+		else if (!sim.rxdr_full)
+		{
+			sim.rxdr = data;
+			sim.rxdr_full = true;
+		}
+		else if (!sim.cksdis)
+		{
+			/*
+			 * 	Stretch the clock until the receive register is read
+			 */
+			sim.remote_stalled = true;
+			return false;
+		}
+		else
+		{
+			sim.troe = true;
+			sim_stats.overruns++;
+		}
+		sim.remote_wr_index++;
+		break;
+
+	case kSIM_REMOTE_READ:
+		sim.remote_rd[sim.remote_rd_index++] = sim.remote_data;
+		if (sim.remote_rd_index == sim.remote_rd_len)
+		{
+			/*
+			 * 	NACK of the last byte
+			 */
+			sim.troe = true;
+		}
+		break;
+
+	case kSIM_REMOTE_STOP:
+		/*
+		 * 	The I2C Hard IP stays a slave, for the status of the last byte received, until its
+		 * 	next START as a master
+		 */
+		sim.busy = false;
+		sim.remote_bus = false;
+		sim.srw = false;
+		sim.general_call = false;
+		sim.txdr_full = false;
+		break;
+
+	default:
+		break;
+	}
+
+	if (sim.remote != kSIM_REMOTE_STOP)
+	{
+		sim_stats.bytes++;
+	}
+
+	return true;
+}
+
+/**
+ * 	@brief Runs the remote master up to the given simulated time, while the I2C Hard IP is not
+ * 	busy as a master.
+ *
+ * 	@param now is the simulated time.
+ */
+static void
+sim_remote_advance(uint64_t now)
+{
+	while (sim.remote != kSIM_REMOTE_IDLE && !sim.remote_contend && sim.shift == kSIM_SHIFT_IDLE && (sim.remote_bus || !sim.busy))
+	{
+		if (!sim.remote_started && !sim_remote_start(now))
+		{
+			sim.remote_stalled = true;
+			break;
+		}
+		if (sim.remote_done > now)
+		{
+			break;
+		}
+		if (!sim_remote_complete())
+		{
+			break;
+		}
+
+		/*
+		 * 	A stretch at the end of a phase delays the next one
+		 */
+		uint64_t done = sim.remote_stalled && sim.remote_done < now ? now : sim.remote_done;
+
+		sim.remote_stalled = false;
+		sim_stats.bus_ns += done - sim.remote_time;
+		sim.remote_time = done;
+		sim_remote_next();
+	}
+}
+
+/**
+ * 	@brief Runs the I2C engine up to the current simulated time.
+ */
+static void
+sim_engine_advance(void)
+{
+	uint64_t now = sim_stats.time_ns;
+
+	if (sim.shift == kSIM_SHIFT_IDLE && sim.time < now)
+	{
+		sim.time = now;
+	}
+
+	for (;;)
+	{
+		if (sim.shift != kSIM_SHIFT_IDLE)
+		{
+			if (sim.shift_done > now)
+			{
+				break;
+			}
+			sim_engine_complete();
+		}
+
+		if (!sim_engine_start())
+		{
+			break;
+		}
+	}
+
+	if (sim.shift == kSIM_SHIFT_IDLE && sim.time < now)
+	{
+		sim.time = now;
+	}
+
+	sim_remote_advance(now);
+}
+
+/**
+ * 	@brief Gets the I2C Status Register.
+ *
+ * 	@return uint8_t the I2C Status Register.
+ */
+static uint8_t
+sim_get_status(void)
+{
+	bool trrdy = sim.srw ? sim.rxdr_full : !sim.txdr_full;
+
+	if (sim.slave)
+	{
+		trrdy = sim.srw ? !sim.txdr_full : sim.rxdr_full;
+	}
+
+	return 0
+		| (sim.hgc ? kI2CSR_HGC_bm : 0)
+		| (sim.troe ? kI2CSR_TROE_bm : 0)
+		| (trrdy ? kI2CSR_TRRDY_bm : 0)
+		| (sim.srw ? kI2CSR_SRW_bm : 0)
+		| (sim.rarc ? kI2CSR_RARC_bm : 0)
+		| (sim.arbl ? kI2CSR_ARBL_bm : 0)
+		| (sim.busy ? kI2CSR_BUSY_bm : 0)
+		| (sim.shift == kSIM_SHIFT_TX || sim.shift == kSIM_SHIFT_RX ? kI2CSR_TIP_bm : 0);
+}
+
+/**
+ * 	@brief Latches the enabled interrupts on the rising edges of the I2C Status Register flags.
+ */
+static void
+sim_update_irq(void)
+{
+	uint8_t status = sim_get_status();
+	uint8_t rising = status & ~sim.last_status;
+
+	sim.irq |= rising & sim.irqen & (kI2CIRQ_IRQHGC_bm | kI2CIRQ_IRQTROE_bm | kI2CIRQ_IRQTRRDY_bm | kI2CIRQ_IRQARBL_bm);
+	sim.last_status = status;
+}
+
+/**
+ * 	@brief Applies an I2C Command Register write.
+ *
+ * 	@param command is the command.
+ */
+static void
+sim_command(uint8_t command)
+{
+	sim.cksdis = command & kI2CCMDR_CKSDIS_bm;
+
+	if (command == 0x00)
+	{
+		return;
+	}
+
+	/*
+	 * 	After an arbitration loss, the I2C Hard IP is no longer a master until its next START
+	 */
+	if (sim.arbl && !(command & kI2CCMDR_STA_bm))
+	{
+		return;
+	}
+
+	if (command & kI2CCMDR_STA_bm)
+	{
+		sim.tx_start = true;
+	}
+
+	if (command & kI2CCMDR_WR_bm)
+	{
+		if (sim.txdr_full)
+		{
+			sim.troe = true;
+		}
+		sim.txdr_full = true;
+	}
+
+	if (command & kI2CCMDR_RD_bm)
+	{
+		if (command & (kI2CCMDR_ACK_bm | kI2CCMDR_STO_bm))
+		{
+			/*
+			 * 	NACK (and STOP) after the byte in progress, or after the next one
+			 */
+			sim.rx_stop = command & kI2CCMDR_STO_bm;
+			if (sim.shift == kSIM_SHIFT_RX)
+			{
+				sim.shift_last = true;
+			}
+			else
+			{
+				sim.rx_last = true;
+			}
+		}
+		sim.rx_enabled = true;
+	}
+	else if (command & kI2CCMDR_STO_bm)
+	{
+		sim.stop_pending = true;
+	}
+}
+
+/**
+ * 	@brief Performs a System Bus access.
+ *
+ * 	@param address is the register address.
+ * 	@param is_write sets if this is a write.
+ * 	@param data is the data to write.
+ * 	@return uint8_t the data read.
+ */
+static uint8_t
+sim_sb_access(uint8_t address, bool is_write, uint8_t data)
+{
+	uint8_t value = 0;
+
+	if (is_write)
+	{
+		sim_stats.sb_writes++;
+
+		switch (address)
+		{
+		case kSB_I2C_REGS_I2CCR1:
+			sim.cr1 = data;
+			sim_core_reset();
+			break;
+		case kSB_I2C_REGS_I2CCMDR:
+			sim_command(data);
+			break;
+		case kSB_I2C_REGS_I2CBRLSB:
+			sim.brlsb = data;
+			break;
+		case kSB_I2C_REGS_I2CBRMSB:
+			sim.brmsb = data;
+			sim_core_reset();
+			break;
+		case kSB_I2C_REGS_I2CTXDR:
+			sim.txdr = data;
+			if (sim.slave && sim.srw)
+			{
+				sim.txdr_full = true;
+			}
+			break;
+		case kSB_I2C_REGS_I2CSADDR:
+			sim.saddr = data;
+			break;
+		case kSB_I2C_REGS_I2CIRQEN:
+			sim.irqen = data;
+			break;
+		case kSB_I2C_REGS_I2CIRQ:
+			sim.irq &= ~data;
+			break;
+		default:
+			break;
+		}
+	}
+	else
+	{
+		sim_stats.sb_reads++;
+
+		switch (address)
+		{
+		case kSB_I2C_REGS_I2CCR1:
+			value = sim.cr1;
+			break;
+		case kSB_I2C_REGS_I2CBRLSB:
+			value = sim.brlsb;
+			break;
+		case kSB_I2C_REGS_I2CBRMSB:
+			value = sim.brmsb;
+			break;
+		case kSB_I2C_REGS_I2CSR:
+			value = sim_get_status();
+			break;
+		case kSB_I2C_REGS_I2CRXDR:
+			value = sim.rxdr;
+			sim.rxdr_full = false;
+			break;
+		case kSB_I2C_REGS_I2CGCDR:
+			value = sim.gcdr;
+			break;
+		case kSB_I2C_REGS_I2CSADDR:
+			value = sim.saddr;
+			break;
+		case kSB_I2C_REGS_I2CIRQEN:
+			value = sim.irqen;
+			break;
+		case kSB_I2C_REGS_I2CIRQ:
+			value = sim.irq;
+			break;
+		default:
+			break;
+		}
+	}
+
+	sim_engine_advance();
+
+	return value;
+}
+
+/**
+ * 	@brief Accounts for a CSR access, and runs the I2C engine up to it.
+ */
+static void
+sim_csr_access(void)
+{
+	sim_stats.time_ns += (uint64_t)sim_config.csr_access_cycles * 1000000000ull / sim_config.clock_frequency;
+	sim_engine_advance();
+	sim_update_irq();
+}
+
+uint32_t
+sim_csr_read(unsigned long address)
+{
+	uint32_t value = 0;
+
+	sim_stats.csr_reads++;
+	sim_csr_access();
+
+	switch (address)
+	{
+	case CSR_SB_I2C_SBCTRL_ADDR:
+		value = sim.sbctrl;
+		break;
+	case CSR_SB_I2C_SBSTATUS_ADDR:
+		value = sim.sbacko << CSR_SB_I2C_SBSTATUS_SBACKO_OFFSET;
+		break;
+	case CSR_SB_I2C_SBADRI_ADDR:
+		value = sim.sbadri;
+		break;
+	case CSR_SB_I2C_SBDATI_ADDR:
+		value = sim.sbdati;
+		break;
+	case CSR_SB_I2C_SBDATO_ADDR:
+		value = sim.sbdato;
+		break;
+#ifdef CSR_SB_I2C_SBCMD_ADDR
+	case CSR_SB_I2C_SBCMD_STATUS_ADDR:
+		value = sim.sbcmd_data << CSR_SB_I2C_SBCMD_STATUS_DATA_OFFSET;
+		break;
+#endif
+#ifdef CSR_SB_I2C_SBMIRROR_ADDR
+	case CSR_SB_I2C_SBMIRROR_ADDR:
+		value = 0
+			| sim_get_status() << CSR_SB_I2C_SBMIRROR_I2CSR_OFFSET
+			| sim.irq << CSR_SB_I2C_SBMIRROR_I2CIRQ_OFFSET
+			| 1 << CSR_SB_I2C_SBMIRROR_VALID_OFFSET;
+		break;
+#endif
+#ifdef CSR_SB_I2C_RECOVERY_STATUS_ADDR
+	case CSR_SB_I2C_RECOVERY_STATUS_ADDR:
+		value = 0
+			| 1 << CSR_SB_I2C_RECOVERY_STATUS_SCL_OFFSET
+			| (sim.sda_held == 0) << CSR_SB_I2C_RECOVERY_STATUS_SDA_OFFSET
+			| (sim_stats.time_ns < sim.recovery_done) << CSR_SB_I2C_RECOVERY_STATUS_BUSY_OFFSET
+			| sim.recovery_pulses << CSR_SB_I2C_RECOVERY_STATUS_PULSES_OFFSET;
+		break;
+#endif
+#ifdef CSR_TIMER0_UPTIME_CYCLES_ADDR
+	case CSR_TIMER0_UPTIME_CYCLES_ADDR:
+		value = sim.uptime_cycles >> 32;
+		break;
+	case CSR_TIMER0_UPTIME_CYCLES_ADDR + 4:
+		value = (uint32_t)sim.uptime_cycles;
+		break;
+#endif
+	default:
+		break;
+	}
+
+	sim_update_irq();
+
+	return value;
+}
+
+void
+sim_csr_write(unsigned long address, uint32_t value)
+{
+	sim_stats.csr_writes++;
+	sim_csr_access();
+
+	switch (address)
+	{
+	case CSR_SB_I2C_SBCTRL_ADDR:
+		sim.sbctrl = value;
+		if (!(value & (1 << CSR_SB_I2C_SBCTRL_SBSTBI_OFFSET)))
+		{
+			sim.sbacko = false;
+		}
+		else if (!sim.sbacko)
+		{
+			/*
+			 * 	The strobe is acknowledged within the CSR access
+			 */
+			sim.sbdato = sim_sb_access(sim.sbadri, value & (1 << CSR_SB_I2C_SBCTRL_SBRWI_OFFSET), sim.sbdati);
+			sim.sbacko = true;
+		}
+		break;
+	case CSR_SB_I2C_SBADRI_ADDR:
+		sim.sbadri = value & 0xF;
+		break;
+	case CSR_SB_I2C_SBDATI_ADDR:
+		sim.sbdati = value;
+		break;
+#ifdef CSR_SB_I2C_SBCMD_ADDR
+	case CSR_SB_I2C_SBCMD_ADDR:
+		sim.sbcmd_data = sim_sb_access(
+			(value >> CSR_SB_I2C_SBCMD_ADDR_OFFSET) & 0xF,
+			(value >> CSR_SB_I2C_SBCMD_RW_OFFSET) & 0b1,
+			value >> CSR_SB_I2C_SBCMD_DATA_OFFSET
+		);
+		break;
+#endif
+#ifdef CSR_SB_I2C_RECOVERY_CONTROL_ADDR
+	case CSR_SB_I2C_RECOVERY_CONTROL_ADDR:
+		if (value & (1 << CSR_SB_I2C_RECOVERY_CONTROL_START_OFFSET))
+		{
+			uint64_t half_period = (value >> CSR_SB_I2C_RECOVERY_CONTROL_HALF_PERIOD_OFFSET) & 0xFFFF;
+
+			/*
+			 * 	The lines are released for a half period, each SCL pulse takes two, up to 9
+			 * 	pulses, and the STOP four
+			 */
+			sim.recovery_pulses = sim.sda_held < 9 ? sim.sda_held : 9;
+			sim.sda_held -= sim.recovery_pulses;
+			sim.recovery_done = sim_stats.time_ns +
+				(1 + 2 * sim.recovery_pulses + 4) * half_period * 1000000000ull / sim_config.clock_frequency;
+		}
+		break;
+#endif
+#ifdef CSR_TIMER0_UPTIME_LATCH_ADDR
+	case CSR_TIMER0_UPTIME_LATCH_ADDR:
+		sim.uptime_cycles = sim_stats.time_ns * sim_config.clock_frequency / 1000000000ull;
+		break;
+#endif
+	default:
+		break;
+	}
+
+	sim_update_irq();
+}
+
+void
+sim_reset(void)
+{
+	uint64_t time = sim.time;
+
+	memset(&sim, 0, sizeof(sim));
+	sim.time = time;
+}
+
+void
+sim_hold_sda(unsigned pulses)
+{
+	sim.sda_held = pulses;
+}
+
+void
+sim_attach(sim_device_t *dev)
+{
+	if (sim.device_count < SIM_MAX_DEVICES)
+	{
+		sim.devices[sim.device_count++] = dev;
+	}
+}
+
+void
+sim_stats_clear(void)
+{
+	uint64_t time = sim_stats.time_ns;
+
+	memset(&sim_stats, 0, sizeof(sim_stats));
+	sim_stats.time_ns = time;
+}
+
+void
+sim_drain(void)
+{
+	while (sim.shift != kSIM_SHIFT_IDLE)
+	{
+		sim_stats.time_ns = sim.shift_done;
+		sim_engine_advance();
+	}
+}
+
+void
+sim_delay_cycles(uint64_t cycles)
+{
+	sim_stats.time_ns += cycles * 1000000000ull / sim_config.clock_frequency;
+	sim_engine_advance();
+	sim_update_irq();
+}
+
+/**
+ * 	@brief Starts a transaction of the remote master.
+ *
+ * 	@param address is the slave address.
+ * 	@param wr is the buffer to write.
+ * 	@param wr_len is the number of bytes to write.
+ * 	@param rd is the buffer to read to.
+ * 	@param rd_len is the number of bytes to read.
+ * 	@param contend sets if its START waits for the next one of the I2C Hard IP.
+ */
+static void
+sim_host_start(uint8_t address, const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len, bool contend)
+{
+	sim.remote = kSIM_REMOTE_ADDRESS;
+	sim.remote_contend = contend;
+	sim.remote_started = false;
+	sim.remote_stalled = false;
+	sim.remote_read = wr_len == 0;
+	sim.remote_address = address;
+	sim.remote_wr = wr;
+	sim.remote_wr_len = wr_len;
+	sim.remote_wr_index = 0;
+	sim.remote_rd = rd;
+	sim.remote_rd_len = rd_len;
+	sim.remote_rd_index = 0;
+	sim.remote_time = sim_stats.time_ns;
+	sim_engine_advance();
+}
+
+void
+sim_host_transfer(uint8_t address, const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len)
+{
+	sim_host_start(address, wr, wr_len, rd, rd_len, false);
+}
+
+void
+sim_host_contend(uint8_t address, const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len)
+{
+	sim_host_start(address, wr, wr_len, rd, rd_len, true);
+}
+
+bool
+sim_host_busy(void)
+{
+	return sim.remote != kSIM_REMOTE_IDLE;
+}
+
+bool
+sim_irq_pending(void)
+{
+	sim_update_irq();
+
+	return (sim.irq & sim.irqen & (kI2CIRQ_IRQHGC_bm | kI2CIRQ_IRQTROE_bm | kI2CIRQ_IRQTRRDY_bm | kI2CIRQ_IRQARBL_bm)) != 0;
+}
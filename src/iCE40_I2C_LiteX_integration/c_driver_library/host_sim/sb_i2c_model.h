@@ -0,0 +1,248 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+#ifndef __SB_I2C_MODEL_H
+#define __SB_I2C_MODEL_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 	Behavioral model of the SB_I2C hard IP, as seen by the C driver through the ICE40UP_I2C CSRs,
+ * 	with simulated slave devices on its I2C bus.
+ *
+ * 	The model keeps a simulated time. Every CSR access advances it by sim_config.csr_access_cycles
+ * 	system clock cycles, and the I2C bus progresses at the SCL frequency set by the prescaler
+ * 	registers. The I2C engine follows the driver's view of the hard IP:
+ * 	* TRRDY is set in transmit mode as soon as the transmit register has moved to the shift
+ * 	  register, and in receive mode when the receive register holds a byte.
+ * 	* I2CCMDR commands are executed when the register is written. Writing 0x00 only clears CKSDIS.
+ * 	* After a RD command, bytes are received back-to-back (double buffered) until a RD and ACK
+ * 	  command, which NACKs the byte in progress (or the next one). With STO, it is followed by a
+ * 	  STOP, else the bus is held for a repeated START.
+ * 	* RARC is set when the last transmitted byte was not acknowledged.
+ * 	* As a slave, addressed by the remote master of sim_host_transfer(), TRRDY is set when the
+ * 	  receive register holds a byte, or when the transmit register, loaded by a write of I2CTXDR,
+ * 	  has moved to the shift register. SCL is stretched while the receive register is full, or the
+ * 	  transmit register empty, unless CKSDIS is set. The NACK of the last byte read sets TROE, and
+ * 	  a byte left in the transmit register is dropped at the STOP. The hardware general call
+ * 	  (address 0x00, with GCEN) sets HGC, with its second byte in I2CGCDR.
+ * 	* A START of the remote master of sim_host_contend() collides with the next START of the I2C
+ * 	  Hard IP, and the lower address byte wins arbitration. The loser sets ARBL, drops its address
+ * 	  byte and ignores the commands without STA, until its next START once the bus is free.
+ */
+
+/*
+ * 	Two least significant bits of the slave address, fixed by the corner of the I2C Hard IP
+ */
+#define SIM_SLAVE_ADDRESS_LSB	0b01
+
+typedef struct sim_device sim_device_t;
+
+struct sim_device
+{
+	uint8_t		address;
+
+	/*
+	 * 	Called on a (repeated) START addressed to the device, returns the ACK
+	 */
+	bool		(*start)(sim_device_t *dev, bool is_read);
+
+	/*
+	 * 	Called for each byte written to the device, returns the ACK
+	 */
+	bool		(*write)(sim_device_t *dev, uint8_t data);
+
+	/*
+	 * 	Called for each byte read from the device
+	 */
+	uint8_t		(*read)(sim_device_t *dev);
+
+	/*
+	 * 	Called on a STOP, if the device was addressed
+	 */
+	void		(*stop)(sim_device_t *dev);
+
+	void *		state;
+};
+
+typedef struct
+{
+	uint32_t	clock_frequency;
+	uint32_t	csr_access_cycles;
+} sim_config_t;
+
+typedef struct
+{
+	uint64_t	csr_reads;
+	uint64_t	csr_writes;
+	uint64_t	sb_reads;
+	uint64_t	sb_writes;
+	uint64_t	bytes;
+	uint64_t	overruns;
+	uint64_t	time_ns;
+	uint64_t	bus_ns;
+} sim_stats_t;
+
+extern sim_config_t sim_config;
+extern sim_stats_t sim_stats;
+
+/**
+ * 	@brief Resets the model and detaches all devices. The simulated time and statistics are kept.
+ */
+void sim_reset(void);
+
+/**
+ * 	@brief Attaches a slave device to the simulated I2C bus.
+ *
+ * 	@param dev is the device.
+ */
+void sim_attach(sim_device_t *dev);
+
+/**
+ * 	@brief Clears the statistics.
+ */
+void sim_stats_clear(void);
+
+/**
+ * 	@brief Advances the simulated time, for CPU work outside CSR accesses.
+ *
+ * 	@param cycles is the number of system clock cycles.
+ */
+void sim_delay_cycles(uint64_t cycles);
+
+/**
+ * 	@brief Advances the simulated time until the I2C bus operations in progress have completed.
+ */
+void sim_drain(void);
+
+/**
+ * 	@brief Makes a slave hold SDA low, as after a glitch in the middle of a byte it sends. The I2C
+ * 	engine is stalled until the bus recovery clocks the slave out of it.
+ *
+ * 	@param pulses is the number of SCL pulses after which the slave releases SDA.
+ */
+void sim_hold_sda(unsigned pulses);
+
+/**
+ * 	@brief Starts a transaction of the remote master, which addresses the I2C Hard IP as a slave:
+ * 	writes wr_len bytes, and then reads rd_len bytes after a repeated START. Either part can be
+ * 	empty. It runs as the simulated time advances, while the I2C Hard IP is not busy as a master.
+ *
+ * 	@param address is the slave address.
+ * 	@param wr is the buffer to write, which must stay valid until the transaction has completed.
+ * 	@param wr_len is the number of bytes to write.
+ * 	@param rd is the buffer to read to.
+ * 	@param rd_len is the number of bytes to read.
+ */
+void sim_host_transfer(uint8_t address, const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len);
+
+/**
+ * 	@brief Starts a transaction of the remote master as sim_host_transfer(), with its START at
+ * 	the same time as the next START of the I2C Hard IP, for arbitration. The loser runs its
+ * 	transaction once the winner has released the I2C bus.
+ *
+ * 	@param address is the slave address.
+ * 	@param wr is the buffer to write, which must stay valid until the transaction has completed.
+ * 	@param wr_len is the number of bytes to write.
+ * 	@param rd is the buffer to read to.
+ * 	@param rd_len is the number of bytes to read.
+ */
+void sim_host_contend(uint8_t address, const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len);
+
+/**
+ * 	@brief Checks if a transaction of the remote master is in progress.
+ *
+ * 	@return true if it is in progress.
+ */
+bool sim_host_busy(void);
+
+/**
+ * 	@brief Checks if the SB_I2C interrupt output (IRQO) is asserted.
+ *
+ * 	@return true if an enabled interrupt is pending in I2CIRQ.
+ */
+bool sim_irq_pending(void);
+
+/**
+ * 	@brief Performs a CSR read. Used by the stand-in generated/csr.h.
+ *
+ * 	@param address is the CSR address.
+ * 	@return uint32_t the CSR value.
+ */
+uint32_t sim_csr_read(unsigned long address);
+
+/**
+ * 	@brief Performs a CSR write. Used by the stand-in generated/csr.h.
+ *
+ * 	@param address is the CSR address.
+ * 	@param value is the CSR value.
+ */
+void sim_csr_write(unsigned long address, uint32_t value);
+
+/*
+ * 	Simulated devices
+ */
+
+/*
+ * 	Register file device. The first byte written after the address sets the register pointer,
+ * 	the following ones are written to the registers if the device is writable. Reads start from
+ * 	the register pointer. The pointer auto-increments.
+ */
+typedef struct
+{
+	uint8_t		regs[256];
+	uint8_t		pointer;
+	bool		writable;
+	bool		pointer_set;
+} sim_regfile_t;
+
+/**
+ * 	@brief Initializes a register file device, such as an EEPROM or a sensor.
+ *
+ * 	@param dev is the device.
+ * 	@param regfile is the device state.
+ * 	@param address is the slave address.
+ * 	@param writable sets if the registers can be written.
+ */
+void sim_regfile_init(sim_device_t *dev, sim_regfile_t *regfile, uint8_t address, bool writable);
+
+/**
+ * 	@brief Initializes a device which acknowledges its address, but no data byte.
+ *
+ * 	@param dev is the device.
+ * 	@param address is the slave address.
+ */
+void sim_nack_init(sim_device_t *dev, uint8_t address);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,123 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include "sb_i2c_model.h"
+
+static bool
+sim_regfile_start(sim_device_t *dev, bool is_read)
+{
+	sim_regfile_t *regfile = dev->state;
+
+	if (!is_read)
+	{
+		regfile->pointer_set = false;
+	}
+
+	return true;
+}
+
+static bool
+sim_regfile_write(sim_device_t *dev, uint8_t data)
+{
+	sim_regfile_t *regfile = dev->state;
+
+	if (!regfile->pointer_set)
+	{
+		regfile->pointer = data;
+		regfile->pointer_set = true;
+		return true;
+	}
+
+	if (!regfile->writable)
+	{
+		return false;
+	}
+
+	regfile->regs[regfile->pointer++] = data;
+
+	return true;
+}
+
+static uint8_t
+sim_regfile_read(sim_device_t *dev)
+{
+	sim_regfile_t *regfile = dev->state;
+
+	return regfile->regs[regfile->pointer++];
+}
+
+void
+sim_regfile_init(sim_device_t *dev, sim_regfile_t *regfile, uint8_t address, bool writable)
+{
+	memset(regfile, 0, sizeof(*regfile));
+	regfile->writable = writable;
+
+	dev->address = address;
+	dev->start = sim_regfile_start;
+	dev->write = sim_regfile_write;
+	dev->read = sim_regfile_read;
+	dev->stop = NULL;
+	dev->state = regfile;
+}
+
+static bool
+sim_nack_start(sim_device_t *dev, bool is_read)
+{
+	(void)dev;
+	(void)is_read;
+
+	return true;
+}
+
+static bool
+sim_nack_write(sim_device_t *dev, uint8_t data)
+{
+	(void)dev;
+	(void)data;
+
+	return false;
+}
+
+static uint8_t
+sim_nack_read(sim_device_t *dev)
+{
+	(void)dev;
+
+	return 0xFF;
+}
+
+void
+sim_nack_init(sim_device_t *dev, uint8_t address)
+{
+	dev->address = address;
+	dev->start = sim_nack_start;
+	dev->write = sim_nack_write;
+	dev->read = sim_nack_read;
+	dev->stop = NULL;
+	dev->state = NULL;
+}
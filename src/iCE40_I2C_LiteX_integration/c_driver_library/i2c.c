@@ -22,496 +22,2190 @@
 
 
 #include <generated/csr.h>
+#include <generated/mem.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
+#ifdef I2C_DELAY_WFI
+#include <generated/soc.h>
+#include <irq.h>
+#endif
 #include "i2c.h"
+#include "sb_i2c.h"
 #include "sb_i2c_regs.h"
 
-const uint16_t 	prescaler		= CONFIG_CLOCK_FREQUENCY / kSB_I2C_CONFIG_TARGET_I2C_FREQUENCY / 4 - 1;
-const uint32_t 	cycles_per_i2c_cycle	= prescaler * 4;
+/*
+ * 	The delays sleep in WFI until a one-shot timer0 interrupt, if the SoC has its interrupt and
+ * 	the uptime to count the short ones
+ */
+#if defined(I2C_DELAY_WFI) && defined(TIMER0_INTERRUPT) && defined(CSR_TIMER0_UPTIME_CYCLES_ADDR)
+#define SB_I2C_DELAY_WFI
+#endif
+
+/*
+ * 	System Bus access method, the fastest one available in the SoC is used:
+ * 	* SB_I2C_ACCESS_WISHBONE: the SB_I2C registers are mapped in the CPU address space
+ * 	* SB_I2C_ACCESS_SBCMD: a single CSR write performs the System Bus handshake in gateware
+ * 	* SB_I2C_ACCESS_CSR: the System Bus handshake is done in software
+ */
+#if defined(SB_I2C_REGS_BASE)
+#define SB_I2C_ACCESS_WISHBONE
+#elif defined(CSR_SB_I2C_SBCMD_ADDR)
+#define SB_I2C_ACCESS_SBCMD
+#else
+#define SB_I2C_ACCESS_CSR
+#endif
+
+#ifdef SB_I2C_ACCESS_WISHBONE
+/*
+ * 	Each SB_I2C register is mapped to a 32-bit word of the Wishbone bridge
+ */
+#define SB_I2C_REG(bus, address) (*(volatile uint32_t *)((bus)->regs_base + ((uint32_t)(address) << 2)))
+#endif
+
+/*
+ * 	Registers of i2c_bus_t shadow_valid, whose last written value is known to the driver
+ */
+typedef enum SB_I2C_SHADOW_enum
+{
+	kSB_I2C_SHADOW_SBCTRL_bm = (0b1 << 0),
+	kSB_I2C_SHADOW_SBADRI_bm = (0b1 << 1),
+	kSB_I2C_SHADOW_SBDATI_bm = (0b1 << 2),
+	kSB_I2C_SHADOW_SPEED_bm  = (0b1 << 3), /* I2CBRLSB, I2CBRMSB and I2CCR1 */
+} SB_I2C_SHADOW_t;
+
+#ifdef SB_I2C_REGS_BASE
+i2c_bus_t i2c_bus_default = I2C_BUS_INIT(CSR_SB_I2C_BASE, SB_I2C_REGS_BASE);
+#else
+i2c_bus_t i2c_bus_default = I2C_BUS_INIT(CSR_SB_I2C_BASE, 0);
+#endif
+
+/**
+ * 	@brief Takes the lock of an I2C bus, if it has one, marks it as owned, and forgets the values
+ * 	last written to its System Bus CSRs, see sb_i2c_shadow_invalidate().
+ *
+ * 	@param bus is the I2C bus.
+ */
+static inline void
+i2c_bus_lock(i2c_bus_t *bus)
+{
+#ifndef I2C_BUS_NO_LOCKING
+	if (bus->lock != NULL)
+	{
+		bus->lock(bus->lock_context);
+	}
+#endif
+
+	/*
+	 * 	Set even without locking, for the interrupt handlers which use the I2C bus to hold off
+	 */
+	bus->owned = true;
+	sb_i2c_shadow_invalidate(bus);
+}
 
-bool sbrwi_status  = false;
-bool sbstbi_status = false;
+/**
+ * 	@brief Marks an I2C bus as no longer owned, and releases its lock, if it has one.
+ *
+ * 	@param bus is the I2C bus.
+ */
+static inline void
+i2c_bus_unlock(i2c_bus_t *bus)
+{
+	bus->owned = false;
+
+#ifndef I2C_BUS_NO_LOCKING
+	if (bus->unlock != NULL)
+	{
+		bus->unlock(bus->lock_context);
+	}
+#endif
+}
 
+#ifdef SB_I2C_ACCESS_CSR
 /**
  * 	@brief Sets the System Bus Control register.
  *
+ * 	@param bus is the I2C bus.
  */
 void
-sb_i2c_set_sbctrl(void)
+sb_i2c_set_sbctrl(i2c_bus_t *bus)
 {
-	sb_i2c_sbctrl_write(
+	csr_write_simple(
 		0
-		| sbrwi_status << CSR_SB_I2C_SBCTRL_SBRWI_OFFSET
-		| sbstbi_status << CSR_SB_I2C_SBCTRL_SBSTBI_OFFSET
+		| bus->sbrwi_status << CSR_SB_I2C_SBCTRL_SBRWI_OFFSET
+		| bus->sbstbi_status << CSR_SB_I2C_SBCTRL_SBSTBI_OFFSET,
+		SB_I2C_CSR(bus, SBCTRL)
 	);
+	bus->shadow_valid |= kSB_I2C_SHADOW_SBCTRL_bm;
 }
 
 /**
  * 	@brief Sets the System Bus Read/Write signal on the System Bus Control register.
  *
+ * 	@param bus is the I2C bus.
  * 	@param value is the value to set (0 or 1).
  */
 void
-sb_i2c_sbctrl_sbrwi_write(uint8_t value)
+sb_i2c_sbctrl_sbrwi_write(i2c_bus_t *bus, uint8_t value)
 {
-	sbrwi_status = value;
-	sb_i2c_set_sbctrl();
+	/*
+	 * 	The Read/Write signal is left as is after an access, so it is only written when the
+	 * 	direction changes
+	 */
+	if ((bus->shadow_valid & kSB_I2C_SHADOW_SBCTRL_bm) && bus->sbrwi_status == value)
+	{
+		bus->skipped_writes++;
+		return;
+	}
+
+	bus->sbrwi_status = value;
+	sb_i2c_set_sbctrl(bus);
 }
 
 /**
  * 	@brief Sets the System Bus Strobe signal on the System Bus Control register.
  *
+ * 	@param bus is the I2C bus.
  * 	@param value is the value to set (0 or 1).
  */
 void
-sb_i2c_sbctrl_sbstbi_write(uint8_t value)
+sb_i2c_sbctrl_sbstbi_write(i2c_bus_t *bus, uint8_t value)
 {
-	sbstbi_status = value;
-	sb_i2c_set_sbctrl();
+	bus->sbstbi_status = value;
+	sb_i2c_set_sbctrl(bus);
 }
 
 /**
  * 	@brief Sets the System Bus as a read command.
+ *
+ * 	@param bus is the I2C bus.
  */
 void
-sb_i2c_set_read_cmd(void)
+sb_i2c_set_read_cmd(i2c_bus_t *bus)
 {
-	sb_i2c_sbctrl_sbrwi_write(0);
+	sb_i2c_sbctrl_sbrwi_write(bus, 0);
 }
 
 /**
  * 	@brief Sets the System Bus as a write command.
  *
+ * 	@param bus is the I2C bus.
  */
 void
-sb_i2c_set_write_cmd(void)
+sb_i2c_set_write_cmd(i2c_bus_t *bus)
 {
-	sb_i2c_sbctrl_sbrwi_write(1);
+	sb_i2c_sbctrl_sbrwi_write(bus, 1);
 }
 
 /**
  * 	@brief Sets the System Bus as not ready.
  *
+ * 	@param bus is the I2C bus.
  */
 void
-sb_i2c_set_not_ready_cmd(void)
+sb_i2c_set_not_ready_cmd(i2c_bus_t *bus)
 {
-	sb_i2c_sbctrl_sbstbi_write(0);
+	sb_i2c_sbctrl_sbstbi_write(bus, 0);
 }
 
 /**
  * 	@brief Sets the System Bus as ready.
  *
+ * 	@param bus is the I2C bus.
  */
 void
-sb_i2c_set_ready_cmd(void)
+sb_i2c_set_ready_cmd(i2c_bus_t *bus)
 {
-	sb_i2c_sbctrl_sbstbi_write(1);
+	sb_i2c_sbctrl_sbstbi_write(bus, 1);
 }
 
 /**
  * 	@brief Gets the System Bus Acknowledgement value.
  *
+ * 	@param bus is the I2C bus.
  * 	@return true when the System Bus Acknowledgement is set, so the command was received.
  * 	@return false when the System Bus Acknowledgement is not set, so the command was not yet received.
  */
 bool
-sb_i2c_get_sb_ack(void)
+sb_i2c_get_sb_ack(i2c_bus_t *bus)
 {
-	return sb_i2c_sbstatus_read() & (1 << CSR_SB_I2C_SBSTATUS_SBACKO_OFFSET);
+	return csr_read_simple(SB_I2C_CSR(bus, SBSTATUS)) & (1 << CSR_SB_I2C_SBSTATUS_SBACKO_OFFSET);
 }
 
 /**
  * 	@brief Sets the System Bus Register Address.
  *
+ * 	@param bus is the I2C bus.
  * 	@param address is the register address to set.
  */
 void
-sb_i2c_set_reg_addr(SB_I2C_REGS_t address)
+sb_i2c_set_reg_addr(i2c_bus_t *bus, SB_I2C_REGS_t address)
 {
-	sb_i2c_sbadri_write(address);
+	/*
+	 * 	Polling loops read the same register over and over
+	 */
+	if ((bus->shadow_valid & kSB_I2C_SHADOW_SBADRI_bm) && bus->shadow_sbadri == address)
+	{
+		bus->skipped_writes++;
+		return;
+	}
+
+	csr_write_simple(address, SB_I2C_CSR(bus, SBADRI));
+	bus->shadow_sbadri = address;
+	bus->shadow_valid |= kSB_I2C_SHADOW_SBADRI_bm;
 }
 
 /**
  * 	@brief Sets the System Bus Data Input.
  *
+ * 	@param bus is the I2C bus.
  * 	@param data is the data to set.
  */
 void
-sb_i2c_set_data(uint8_t data)
+sb_i2c_set_data(i2c_bus_t *bus, uint8_t data)
 {
-	sb_i2c_sbdati_write(data);
+	if ((bus->shadow_valid & kSB_I2C_SHADOW_SBDATI_bm) && bus->shadow_sbdati == data)
+	{
+		bus->skipped_writes++;
+		return;
+	}
+
+	csr_write_simple(data, SB_I2C_CSR(bus, SBDATI));
+	bus->shadow_sbdati = data;
+	bus->shadow_valid |= kSB_I2C_SHADOW_SBDATI_bm;
 }
 
 /**
  * 	@brief Gets the System Bus Data Output.
  *
+ * 	@param bus is the I2C bus.
  * 	@return uint8_t the data.
  */
 uint8_t
-sb_i2c_get_data(void)
+sb_i2c_get_data(i2c_bus_t *bus)
+{
+	return csr_read_simple(SB_I2C_CSR(bus, SBDATO));
+}
+#endif
+
+void
+sb_i2c_shadow_invalidate(i2c_bus_t *bus)
+{
+	bus->shadow_valid &= ~(0
+		| kSB_I2C_SHADOW_SBCTRL_bm
+		| kSB_I2C_SHADOW_SBADRI_bm
+		| kSB_I2C_SHADOW_SBDATI_bm
+	);
+}
+
+#if defined(SB_I2C_ACCESS_SBCMD) && defined(CSR_SB_I2C_SBCMD_STATUS_FULL_OFFSET)
+/**
+ * 	@brief Waits for space in the System Bus command FIFO, a command written while it is full
+ * 	is dropped by the gateware.
+ *
+ * 	@param bus is the I2C bus.
+ */
+static void
+sb_i2c_sbcmd_wait_space(i2c_bus_t *bus)
+{
+	while (csr_read_simple(SB_I2C_CSR(bus, SBCMD_STATUS)) & (1 << CSR_SB_I2C_SBCMD_STATUS_FULL_OFFSET));
+}
+#elif defined(SB_I2C_ACCESS_SBCMD)
+/*
+ * 	Gateware without the command FIFO holds a single pending command, wait for it to complete
+ */
+static void
+sb_i2c_sbcmd_wait_space(i2c_bus_t *bus)
 {
-	return sb_i2c_sbdato_read();
+	while (csr_read_simple(SB_I2C_CSR(bus, SBCMD_STATUS)) & (1 << CSR_SB_I2C_SBCMD_STATUS_BUSY_OFFSET));
 }
+#endif
 
 /**
  * 	@brief Sets a System Bus Register.
  *
+ * 	@param bus is the I2C bus.
  * 	@param address is the register address to set.
  * 	@param data is the data to set.
  */
 void
-sb_i2c_set_register(SB_I2C_REGS_t address, uint8_t data)
+sb_i2c_set_register(i2c_bus_t *bus, SB_I2C_REGS_t address, uint8_t data)
 {
+#if defined(SB_I2C_ACCESS_WISHBONE)
+	/*
+	 * 	The bridge holds the bus until the System Bus Acknowledgement
+	 */
+	SB_I2C_REG(bus, address) = data;
+#elif defined(SB_I2C_ACCESS_SBCMD)
+	/*
+	 * 	Issue the whole System Bus write as a single command, the strobe and the wait for the
+	 * 	System Bus Acknowledgement are done in gateware
+	 */
+	sb_i2c_sbcmd_wait_space(bus);
+	csr_write_simple(
+		0
+		| data << CSR_SB_I2C_SBCMD_DATA_OFFSET
+		| address << CSR_SB_I2C_SBCMD_ADDR_OFFSET
+		| 1 << CSR_SB_I2C_SBCMD_RW_OFFSET,
+		SB_I2C_CSR(bus, SBCMD)
+	);
+#else
 	/*
 	 * 	Set the System Bus Register Address, and the data
 	 */
-	sb_i2c_set_reg_addr(address);
-	sb_i2c_set_data(data);
-	sb_i2c_set_write_cmd();
+	sb_i2c_set_reg_addr(bus, address);
+	sb_i2c_set_data(bus, data);
+	sb_i2c_set_write_cmd(bus);
 
 	/*
 	 * 	Indicate that the System Bus has a ready command
 	 */
-	sb_i2c_set_ready_cmd();
+	sb_i2c_set_ready_cmd(bus);
 
 	/*
 	 * 	Wait for the System Bus Acknowledgement, so the command was received
 	 */
-	while (!sb_i2c_get_sb_ack());
+	while (!sb_i2c_get_sb_ack(bus));
 
 	/*
-	 * 	Reset System Bus signals
+	 * 	Reset the System Bus Strobe. The Read/Write signal is only set again by an access in the
+	 * 	other direction
 	 */
-	sb_i2c_set_not_ready_cmd();
-	sb_i2c_set_read_cmd();
+	sb_i2c_set_not_ready_cmd(bus);
+#endif
 }
 
 /**
  * 	@brief Gets a System Bus Register.
  *
+ * 	@param bus is the I2C bus.
  * 	@param address is the register address to get.
  * 	@return uint8_t the data.
  */
 uint8_t
-sb_i2c_get_register(SB_I2C_REGS_t address)
+sb_i2c_get_register(i2c_bus_t *bus, SB_I2C_REGS_t address)
 {
+#if defined(SB_I2C_ACCESS_WISHBONE)
+	/*
+	 * 	The bridge holds the bus until the System Bus Acknowledgement
+	 */
+	return SB_I2C_REG(bus, address);
+#elif defined(SB_I2C_ACCESS_SBCMD)
+	uint32_t status;
+
+	/*
+	 * 	Issue the whole System Bus read as a single command
+	 */
+	sb_i2c_sbcmd_wait_space(bus);
+	csr_write_simple(
+		0
+		| address << CSR_SB_I2C_SBCMD_ADDR_OFFSET
+		| 0 << CSR_SB_I2C_SBCMD_RW_OFFSET,
+		SB_I2C_CSR(bus, SBCMD)
+	);
+
+	/*
+	 * 	Wait for the command to complete. The System Bus Acknowledgement normally arrives before
+	 * 	the CPU can read the status back, so this loop rarely iterates.
+	 */
+	do
+	{
+		status = csr_read_simple(SB_I2C_CSR(bus, SBCMD_STATUS));
+	} while (status & (1 << CSR_SB_I2C_SBCMD_STATUS_BUSY_OFFSET));
+
+	/*
+	 * 	Return the data
+	 */
+	return status >> CSR_SB_I2C_SBCMD_STATUS_DATA_OFFSET;
+#else
 	/*
 	 * 	Set the System Bus Register Address, and indicate that the System Bus is a read command
 	 */
-	sb_i2c_set_reg_addr(address);
-	sb_i2c_set_read_cmd();
+	sb_i2c_set_reg_addr(bus, address);
+	sb_i2c_set_read_cmd(bus);
 
 	/*
 	 * 	Indicate that the System Bus has a ready command
 	 */
-	sb_i2c_set_ready_cmd();
+	sb_i2c_set_ready_cmd(bus);
 
 	/*
 	 * 	Wait for the System Bus Acknowledgement, so the command was received
 	 */
-	while (!sb_i2c_get_sb_ack());
+	while (!sb_i2c_get_sb_ack(bus));
 
 	/*
 	 * 	Get the data
 	 */
-	uint8_t data = sb_i2c_get_data();
+	uint8_t data = sb_i2c_get_data(bus);
 
 	/*
 	 * 	Reset System Bus signals
 	 */
-	sb_i2c_set_not_ready_cmd();
+	sb_i2c_set_not_ready_cmd(bus);
 
 	/*
 	 * 	Return the data
 	 */
 	return data;
+#endif
 }
 
 /**
- * 	@brief Tries to reset the I2C bus.
+ * 	@brief Releases the I2C bus, and sets the I2C control and clock prescaler registers.
+ *
+ * 	@param bus is the I2C bus.
  */
-void
-i2c_reset(void)
+static void
+sb_i2c_configure(i2c_bus_t *bus)
 {
 	/*
-	 * 	Try to release the I2C bus
+	 * 	Release the I2C bus
 	 */
-	i2c_end();
+	sb_i2c_stop(bus);
 
 	/*
-	 * 	Send a dummy command to 0x00
+	 * 	Set the I2C control register
 	 */
-	i2c_begin(0x00, false);
-	i2c_end();
+	sb_i2c_set_register(bus,
+		kSB_I2C_REGS_I2CCR1,
+		0
+		| bus->sda_del
+		| (bus->general_call ? kI2CCR1_GCEN_bm : 0)
+		| kI2CCR1_I2CEN_bm
+	);
 
 	/*
-	 * 	Reinitialize the I2C Hard IP
+	 * 	Set Clock Prescaler. i2c_init() and the timeouts reinitialize the I2C core with the
+	 * 	prescaler it already has, which is then not rewritten
 	 */
-	i2c_init();
+	bool is_known = bus->shadow_valid & kSB_I2C_SHADOW_SPEED_bm;
 
-	/*
-	 * 	Release the I2C bus
-	 */
-	i2c_end();
+	if (!is_known || (bus->prescaler & 0xFF) != (bus->active_prescaler & 0xFF))
+	{
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CBRLSB, bus->prescaler & 0xFF);
+	}
+	else
+	{
+		bus->skipped_writes++;
+	}
 
-	/*
-	 * 	Send a dummy command to 0x00
-	 */
-	i2c_begin(0x00, false);
-	i2c_end();
+	if (!is_known || (bus->prescaler >> 8) != (bus->active_prescaler >> 8))
+	{
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CBRMSB, bus->prescaler >> 8);
+	}
+	else
+	{
+		bus->skipped_writes++;
+	}
+
+	bus->active_prescaler = bus->prescaler;
+	bus->active_sda_del = bus->sda_del;
+	bus->shadow_valid |= kSB_I2C_SHADOW_SPEED_bm;
 }
 
 /**
- * 	@brief Waits for the I2C bus to be ready.
+ * 	@brief Sets the I2C bus speed, rewriting only the registers which change.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param prescaler is the I2C clock prescaler.
+ * 	@param sda_del is the SDA output delay (kI2CCR1_SDA_DEL_SEL_*_gc).
  */
-void
-sb_i2c_wait_for_trrdy(void)
+static void
+sb_i2c_apply_speed(i2c_bus_t *bus, uint16_t prescaler, uint8_t sda_del)
 {
-	for (uint8_t timeout = 0; timeout < kSB_I2C_CONFIG_TRRDY_TIMEOUT; timeout++)
+	bool is_known = bus->shadow_valid & kSB_I2C_SHADOW_SPEED_bm;
+
+	if (!is_known || sda_del != bus->active_sda_del)
 	{
-		if ((sb_i2c_get_register(kSB_I2C_REGS_I2CSR) & kI2CSR_TRRDY_bm) != 0)
-		{
-			return;
-		}
+		/*
+		 * 	A write to I2CCR1 resets the I2C core, so it is only done when the SDA output delay
+		 * 	changes
+		 */
+		sb_i2c_set_register(bus,
+			kSB_I2C_REGS_I2CCR1,
+			0
+			| sda_del
+			| (bus->general_call ? kI2CCR1_GCEN_bm : 0)
+			| kI2CCR1_I2CEN_bm
+		);
+		bus->active_sda_del = sda_del;
 	}
 
-	/*
-	 * 	Waiting has timed out, so try to reset the I2C bus
-	 */
-	i2c_reset();
+	if (!is_known || (prescaler & 0xFF) != (bus->active_prescaler & 0xFF))
+	{
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CBRLSB, prescaler & 0xFF);
+	}
+
+	if (!is_known || (prescaler >> 8) != (bus->active_prescaler >> 8))
+	{
+		/*
+		 * 	A write to I2CBRMSB also resets the I2C core
+		 */
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CBRMSB, prescaler >> 8);
+	}
+
+	bus->active_prescaler = prescaler;
+	bus->shadow_valid |= kSB_I2C_SHADOW_SPEED_bm;
 }
 
-/**
- * 	@brief Waits for the I2C bus to be in the Master receiving / Slave transmitting mode.
- */
 void
-sb_i2c_wait_for_srw(void)
+sb_i2c_select_speed(i2c_bus_t *bus, uint8_t address)
 {
-	for (uint8_t timeout = 0; timeout < kSB_I2C_CONFIG_SRW_TIMEOUT; timeout++)
+	uint16_t prescaler = bus->prescaler;
+	uint8_t sda_del = bus->sda_del;
+
+	bus->stretch = false;
+	bus->active_profile = 0;
+
+	for (uint8_t i = 0; i < bus->speed_count; i++)
 	{
-		if ((sb_i2c_get_register(kSB_I2C_REGS_I2CSR) & kI2CSR_SRW_bm) != 0)
+		if (bus->speeds[i].address == address)
 		{
-			return;
+			prescaler = bus->speeds[i].prescaler;
+			sda_del = bus->speeds[i].sda_del;
+			bus->stretch = bus->speeds[i].stretch == kI2C_STRETCH_ON;
+			bus->active_profile = i + 1;
+			break;
 		}
 	}
 
-	/*
-	 * 	Waiting has timed out, so try to reset the I2C bus
-	 */
-	i2c_reset();
+	if (!(bus->shadow_valid & kSB_I2C_SHADOW_SPEED_bm) || prescaler != bus->active_prescaler || sda_del != bus->active_sda_del)
+	{
+		sb_i2c_apply_speed(bus, prescaler, sda_del);
+	}
 }
 
 /**
- * 	@brief Waits for the given number of I2C cycles.
+ * 	@brief Checks that an I2C bus frequency can be reached without exceeding it, that is that it is
+ * 	not below the frequency of the largest prescaler, CONFIG_CLOCK_FREQUENCY / 4096.
  *
- * 	@param cycles is the number of cycles to wait for.
+ * 	@param frequency is the I2C bus frequency in Hz.
+ * 	@return true if sb_i2c_speed_prescaler() gives a frequency up to the given one.
+ * 	@return false if frequency is 0, or too low.
  */
-void
-i2c_wait_for_i2c_cycles(uint32_t cycles)
+static bool
+sb_i2c_speed_valid(uint32_t frequency)
 {
-	while (cycles--)
-	{
-		for (uint32_t i = 0; i < cycles_per_i2c_cycle; i++)
-		{
-			asm("nop");
-		}
-	}
+	return (uint64_t)frequency * 4 * ((kI2CBRMSB_bm << 8 | kI2CBRLSB_bm) + 1) >= CONFIG_CLOCK_FREQUENCY;
 }
 
 /**
- * 	@brief Sends a command to the I2C bus, and then clears the command to avoid sending it again.
+ * 	@brief Gets the I2C clock prescaler of the highest I2C bus frequency up to the given one, which
+ * 	must be checked with sb_i2c_speed_valid().
  *
- * 	@param command is the command to send.
+ * 	@param frequency is the I2C bus frequency in Hz.
+ * 	@return uint16_t the I2C clock prescaler.
  */
-void
-sb_i2c_send_command(uint8_t command)
+static uint16_t
+sb_i2c_speed_prescaler(uint32_t frequency)
 {
-	/*
-	 * 	Set the command
-	 */
-	sb_i2c_set_register(kSB_I2C_REGS_I2CCMDR, command);
+	if (frequency > kSB_I2C_CONFIG_MAX_I2C_FREQUENCY)
+	{
+		frequency = kSB_I2C_CONFIG_MAX_I2C_FREQUENCY;
+	}
 
 	/*
-	 * 	Clear the command, to avoid sending it again
+	 * 	The System Bus clock is divided by (prescaler + 1) * 4, rounded up to not exceed frequency
 	 */
-	sb_i2c_set_register(kSB_I2C_REGS_I2CCMDR, 0x00);
+	uint32_t divider = (CONFIG_CLOCK_FREQUENCY + 4 * frequency - 1) / (4 * frequency);
+
+	if (divider < 1)
+	{
+		divider = 1;
+	}
+
+	return divider - 1;
 }
 
-void
-i2c_init(void)
+/**
+ * 	@brief Gets the SDA output delay for an I2C bus frequency.
+ *
+ * 	@param frequency is the I2C bus frequency in Hz.
+ * 	@return uint8_t the SDA output delay (kI2CCR1_SDA_DEL_SEL_*_gc).
+ */
+static uint8_t
+sb_i2c_speed_sda_del(uint32_t frequency)
 {
 	/*
-	 * 	Release the I2C bus
-	 */
-	i2c_end();
-
-	/*
-	 * 	Set the I2C control register
+	 * 	Fast-mode Plus has a shorter SCL low period, so the data is set up sooner after it
 	 */
-	sb_i2c_set_register(
-		kSB_I2C_REGS_I2CCR1,
-		0
-		| kI2CCR1_SDA_DEL_SEL_300NS_gc
-		| kI2CCR1_I2CEN_bm
-	);
+	return frequency > 400000 ? kI2CCR1_SDA_DEL_SEL_75NS_gc : kI2CCR1_SDA_DEL_SEL_300NS_gc;
+}
 
-	/*
-	 * 	Set Clock Prescaler
-	 */
-	sb_i2c_set_register(kSB_I2C_REGS_I2CBRLSB, prescaler & 0xFF);
-	sb_i2c_set_register(kSB_I2C_REGS_I2CBRMSB, prescaler >> 8);
+/**
+ * 	@brief Gets the I2C bus frequency of an I2C clock prescaler.
+ *
+ * 	@param prescaler is the I2C clock prescaler.
+ * 	@return uint32_t the I2C bus frequency in Hz.
+ */
+static uint32_t
+sb_i2c_speed_frequency(uint16_t prescaler)
+{
+	return CONFIG_CLOCK_FREQUENCY / (((uint32_t)prescaler + 1) * 4);
 }
 
-void
-i2c_begin(uint8_t address, bool is_read_cmd)
+#ifdef CSR_SB_I2C_RECOVERY_CONTROL_ADDR
+/**
+ * 	@brief Runs the gateware bus recovery, which clocks a slave holding SDA low out of the byte in
+ * 	progress with up to 9 SCL pulses, and then sends a STOP. It takes at most 23 SCL half periods.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@return true if both lines are released.
+ * 	@return false if a line is still held low.
+ */
+static bool
+sb_i2c_recover_lines(i2c_bus_t *bus)
 {
-	/*
-	 * 	Set the I2C slave address, and the read/write mode
-	 */
-	sb_i2c_set_register(kSB_I2C_REGS_I2CTXDR, address << 1 | (is_read_cmd ? 0b1 : 0b0));
+	uint32_t status;
 
 	/*
-	 * 	Send the slave address and mode
+	 * 	An SCL half period is 2 * (prescaler + 1) system clock cycles
 	 */
-	sb_i2c_send_command(
+	csr_write_simple(
 		0
-		| kI2CCMDR_CKSDIS_bm
-		| kI2CCMDR_WR_bm
-		| kI2CCMDR_STA_bm
+		| 1 << CSR_SB_I2C_RECOVERY_CONTROL_START_OFFSET
+		| (uint32_t)2 * (bus->active_prescaler + 1) << CSR_SB_I2C_RECOVERY_CONTROL_HALF_PERIOD_OFFSET,
+		SB_I2C_CSR(bus, RECOVERY_CONTROL)
 	);
 
-	/*
-	 * 	Check if it is a read command
-	 */
-	if (is_read_cmd)
+	do
 	{
-		/*
-		 * 	Wait for the System Bus to be in the Master receiving / Slave transmitting mode
-		 */
-		sb_i2c_wait_for_srw();
+		status = csr_read_simple(SB_I2C_CSR(bus, RECOVERY_STATUS));
+	} while (status & (1 << CSR_SB_I2C_RECOVERY_STATUS_BUSY_OFFSET));
 
-		/*
-		 * 	Set the I2C bus for slave writing
-		 */
-		sb_i2c_set_register(kSB_I2C_REGS_I2CCMDR,
-			0
-			| kI2CCMDR_CKSDIS_bm
-			| kI2CCMDR_RD_bm
-		);
-	}
-	else
-	{
-		/*
-		 * 	Wait for the System Bus to be ready
-		 */
-		sb_i2c_wait_for_trrdy();
-	}
+	return (status & (1 << CSR_SB_I2C_RECOVERY_STATUS_SCL_OFFSET)) &&
+		(status & (1 << CSR_SB_I2C_RECOVERY_STATUS_SDA_OFFSET));
 }
+#endif
 
-void
-i2c_write(uint8_t data)
+/**
+ * 	@brief Recovers the I2C Hard IP after a timeout, within a transaction, so without taking its
+ * 	lock. Frees SDA with the gateware bus recovery if a slave holds it low, releases the I2C bus
+ * 	and reinitializes the I2C Hard IP, without waiting on it, so it always returns.
+ *
+ * 	@param bus is the I2C bus.
+ */
+static void
+sb_i2c_reset(i2c_bus_t *bus)
 {
-	/*
-	 * 	Set the I2C data
-	 */
-	sb_i2c_set_register(kSB_I2C_REGS_I2CTXDR, data);
-
-	/*
-	 * 	Send the data
-	 */
-	sb_i2c_send_command(
-		0
-		| kI2CCMDR_CKSDIS_bm
-		| kI2CCMDR_WR_bm
-	);
+#ifdef CSR_SB_I2C_RECOVERY_CONTROL_ADDR
+	if (!(csr_read_simple(SB_I2C_CSR(bus, RECOVERY_STATUS)) & (1 << CSR_SB_I2C_RECOVERY_STATUS_SDA_OFFSET)))
+	{
+		sb_i2c_recover_lines(bus);
+	}
+#endif
 
-	/*
-	 * 	Wait for the System Bus to be ready
-	 */
-	sb_i2c_wait_for_trrdy();
+	sb_i2c_configure(bus);
 }
 
+/**
+ * 	@brief Gets the I2C Status Register.
+ *
+ * 	When the status mirror is present, this is a single CSR read of the value sampled in gateware.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@return uint8_t the I2C Status Register.
+ */
 uint8_t
-i2c_read(bool is_last_read)
+sb_i2c_get_status(i2c_bus_t *bus)
 {
+#ifdef CSR_SB_I2C_SBMIRROR_ADDR
+	uint32_t mirror;
+
 	/*
-	 * 	Check if it is the last read
+	 * 	Wait for a sample taken after the last System Bus access
 	 */
-	if (!is_last_read)
+	do
 	{
-		/*
-		 * 	Wait for the System Bus to be ready
-		 */
-		sb_i2c_wait_for_trrdy();
-
-		/*
-		 * 	Return the I2C data
-		 */
-		return sb_i2c_get_register(kSB_I2C_REGS_I2CRXDR);
-	}
+		mirror = csr_read_simple(SB_I2C_CSR(bus, SBMIRROR));
+	} while (!(mirror & (1 << CSR_SB_I2C_SBMIRROR_VALID_OFFSET)));
 
-	/*
-	 * 	Send a stop and ack I2C command
-	 */
-	sb_i2c_set_register(kSB_I2C_REGS_I2CCMDR,
-		0
-		| kI2CCMDR_CKSDIS_bm
-		| kI2CCMDR_ACK_bm
-		| kI2CCMDR_RD_bm
-		| kI2CCMDR_STO_bm
-	);
+	return mirror >> CSR_SB_I2C_SBMIRROR_I2CSR_OFFSET;
+#else
+	return sb_i2c_get_register(bus, kSB_I2C_REGS_I2CSR);
+#endif
+}
 
-	/*
-	 * 	Wait for the System Bus to be ready
-	 */
-	sb_i2c_wait_for_trrdy();
+/**
+ * 	@brief Scales a timeout, given in legacy CSR System Bus reads of the I2C Status Register, to the
+ * 	number of reads with the access method in use.
+ *
+ * 	@param timeout is the timeout.
+ * 	@return uint32_t the scaled timeout.
+ */
+uint32_t
+sb_i2c_scale_timeout(uint32_t timeout)
+{
+#if defined(CSR_SB_I2C_SBMIRROR_ADDR)
+	return timeout * kSB_I2C_CONFIG_STATUS_MIRROR_TIMEOUT_SCALE;
+#elif defined(SB_I2C_ACCESS_CSR)
+	return timeout;
+#else
+	return timeout * kSB_I2C_CONFIG_FAST_ACCESS_TIMEOUT_SCALE;
+#endif
+}
 
+void
+sb_i2c_deadline_start(i2c_bus_t *bus, i2c_timeout_t *timeout, uint32_t periods)
+{
+#ifdef CSR_TIMER0_UPTIME_CYCLES_ADDR
 	/*
-	 * 	Return the I2C data
+	 * 	An SCL period is 4 * (prescaler + 1) system clock cycles
 	 */
-	return sb_i2c_get_register(kSB_I2C_REGS_I2CRXDR);
+	timer0_uptime_latch_write(1);
+	timeout->deadline = timer0_uptime_cycles_read() + (uint64_t)periods * 4 * (bus->active_prescaler + 1);
+#else
+	(void)bus;
+	timeout->polls = (uint64_t)sb_i2c_scale_timeout(kSB_I2C_CONFIG_TRRDY_TIMEOUT) * periods / kSB_I2C_CONFIG_TIMEOUT_SCL_PERIODS;
+#endif
 }
 
 void
-i2c_end(void)
+sb_i2c_timeout_start(i2c_bus_t *bus, i2c_timeout_t *timeout)
 {
+	sb_i2c_deadline_start(bus, timeout, kSB_I2C_CONFIG_TIMEOUT_SCL_PERIODS);
+}
+
+bool
+sb_i2c_timeout_expired(i2c_timeout_t *timeout)
+{
+#ifdef CSR_TIMER0_UPTIME_CYCLES_ADDR
+	timer0_uptime_latch_write(1);
+
+	return timer0_uptime_cycles_read() > timeout->deadline;
+#else
+	return timeout->polls-- == 0;
+#endif
+}
+
+/**
+ * 	@brief Waits for any of the given I2C Status Register bits to be set, or, with is_set false,
+ * 	for all of them to be clear.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param mask is the I2C Status Register bit mask to wait for.
+ * 	@param is_set sets if the bits are waited to be set or clear.
+ * 	@param status is set to the last I2C Status Register read, for the caller to check the
+ * 	acknowledge and overrun bits without another read.
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, kI2C_STATUS_ARB_LOST or kI2C_STATUS_TIMEOUT.
+ */
+static I2C_STATUS_t
+sb_i2c_wait(i2c_bus_t *bus, uint8_t mask, bool is_set, uint8_t *status)
+{
+	i2c_timeout_t timeout;
+
 	/*
-	 * 	Send a stop I2C command
+	 * 	The timeout is only started if the first read is not the awaited one, which is the common
+	 * 	case of the burst functions, so it costs nothing then. An arbitration loss frees the
+	 * 	transmit register as well, so it is checked first
 	 */
-	sb_i2c_set_register(kSB_I2C_REGS_I2CCMDR,
-		0
-		| kI2CCMDR_CKSDIS_bm
-		| kI2CCMDR_STO_bm
-	);
+	*status = sb_i2c_get_status(bus);
+	if (((*status & mask) != 0) == is_set && !(*status & kI2CSR_ARBL_bm))
+	{
+		return kI2C_STATUS_OK;
+	}
+
+	sb_i2c_timeout_start(bus, &timeout);
+
+	for (;;)
+	{
+		if (*status & kI2CSR_ARBL_bm)
+		{
+			return kI2C_STATUS_ARB_LOST;
+		}
+
+		if (sb_i2c_timeout_expired(&timeout))
+		{
+			return kI2C_STATUS_TIMEOUT;
+		}
+
+		*status = sb_i2c_get_status(bus);
+		if (((*status & mask) != 0) == is_set)
+		{
+			return kI2C_STATUS_OK;
+		}
+	}
 }
 
 bool
-i2c_scan(uint8_t address)
+sb_i2c_address_done(uint8_t status, I2C_STATUS_t *result)
 {
+	if (status & kI2CSR_ARBL_bm)
+	{
+		*result = kI2C_STATUS_ARB_LOST;
+		return true;
+	}
+
+	if (status & kI2CSR_SRW_bm)
+	{
+		*result = kI2C_STATUS_OK;
+		return true;
+	}
+
 	/*
-	 * 	Send a dummy write command to the given address
+	 * 	The address has left the transmit register and is no longer being sent, without the
+	 * 	receiving mode: the slave did not acknowledge it
 	 */
-	i2c_begin(address, false);
+	if ((status & (kI2CSR_TRRDY_bm | kI2CSR_TIP_bm | kI2CSR_RARC_bm)) == (kI2CSR_TRRDY_bm | kI2CSR_RARC_bm))
+	{
+		*result = kI2C_STATUS_NACK;
+		return true;
+	}
+
+	return false;
+}
+
+I2C_STATUS_t
+sb_i2c_wait_for_srw(i2c_bus_t *bus)
+{
+	i2c_timeout_t timeout;
+	I2C_STATUS_t result;
+
+	if (sb_i2c_address_done(sb_i2c_get_status(bus), &result))
+	{
+		return result;
+	}
+
+	sb_i2c_timeout_start(bus, &timeout);
+
+	while (!sb_i2c_address_done(sb_i2c_get_status(bus), &result))
+	{
+		if (sb_i2c_timeout_expired(&timeout))
+		{
+			return kI2C_STATUS_TIMEOUT;
+		}
+	}
+
+	return result;
+}
+
+/**
+ * 	@brief Waits for the I2C bus to be ready, and checks the acknowledge of the previous byte.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error.
+ */
+static I2C_STATUS_t
+sb_i2c_wait_for_trrdy(i2c_bus_t *bus)
+{
+	uint8_t status;
+	I2C_STATUS_t result = sb_i2c_wait(bus, kI2CSR_TRRDY_bm, true, &status);
+
+	if (result == kI2C_STATUS_OK && (status & kI2CSR_RARC_bm))
+	{
+		return kI2C_STATUS_NACK;
+	}
+
+	return result;
+}
+
+/**
+ * 	@brief Waits for a received byte, and checks that none was overwritten.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error.
+ */
+static I2C_STATUS_t
+sb_i2c_wait_for_rx(i2c_bus_t *bus)
+{
+	uint8_t status;
+	I2C_STATUS_t result = sb_i2c_wait(bus, kI2CSR_TRRDY_bm, true, &status);
 
 	/*
-	 * 	Send a dummy zero
+	 * 	TROE without RARC is an overrun, with RARC it is the NACK of the last byte
 	 */
-	i2c_write(0x00);
+	if (result == kI2C_STATUS_OK && (status & kI2CSR_TROE_bm) && !(status & kI2CSR_RARC_bm))
+	{
+		return kI2C_STATUS_OVERRUN;
+	}
+
+	return result;
+}
+
+I2C_STATUS_t
+sb_i2c_wait_for_ack(i2c_bus_t *bus)
+{
+	uint8_t status;
+	I2C_STATUS_t result = sb_i2c_wait(bus, kI2CSR_TIP_bm, false, &status);
+
+	if (result == kI2C_STATUS_OK && (status & kI2CSR_RARC_bm))
+	{
+		return kI2C_STATUS_NACK;
+	}
+
+	return result;
+}
+
+/**
+ * 	@brief Ends a transaction: waits for the last byte written to be sent and checks its
+ * 	acknowledge, and then sends a STOP. Not after a timeout, which sb_i2c_result() recovers from,
+ * 	nor after an arbitration loss, as the I2C bus is not driven anymore.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param status is the status of the transaction so far.
+ * 	@param is_write sets if the last byte was written.
+ * 	@return I2C_STATUS_t the status of the transaction.
+ */
+static I2C_STATUS_t
+sb_i2c_finish(i2c_bus_t *bus, I2C_STATUS_t status, bool is_write)
+{
+	if (status == kI2C_STATUS_OK && is_write)
+	{
+		status = sb_i2c_wait_for_ack(bus);
+	}
+
+	if (status != kI2C_STATUS_TIMEOUT && status != kI2C_STATUS_ARB_LOST)
+	{
+		sb_i2c_stop(bus);
+	}
+
+	return status;
+}
+
+/**
+ * 	@brief Records the status of a call on an I2C bus, and resets the I2C Hard IP after a timeout.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param status is the status of the call.
+ * 	@return I2C_STATUS_t the status.
+ */
+static I2C_STATUS_t
+sb_i2c_result(i2c_bus_t *bus, I2C_STATUS_t status)
+{
+	if (status == kI2C_STATUS_TIMEOUT)
+	{
+		sb_i2c_reset(bus);
+	}
+	if (status == kI2C_STATUS_ARB_LOST && bus->arb_losses != UINT32_MAX)
+	{
+		bus->arb_losses++;
+	}
+	sb_i2c_monitor(bus, status);
+
+	return bus->status = status;
+}
+
+void
+sb_i2c_monitor(i2c_bus_t *bus, I2C_STATUS_t status)
+{
+	if (status != kI2C_STATUS_OVERRUN || bus->active_profile == 0)
+	{
+		return;
+	}
+
+	i2c_speed_profile_t *profile = &bus->speeds[bus->active_profile - 1];
+
+	if (profile->overruns != UINT16_MAX)
+	{
+		profile->overruns++;
+	}
 
 	/*
-	 * 	Check if the slave acknowledged the command
+	 * 	The device sends faster than the CPU reads, so hold SCL low from its next transaction on
 	 */
-	bool ack = !(sb_i2c_get_register(kSB_I2C_REGS_I2CSR) & kI2CSR_RARC_bm);
+	if (profile->stretch == kI2C_STRETCH_AUTO)
+	{
+		profile->stretch = kI2C_STRETCH_ON;
+	}
+}
+
+#ifdef SB_I2C_DELAY_WFI
+/**
+ * 	@brief Sleeps in WFI for at least the given number of system clock cycles, woken up by a
+ * 	one-shot timer0 interrupt. The countdown and the interrupt of timer0 are reserved to the
+ * 	driver, as the LiteX timer has no compare register to sleep on without reloading them; only
+ * 	its uptime is left to the application. The interrupts are only disabled from the check of the
+ * 	uptime to the wake-up, which any enabled interrupt ends, and are taken before sleeping again.
+ * 	The timer0 interrupt is only unmasked while they are disabled, as the SoC interrupt handler
+ * 	does not handle it, and timer0 is left disabled, with its event cleared.
+ *
+ * 	@param cycles is the number of system clock cycles to sleep for.
+ */
+static void
+sb_i2c_sleep(uint32_t cycles)
+{
+	unsigned int ie = irq_getie();
+	unsigned int mask = irq_getmask();
+	unsigned int others = mask & ~(1 << TIMER0_INTERRUPT);
+
+	irq_setmask(others);
+	timer0_uptime_latch_write(1);
+	uint64_t wake = timer0_uptime_cycles_read() + cycles;
+
+	timer0_en_write(0);
+	timer0_reload_write(0);
+	timer0_load_write(cycles);
+	timer0_ev_pending_write(1);
+	timer0_ev_enable_write(1);
+	timer0_en_write(1);
 
 	/*
-	 * 	Release the I2C bus
+	 * 	The one-shot expires at or after the wake-up time, so once its event is set, the loop
+	 * 	ends, and the event is left pending until then
+	 */
+	for (;;)
+	{
+		irq_setie(0);
+		timer0_uptime_latch_write(1);
+		if (timer0_uptime_cycles_read() >= wake)
+		{
+			break;
+		}
+
+		irq_setmask(others | (1 << TIMER0_INTERRUPT));
+		if (!(timer0_ev_pending_read() & 1))
+		{
+			asm volatile("wfi");
+		}
+		irq_setmask(others);
+		irq_setie(ie);
+	}
+
+	timer0_en_write(0);
+	timer0_ev_enable_write(0);
+	timer0_ev_pending_write(1);
+	irq_setmask(mask);
+	irq_setie(ie);
+}
+#endif
+
+/**
+ * 	@brief Waits for the given number of I2C cycles at the given I2C clock prescaler: until a
+ * 	deadline on the uptime of timer0, after sleeping through most of a long delay with
+ * 	I2C_DELAY_WFI, or else in a busy loop.
+ *
+ * 	@param prescaler is the I2C clock prescaler.
+ * 	@param cycles is the number of cycles to wait for.
+ */
+static void
+sb_i2c_delay(uint16_t prescaler, uint32_t cycles)
+{
+#ifdef CSR_TIMER0_UPTIME_CYCLES_ADDR
+	uint64_t duration = (uint64_t)cycles * 4 * (prescaler + 1);
+	uint64_t now;
+
+	timer0_uptime_latch_write(1);
+	now = timer0_uptime_cycles_read();
+
+	uint64_t deadline = now + duration;
+
+#ifdef SB_I2C_DELAY_WFI
+	/*
+	 * 	The last kSB_I2C_CONFIG_DELAY_WFI_MIN_CYCLES are spun, which absorbs the wake-up latency
+	 */
+	while (deadline - now >= 2 * (uint64_t)kSB_I2C_CONFIG_DELAY_WFI_MIN_CYCLES)
+	{
+		uint64_t sleep = deadline - now - kSB_I2C_CONFIG_DELAY_WFI_MIN_CYCLES;
+
+		sb_i2c_sleep(sleep < UINT32_MAX ? (uint32_t)sleep : UINT32_MAX);
+		timer0_uptime_latch_write(1);
+		now = timer0_uptime_cycles_read();
+	}
+#endif
+
+	while (now < deadline)
+	{
+		timer0_uptime_latch_write(1);
+		now = timer0_uptime_cycles_read();
+	}
+#else
+	while (cycles--)
+	{
+		for (uint32_t i = 0; i < prescaler * 4; i++)
+		{
+			asm("nop");
+		}
+	}
+#endif
+}
+
+void
+i2c_bus_wait_for_i2c_cycles(i2c_bus_t *bus, uint32_t cycles)
+{
+	sb_i2c_delay(bus->active_prescaler, cycles);
+}
+
+/**
+ * 	@brief Draws the next number of the xorshift generator of the arbitration backoff. With the
+ * 	uptime of timer0, it is mixed in, so that masters which run the same firmware draw different
+ * 	numbers.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@return uint32_t the random number.
+ */
+static uint32_t
+sb_i2c_random(i2c_bus_t *bus)
+{
+	uint32_t x = bus->arb_seed;
+
+#ifdef CSR_TIMER0_UPTIME_CYCLES_ADDR
+	timer0_uptime_latch_write(1);
+	x ^= (uint32_t)timer0_uptime_cycles_read();
+#endif
+	if (x == 0)
+	{
+		x = (uint32_t)bus->csr_base | 1;
+	}
+
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+
+	return bus->arb_seed = x;
+}
+
+/**
+ * 	@brief Backs off after an arbitration loss: waits for the other master to release the I2C
+ * 	bus, and then for a random number of SCL periods below the backoff of the retry, so that the
+ * 	masters which lost together do not collide again.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param attempt is the number of retries so far.
+ * 	@return true if the I2C bus has been released.
+ * 	@return false if it is still busy after kSB_I2C_CONFIG_ARB_BUSY_TIMEOUTS timeouts.
+ */
+static bool
+sb_i2c_backoff(i2c_bus_t *bus, uint8_t attempt)
+{
+	i2c_timeout_t timeout;
+
+	sb_i2c_deadline_start(bus, &timeout, kSB_I2C_CONFIG_ARB_BUSY_TIMEOUTS * kSB_I2C_CONFIG_TIMEOUT_SCL_PERIODS);
+
+	while (sb_i2c_get_status(bus) & kI2CSR_BUSY_bm)
+	{
+		if (sb_i2c_timeout_expired(&timeout))
+		{
+			return false;
+		}
+	}
+
+	uint32_t window = (uint32_t)bus->arb_backoff << (attempt < 8 ? attempt : 8);
+
+	if (window > 0)
+	{
+		sb_i2c_delay(bus->active_prescaler, sb_i2c_random(bus) % window);
+	}
+
+	return true;
+}
+
+/**
+ * 	@brief Checks if a transaction is to be sent again, after an arbitration loss, once the I2C
+ * 	bus is free and the backoff has elapsed.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param status is the status of the transaction.
+ * 	@param attempt is the number of retries so far.
+ * 	@return true if the transaction is to be retried.
+ * 	@return false otherwise.
+ */
+static bool
+sb_i2c_retry(i2c_bus_t *bus, I2C_STATUS_t status, uint8_t attempt)
+{
+	return status == kI2C_STATUS_ARB_LOST && attempt < bus->arb_retries && sb_i2c_backoff(bus, attempt);
+}
+
+/**
+ * 	@brief Sends a write command to the I2C bus, and clears it, to avoid sending it again. The
+ * 	clear keeps CKSDIS, so that it does not turn clock stretching on.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param command is the command to send.
+ */
+static void
+sb_i2c_send_command(i2c_bus_t *bus, uint8_t command)
+{
+	/*
+	 * 	Set the command
 	 */
-	i2c_end();
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CCMDR, command);
 
 	/*
-	 * 	Return true if the slave acknowledged the command
+	 * 	Clear the command, to avoid sending it again
+	 */
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CCMDR, sb_i2c_cksdis(bus));
+}
+
+void
+i2c_bus_init(i2c_bus_t *bus)
+{
+	i2c_bus_lock(bus);
+	sb_i2c_configure(bus);
+	i2c_bus_unlock(bus);
+}
+
+I2C_STATUS_t
+sb_i2c_start(i2c_bus_t *bus, uint8_t address, bool is_read_cmd)
+{
+	/*
+	 * 	Set the I2C slave address, and the read/write mode
+	 */
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CTXDR, address << 1 | (is_read_cmd ? 0b1 : 0b0));
+
+	/*
+	 * 	Send the slave address and mode
+	 */
+	sb_i2c_send_command(bus,
+		0
+		| sb_i2c_cksdis(bus)
+		| kI2CCMDR_WR_bm
+		| kI2CCMDR_STA_bm
+	);
+
+	/*
+	 * 	Check if it is a read command
+	 */
+	if (is_read_cmd)
+	{
+		/*
+		 * 	Wait for the System Bus to be in the Master receiving / Slave transmitting mode, or
+		 * 	for the address phase to end without it if the slave does not acknowledge
+		 */
+		I2C_STATUS_t result = sb_i2c_wait_for_srw(bus);
+
+		if (result != kI2C_STATUS_OK)
+		{
+			return result;
+		}
+
+		/*
+		 * 	Set the I2C bus for slave writing
+		 */
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CCMDR,
+			0
+			| sb_i2c_cksdis(bus)
+			| kI2CCMDR_RD_bm
+		);
+
+		return kI2C_STATUS_OK;
+	}
+
+	/*
+	 * 	Wait for the System Bus to be ready. The acknowledge of the address is not known yet
 	 */
-	return ack;
+	uint8_t status;
+
+	return sb_i2c_wait(bus, kI2CSR_TRRDY_bm, true, &status);
+}
+
+I2C_STATUS_t
+i2c_bus_begin(i2c_bus_t *bus, uint8_t address, bool is_read_cmd)
+{
+	I2C_STATUS_t status;
+	uint8_t attempt = 0;
+
+	i2c_bus_lock(bus);
+	sb_i2c_select_speed(bus, address);
+
+	do
+	{
+		status = sb_i2c_result(bus, sb_i2c_start(bus, address, is_read_cmd));
+	} while (sb_i2c_retry(bus, status, attempt++));
+
+	return status;
+}
+
+I2C_STATUS_t
+i2c_bus_restart(i2c_bus_t *bus, uint8_t address, bool is_read_cmd)
+{
+	return sb_i2c_result(bus, sb_i2c_start(bus, address, is_read_cmd));
+}
+
+I2C_STATUS_t
+i2c_bus_write(i2c_bus_t *bus, uint8_t data)
+{
+	/*
+	 * 	Set the I2C data
+	 */
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CTXDR, data);
+
+	/*
+	 * 	Send the data
+	 */
+	sb_i2c_send_command(bus,
+		0
+		| sb_i2c_cksdis(bus)
+		| kI2CCMDR_WR_bm
+	);
+
+	/*
+	 * 	Wait for the System Bus to be ready
+	 */
+	return sb_i2c_result(bus, sb_i2c_wait_for_trrdy(bus));
+}
+
+uint8_t
+i2c_bus_read(i2c_bus_t *bus, bool is_last_read)
+{
+	/*
+	 * 	Check if it is the last read
+	 */
+	if (is_last_read)
+	{
+		/*
+		 * 	Send a stop and ack I2C command
+		 */
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CCMDR,
+			0
+			| sb_i2c_cksdis(bus)
+			| kI2CCMDR_ACK_bm
+			| kI2CCMDR_RD_bm
+			| kI2CCMDR_STO_bm
+		);
+		bus->stop_sent = true;
+	}
+
+	/*
+	 * 	Wait for the System Bus to be ready
+	 */
+	sb_i2c_result(bus, sb_i2c_wait_for_rx(bus));
+
+	/*
+	 * 	Return the I2C data
+	 */
+	return sb_i2c_get_register(bus, kSB_I2C_REGS_I2CRXDR);
+}
+
+void
+sb_i2c_stop(i2c_bus_t *bus)
+{
+	/*
+	 * 	Send a stop I2C command
+	 */
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CCMDR,
+		0
+		| sb_i2c_cksdis(bus)
+		| kI2CCMDR_STO_bm
+	);
+}
+
+I2C_STATUS_t
+i2c_bus_end(i2c_bus_t *bus)
+{
+	/*
+	 * 	The last byte written is still being sent, if the I2C bus is held in transmitting mode
+	 */
+	uint8_t status = sb_i2c_get_status(bus);
+	bool is_write = (status & kI2CSR_BUSY_bm) && !(status & kI2CSR_SRW_bm);
+	I2C_STATUS_t result = kI2C_STATUS_OK;
+
+	/*
+	 * 	The last i2c_bus_read() has already sent the STOP. Another one would be queued after the
+	 * 	START of the next transaction. After an arbitration loss, the other master owns the I2C
+	 * 	bus, and the loss has already been counted
+	 */
+	if (bus->status == kI2C_STATUS_ARB_LOST)
+	{
+		result = kI2C_STATUS_ARB_LOST;
+	}
+	else
+	{
+		if (!bus->stop_sent)
+		{
+			result = sb_i2c_finish(bus, result, is_write);
+		}
+		result = sb_i2c_result(bus, result);
+	}
+	bus->stop_sent = false;
+
+	i2c_bus_unlock(bus);
+
+	return result;
+}
+
+/**
+ * 	@brief Writes bytes in an I2C write transaction that has already begun.
+ *
+ * 	I2CCMDR commands are executed when the register is written, so the command is written once per
+ * 	byte. Waiting for TRRDY only waits for the transmit register to be free, so the next byte is
+ * 	loaded while the current one shifts out.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param data is the buffer to write.
+ * 	@param len is the number of bytes to write.
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the first error, at which it stops. The acknowledge of
+ * 	the last byte is not checked.
+ */
+I2C_STATUS_t
+sb_i2c_write_burst(i2c_bus_t *bus, const uint8_t *data, size_t len)
+{
+	for (size_t i = 0; i < len; i++)
+	{
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CTXDR, data[i]);
+		sb_i2c_send_command(bus,
+			0
+			| sb_i2c_cksdis(bus)
+			| kI2CCMDR_WR_bm
+		);
+
+		I2C_STATUS_t status = sb_i2c_wait_for_trrdy(bus);
+
+		if (status != kI2C_STATUS_OK)
+		{
+			return status;
+		}
+	}
+
+	return kI2C_STATUS_OK;
+}
+
+/**
+ * 	@brief Reads bytes in an I2C read transaction that has already begun.
+ *
+ * 	The read buffer is enabled (kI2CCMDR_RBUFDIS_bm clear), so while a byte waits in the receive
+ * 	register the next one is already being received. Once the byte before the last has been read,
+ * 	the last one is in progress, so the ending command is issued then to take effect on it.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param data is the buffer to read to.
+ * 	@param len is the number of bytes to read.
+ * 	@param end is the ending command of the last byte: kI2CCMDR_ACK_bm to NACK it, together with
+ * 	kI2CCMDR_STO_bm to also end the transaction, or 0 to keep receiving.
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the first error. It stops at an arbitration loss or a
+ * 	timeout, but not at an overrun, so that the transaction still ends.
+ */
+I2C_STATUS_t
+sb_i2c_read_burst(i2c_bus_t *bus, uint8_t *data, size_t len, uint8_t end)
+{
+	I2C_STATUS_t result = kI2C_STATUS_OK;
+
+	for (size_t i = 0; i < len; i++)
+	{
+		if (i + 1 == len && end != 0)
+		{
+			sb_i2c_set_register(bus, kSB_I2C_REGS_I2CCMDR,
+				0
+				| sb_i2c_cksdis(bus)
+				| kI2CCMDR_RD_bm
+				| end
+			);
+		}
+
+		I2C_STATUS_t status = sb_i2c_wait_for_rx(bus);
+
+		if (status == kI2C_STATUS_ARB_LOST || status == kI2C_STATUS_TIMEOUT)
+		{
+			return status;
+		}
+
+		if (result == kI2C_STATUS_OK)
+		{
+			result = status;
+		}
+
+		data[i] = sb_i2c_get_register(bus, kSB_I2C_REGS_I2CRXDR);
+	}
+
+	return result;
+}
+
+/**
+ * 	@brief Probes a slave address, after a START or a repeated START, as a write command without
+ * 	data. The acknowledge is read once the address phase has completed, so no byte is written to
+ * 	the slave, and the I2C bus is kept for another probe or a STOP.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param address is the slave address.
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK if the slave acknowledged, kI2C_STATUS_NACK, or the error.
+ */
+static I2C_STATUS_t
+sb_i2c_probe(i2c_bus_t *bus, uint8_t address)
+{
+	uint8_t status;
+
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CTXDR, address << 1);
+	sb_i2c_send_command(bus,
+		0
+		| sb_i2c_cksdis(bus)
+		| kI2CCMDR_WR_bm
+		| kI2CCMDR_STA_bm
+	);
+
+	/*
+	 * 	Wait for the address to move to the shift register, and then for the address phase to
+	 * 	complete
+	 */
+	I2C_STATUS_t result = sb_i2c_wait(bus, kI2CSR_TRRDY_bm, true, &status);
+
+	if (result != kI2C_STATUS_OK)
+	{
+		return result;
+	}
+
+	return sb_i2c_wait_for_ack(bus);
+}
+
+bool
+i2c_bus_scan(i2c_bus_t *bus, uint8_t address)
+{
+	i2c_bus_lock(bus);
+	sb_i2c_select_speed(bus, address);
+
+	I2C_STATUS_t status = sb_i2c_result(bus, sb_i2c_finish(bus, sb_i2c_probe(bus, address), false));
+
+	i2c_bus_unlock(bus);
+
+	/*
+	 * 	Return true if the slave acknowledged the command
+	 */
+	return status == kI2C_STATUS_OK;
+}
+
+I2C_STATUS_t
+i2c_bus_scan_all(i2c_bus_t *bus, uint8_t bitmap[16])
+{
+	I2C_STATUS_t status = kI2C_STATUS_OK;
+
+	for (uint8_t i = 0; i < 16; i++)
+	{
+		bitmap[i] = 0;
+	}
+
+	i2c_bus_lock(bus);
+
+	/*
+	 * 	The scan is at the I2C bus speed, not at the speed of any device
+	 */
+	bus->stretch = false;
+	bus->active_profile = 0;
+	if (bus->prescaler != bus->active_prescaler || bus->sda_del != bus->active_sda_del)
+	{
+		sb_i2c_apply_speed(bus, bus->prescaler, bus->sda_del);
+	}
+
+#ifdef CSR_SB_I2C_PROBE_CONTROL_ADDR
+	/*
+	 * 	Sweep the addresses in gateware, and wait for it, as its timeout bounds the sweep
+	 */
+	csr_write_simple(
+		0
+		| (1 << CSR_SB_I2C_PROBE_CONTROL_START_OFFSET)
+		| (kSB_I2C_CONFIG_SCAN_FIRST_ADDRESS << CSR_SB_I2C_PROBE_CONTROL_FIRST_OFFSET)
+		| (kSB_I2C_CONFIG_SCAN_LAST_ADDRESS << CSR_SB_I2C_PROBE_CONTROL_LAST_OFFSET),
+		SB_I2C_CSR(bus, PROBE_CONTROL)
+	);
+
+	uint32_t probe_status;
+
+	do
+	{
+		probe_status = csr_read_simple(SB_I2C_CSR(bus, PROBE_STATUS));
+	} while (probe_status & (1 << CSR_SB_I2C_PROBE_STATUS_BUSY_OFFSET));
+
+	const unsigned long words[4] = {
+		SB_I2C_CSR(bus, PROBE_BITMAP0),
+		SB_I2C_CSR(bus, PROBE_BITMAP1),
+		SB_I2C_CSR(bus, PROBE_BITMAP2),
+		SB_I2C_CSR(bus, PROBE_BITMAP3),
+	};
+
+	for (uint8_t i = 0; i < 4; i++)
+	{
+		uint32_t word = csr_read_simple(words[i]);
+
+		for (uint8_t j = 0; j < 4; j++)
+		{
+			bitmap[4 * i + j] = word >> (8 * j);
+		}
+	}
+
+	if (probe_status & (1 << CSR_SB_I2C_PROBE_STATUS_TIMEOUT_OFFSET))
+	{
+		status = sb_i2c_result(bus, kI2C_STATUS_TIMEOUT);
+	}
+	else
+	{
+		bus->status = status;
+	}
+#else
+	/*
+	 * 	Probe all addresses in a single transaction, with a repeated START before each address
+	 * 	and a STOP at the end
+	 */
+	for (uint8_t address = kSB_I2C_CONFIG_SCAN_FIRST_ADDRESS;
+		address <= kSB_I2C_CONFIG_SCAN_LAST_ADDRESS && status == kI2C_STATUS_OK;
+		address++)
+	{
+		I2C_STATUS_t probe = sb_i2c_probe(bus, address);
+
+		if (probe == kI2C_STATUS_OK)
+		{
+			bitmap[address >> 3] |= 1 << (address & 7);
+		}
+		else if (probe != kI2C_STATUS_NACK)
+		{
+			status = probe;
+		}
+	}
+
+	status = sb_i2c_result(bus, sb_i2c_finish(bus, status, false));
+#endif
+
+	i2c_bus_unlock(bus);
+
+	return status;
+}
+
+I2C_STATUS_t
+i2c_bus_write_buf(i2c_bus_t *bus, uint8_t address, const uint8_t *data, size_t len)
+{
+	I2C_STATUS_t status;
+	uint8_t attempt = 0;
+
+	i2c_bus_lock(bus);
+	sb_i2c_select_speed(bus, address);
+
+	do
+	{
+		status = sb_i2c_start(bus, address, false);
+
+		if (status == kI2C_STATUS_OK)
+		{
+			status = sb_i2c_write_burst(bus, data, len);
+		}
+
+		status = sb_i2c_result(bus, sb_i2c_finish(bus, status, true));
+	} while (sb_i2c_retry(bus, status, attempt++));
+
+	i2c_bus_unlock(bus);
+
+	return status;
+}
+
+I2C_STATUS_t
+i2c_bus_read_buf(i2c_bus_t *bus, uint8_t address, uint8_t *data, size_t len)
+{
+	return i2c_bus_write_read(bus, address, NULL, 0, data, len);
+}
+
+I2C_STATUS_t
+sb_i2c_write_read(i2c_bus_t *bus, uint8_t address, const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len, bool stop)
+{
+	I2C_STATUS_t status = kI2C_STATUS_OK;
+
+	if (wr_len == 0 && rd_len == 0)
+	{
+		return bus->status = status;
+	}
+
+	sb_i2c_select_speed(bus, address);
+
+	if (wr_len > 0)
+	{
+		status = sb_i2c_start(bus, address, false);
+
+		if (status == kI2C_STATUS_OK)
+		{
+			status = sb_i2c_write_burst(bus, wr, wr_len);
+		}
+
+		if (status == kI2C_STATUS_OK && rd_len > 0)
+		{
+			status = sb_i2c_wait_for_ack(bus);
+		}
+
+		if (status != kI2C_STATUS_OK || rd_len == 0)
+		{
+			return sb_i2c_result(bus, sb_i2c_finish(bus, status, true));
+		}
+	}
+
+	/*
+	 * 	After a write, the I2C bus is still held, so this START is a repeated START
+	 */
+	status = sb_i2c_start(bus, address, true);
+
+	if (status == kI2C_STATUS_OK)
+	{
+		/*
+		 * 	The read burst ends the transaction with its STOP, or NACKs its last byte for a
+		 * 	repeated START
+		 */
+		status = sb_i2c_read_burst(bus, rd, rd_len, kI2CCMDR_ACK_bm | (stop ? kI2CCMDR_STO_bm : 0));
+	}
+	else
+	{
+		status = sb_i2c_finish(bus, status, false);
+	}
+
+	return sb_i2c_result(bus, status);
+}
+
+I2C_STATUS_t
+i2c_bus_write_read(i2c_bus_t *bus, uint8_t address, const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len)
+{
+	I2C_STATUS_t status;
+	uint8_t attempt = 0;
+
+	i2c_bus_lock(bus);
+
+	do
+	{
+		status = sb_i2c_write_read(bus, address, wr, wr_len, rd, rd_len, true);
+	} while (sb_i2c_retry(bus, status, attempt++));
+
+	i2c_bus_unlock(bus);
+
+	return status;
+}
+
+I2C_STATUS_t
+i2c_bus_reg_read(i2c_bus_t *bus, uint8_t address, uint8_t reg, uint8_t *data, size_t len)
+{
+	return i2c_bus_write_read(bus, address, &reg, 1, data, len);
+}
+
+I2C_STATUS_t
+i2c_bus_reg_write(i2c_bus_t *bus, uint8_t address, uint8_t reg, const uint8_t *data, size_t len)
+{
+	I2C_STATUS_t status;
+	uint8_t attempt = 0;
+
+	i2c_bus_lock(bus);
+	sb_i2c_select_speed(bus, address);
+
+	do
+	{
+		status = sb_i2c_start(bus, address, false);
+
+		if (status == kI2C_STATUS_OK)
+		{
+			status = sb_i2c_write_burst(bus, &reg, 1);
+		}
+
+		if (status == kI2C_STATUS_OK)
+		{
+			status = sb_i2c_write_burst(bus, data, len);
+		}
+
+		status = sb_i2c_result(bus, sb_i2c_finish(bus, status, true));
+	} while (sb_i2c_retry(bus, status, attempt++));
+
+	i2c_bus_unlock(bus);
+
+	return status;
+}
+
+int
+i2c_bus_transfer(i2c_bus_t *bus, struct i2c_msg *msgs, size_t n)
+{
+	I2C_STATUS_t status;
+	uint8_t attempt = 0;
+
+	/*
+	 * 	Nothing to transfer, the I2C bus is not touched, so no STOP is sent on an idle bus
+	 */
+	if (n == 0)
+	{
+		return 0;
+	}
+
+	/*
+	 * 	A read ends by NACKing its last byte, so an empty read message would leave the I2C bus held
+	 */
+	for (size_t i = 0; i < n; i++)
+	{
+		if ((msgs[i].flags & I2C_M_RD) && msgs[i].len == 0)
+		{
+			return -(int)kI2C_STATUS_INVALID;
+		}
+	}
+
+	i2c_bus_lock(bus);
+
+	/*
+	 * 	The prescaler can not change within the transaction, as writing it resets the I2C Hard IP
+	 */
+	sb_i2c_select_speed(bus, msgs[0].addr);
+
+	do
+	{
+		bool stopped = false;
+
+		status = kI2C_STATUS_OK;
+
+		for (size_t i = 0; i < n && status == kI2C_STATUS_OK; i++)
+		{
+			struct i2c_msg *msg = &msgs[i];
+			bool is_read = msg->flags & I2C_M_RD;
+			bool ignore_nak = msg->flags & I2C_M_IGNORE_NAK;
+
+			/*
+			 * 	The next message continues this one, unless it begins with a repeated START
+			 */
+			bool is_continued = i + 1 < n && (msgs[i + 1].flags & I2C_M_NOSTART);
+
+			if (i == 0 || !(msg->flags & I2C_M_NOSTART))
+			{
+				status = sb_i2c_start(bus, msg->addr, is_read);
+
+				if (status != kI2C_STATUS_OK)
+				{
+					break;
+				}
+			}
+
+			if (is_read)
+			{
+				/*
+				 * 	The last byte before a repeated START is NACKed, and the last one of the
+				 * 	transfer is also STOPped
+				 */
+				uint8_t end = 0;
+
+				if (i + 1 == n)
+				{
+					end = kI2CCMDR_ACK_bm | kI2CCMDR_STO_bm;
+					stopped = true;
+				}
+				else if (!is_continued)
+				{
+					end = kI2CCMDR_ACK_bm;
+				}
+
+				status = sb_i2c_read_burst(bus, msg->buf, msg->len, end);
+			}
+			else
+			{
+				for (size_t j = 0; j < msg->len && status == kI2C_STATUS_OK; j++)
+				{
+					status = sb_i2c_write_burst(bus, &msg->buf[j], 1);
+
+					if (status == kI2C_STATUS_NACK && ignore_nak)
+					{
+						status = kI2C_STATUS_OK;
+					}
+				}
+
+				/*
+				 * 	The acknowledge of the last byte, or of the address of an empty message, is
+				 * 	known once it has been sent
+				 */
+				if (status == kI2C_STATUS_OK && !is_continued)
+				{
+					status = sb_i2c_wait_for_ack(bus);
+
+					if (status == kI2C_STATUS_NACK && ignore_nak)
+					{
+						status = kI2C_STATUS_OK;
+					}
+				}
+			}
+		}
+
+		if (!stopped)
+		{
+			status = sb_i2c_finish(bus, status, false);
+		}
+
+		status = sb_i2c_result(bus, status);
+	} while (sb_i2c_retry(bus, status, attempt++));
+
+	i2c_bus_unlock(bus);
+
+	return status == kI2C_STATUS_OK ? (int)n : -(int)status;
+}
+
+I2C_STATUS_t
+i2c_bus_recover(i2c_bus_t *bus)
+{
+	I2C_STATUS_t status = kI2C_STATUS_OK;
+
+	i2c_bus_lock(bus);
+
+#ifdef CSR_SB_I2C_RECOVERY_CONTROL_ADDR
+	if (!sb_i2c_recover_lines(bus))
+	{
+		status = kI2C_STATUS_TIMEOUT;
+	}
+#endif
+
+	/*
+	 * 	The I2C Hard IP has seen the recovery on its inputs
+	 */
+	sb_i2c_configure(bus);
+
+	i2c_bus_unlock(bus);
+
+	return bus->status = status;
+}
+
+I2C_STATUS_t
+i2c_bus_status(i2c_bus_t *bus)
+{
+	return bus->status;
+}
+
+uint32_t
+i2c_bus_skipped_writes(i2c_bus_t *bus)
+{
+	return bus->skipped_writes;
+}
+
+uint32_t
+i2c_bus_set_speed(i2c_bus_t *bus, uint32_t frequency)
+{
+	if (!sb_i2c_speed_valid(frequency))
+	{
+		return 0;
+	}
+
+	i2c_bus_lock(bus);
+
+	bus->prescaler = sb_i2c_speed_prescaler(frequency);
+	bus->sda_del = sb_i2c_speed_sda_del(frequency);
+	sb_i2c_apply_speed(bus, bus->prescaler, bus->sda_del);
+
+	i2c_bus_unlock(bus);
+
+	return sb_i2c_speed_frequency(bus->prescaler);
+}
+
+uint32_t
+i2c_bus_set_device_speed(i2c_bus_t *bus, uint8_t address, uint32_t frequency)
+{
+	uint32_t achieved = 0;
+	uint8_t i;
+
+	i2c_bus_lock(bus);
+
+	for (i = 0; i < bus->speed_count && bus->speeds[i].address != address; i++);
+
+	if (frequency == 0)
+	{
+		/*
+		 * 	Remove the speed profile, by moving the last one in its place
+		 */
+		if (i < bus->speed_count)
+		{
+			bus->speeds[i] = bus->speeds[--bus->speed_count];
+		}
+	}
+	else if (sb_i2c_speed_valid(frequency) && i < kSB_I2C_CONFIG_SPEED_PROFILES)
+	{
+		if (i == bus->speed_count)
+		{
+			bus->speeds[i].stretch = kI2C_STRETCH_OFF;
+			bus->speeds[i].overruns = 0;
+			bus->speed_count++;
+		}
+		bus->speeds[i].address = address;
+		bus->speeds[i].prescaler = sb_i2c_speed_prescaler(frequency);
+		bus->speeds[i].sda_del = sb_i2c_speed_sda_del(frequency);
+		achieved = sb_i2c_speed_frequency(bus->speeds[i].prescaler);
+	}
+
+	i2c_bus_unlock(bus);
+
+	return achieved;
+}
+
+bool
+i2c_bus_set_device_stretch(i2c_bus_t *bus, uint8_t address, I2C_STRETCH_t stretch)
+{
+	bool is_set = false;
+	uint8_t i;
+
+	i2c_bus_lock(bus);
+
+	for (i = 0; i < bus->speed_count && bus->speeds[i].address != address; i++);
+
+	if (i < kSB_I2C_CONFIG_SPEED_PROFILES)
+	{
+		if (i == bus->speed_count)
+		{
+			/*
+			 * 	A new speed profile, at the I2C bus speed
+			 */
+			bus->speeds[i].address = address;
+			bus->speeds[i].prescaler = bus->prescaler;
+			bus->speeds[i].sda_del = bus->sda_del;
+			bus->speeds[i].overruns = 0;
+			bus->speed_count++;
+		}
+		bus->speeds[i].stretch = stretch;
+		is_set = true;
+	}
+
+	i2c_bus_unlock(bus);
+
+	return is_set;
+}
+
+uint16_t
+i2c_bus_device_overruns(i2c_bus_t *bus, uint8_t address)
+{
+	for (uint8_t i = 0; i < bus->speed_count; i++)
+	{
+		if (bus->speeds[i].address == address)
+		{
+			return bus->speeds[i].overruns;
+		}
+	}
+
+	return 0;
+}
+
+void
+i2c_bus_set_arbitration_retry(i2c_bus_t *bus, uint8_t retries, uint16_t backoff)
+{
+	i2c_bus_lock(bus);
+	bus->arb_retries = retries;
+	bus->arb_backoff = backoff;
+	i2c_bus_unlock(bus);
+}
+
+uint32_t
+i2c_bus_arbitration_losses(i2c_bus_t *bus)
+{
+	return bus->arb_losses;
+}
+
+/*
+ * 	API on the default bus, the sb_i2c instance
+ */
+
+void
+i2c_init(void)
+{
+	i2c_bus_init(&i2c_bus_default);
+}
+
+I2C_STATUS_t
+i2c_begin(uint8_t address, bool is_read_cmd)
+{
+	return i2c_bus_begin(&i2c_bus_default, address, is_read_cmd);
+}
+
+I2C_STATUS_t
+i2c_restart(uint8_t address, bool is_read_cmd)
+{
+	return i2c_bus_restart(&i2c_bus_default, address, is_read_cmd);
+}
+
+I2C_STATUS_t
+i2c_write(uint8_t data)
+{
+	return i2c_bus_write(&i2c_bus_default, data);
+}
+
+uint8_t
+i2c_read(bool is_last_read)
+{
+	return i2c_bus_read(&i2c_bus_default, is_last_read);
+}
+
+I2C_STATUS_t
+i2c_end(void)
+{
+	return i2c_bus_end(&i2c_bus_default);
+}
+
+bool
+i2c_scan(uint8_t address)
+{
+	return i2c_bus_scan(&i2c_bus_default, address);
+}
+
+I2C_STATUS_t
+i2c_scan_all(uint8_t bitmap[16])
+{
+	return i2c_bus_scan_all(&i2c_bus_default, bitmap);
+}
+
+I2C_STATUS_t
+i2c_write_buf(uint8_t address, const uint8_t *data, size_t len)
+{
+	return i2c_bus_write_buf(&i2c_bus_default, address, data, len);
+}
+
+I2C_STATUS_t
+i2c_read_buf(uint8_t address, uint8_t *data, size_t len)
+{
+	return i2c_bus_read_buf(&i2c_bus_default, address, data, len);
+}
+
+I2C_STATUS_t
+i2c_write_read(uint8_t address, const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len)
+{
+	return i2c_bus_write_read(&i2c_bus_default, address, wr, wr_len, rd, rd_len);
+}
+
+I2C_STATUS_t
+i2c_reg_read(uint8_t address, uint8_t reg, uint8_t *data, size_t len)
+{
+	return i2c_bus_reg_read(&i2c_bus_default, address, reg, data, len);
+}
+
+I2C_STATUS_t
+i2c_reg_write(uint8_t address, uint8_t reg, const uint8_t *data, size_t len)
+{
+	return i2c_bus_reg_write(&i2c_bus_default, address, reg, data, len);
+}
+
+int
+i2c_transfer(struct i2c_msg *msgs, size_t n)
+{
+	return i2c_bus_transfer(&i2c_bus_default, msgs, n);
+}
+
+I2C_STATUS_t
+i2c_recover(void)
+{
+	return i2c_bus_recover(&i2c_bus_default);
+}
+
+I2C_STATUS_t
+i2c_status(void)
+{
+	return i2c_bus_status(&i2c_bus_default);
+}
+
+uint32_t
+i2c_skipped_writes(void)
+{
+	return i2c_bus_skipped_writes(&i2c_bus_default);
+}
+
+uint32_t
+i2c_set_speed(uint32_t frequency)
+{
+	return i2c_bus_set_speed(&i2c_bus_default, frequency);
+}
+
+uint32_t
+i2c_set_device_speed(uint8_t address, uint32_t frequency)
+{
+	return i2c_bus_set_device_speed(&i2c_bus_default, address, frequency);
+}
+
+bool
+i2c_set_device_stretch(uint8_t address, I2C_STRETCH_t stretch)
+{
+	return i2c_bus_set_device_stretch(&i2c_bus_default, address, stretch);
+}
+
+uint16_t
+i2c_device_overruns(uint8_t address)
+{
+	return i2c_bus_device_overruns(&i2c_bus_default, address);
+}
+
+void
+i2c_set_arbitration_retry(uint8_t retries, uint16_t backoff)
+{
+	i2c_bus_set_arbitration_retry(&i2c_bus_default, retries, backoff);
+}
+
+uint32_t
+i2c_arbitration_losses(void)
+{
+	return i2c_bus_arbitration_losses(&i2c_bus_default);
+}
+
+void
+i2c_wait_for_i2c_cycles(uint32_t cycles)
+{
+	i2c_bus_wait_for_i2c_cycles(&i2c_bus_default, cycles);
 }
@@ -24,6 +24,7 @@
 #ifndef __I2C_H
 #define __I2C_H
 
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 
@@ -39,34 +40,296 @@ typedef enum SB_I2C_CONFIG_enum
 	kSB_I2C_CONFIG_TARGET_I2C_FREQUENCY = 400000,
 
 	/*
-	 * 	Hard IP Timeouts
+	 * 	Highest I2C Bus frequency, of Fast-mode Plus
+	 */
+	kSB_I2C_CONFIG_MAX_I2C_FREQUENCY = 1000000,
+
+	/*
+	 * 	Number of per-device speed profiles of each I2C bus
+	 */
+	kSB_I2C_CONFIG_SPEED_PROFILES = 4,
+
+	/*
+	 * 	Timeout of a wait on the I2C Hard IP, in SCL periods at the active I2C bus frequency, when
+	 * 	the uptime of timer0 is available. It bounds how long a slave can stretch SCL for a byte
+	 */
+	kSB_I2C_CONFIG_TIMEOUT_SCL_PERIODS = 100,
+
+	/*
+	 * 	Defaults of I2C_BUS_INIT() for the retries of a transaction which lost arbitration to
+	 * 	another master, and for the upper bound of the random backoff before the first retry, in
+	 * 	SCL periods, which doubles at each retry
+	 */
+	kSB_I2C_CONFIG_ARB_RETRIES         = 3,
+	kSB_I2C_CONFIG_ARB_BACKOFF_PERIODS = 16,
+
+	/*
+	 * 	Timeouts of a wait on the I2C Hard IP for which the other master can hold the I2C bus,
+	 * 	before a retry is given up
+	 */
+	kSB_I2C_CONFIG_ARB_BUSY_TIMEOUTS = 64,
+
+	/*
+	 * 	Shortest delay, in system clock cycles, which sleeps when the driver is built with
+	 * 	I2C_DELAY_WFI. Shorter ones spin on the uptime of timer0, as waking up costs an interrupt
+	 * 	latency
+	 */
+	kSB_I2C_CONFIG_DELAY_WFI_MIN_CYCLES = 512,
+
+	/*
+	 * 	Hard IP Timeouts, in I2C Status Register reads, without the uptime of timer0
 	 */
 	kSB_I2C_CONFIG_TRRDY_TIMEOUT = INT8_MAX,
 	kSB_I2C_CONFIG_SRW_TIMEOUT   = INT8_MAX,
+
+	/*
+	 * 	Timeout multipliers for the access methods which read the I2C Status Register faster than
+	 * 	the legacy CSR System Bus handshake
+	 */
+	kSB_I2C_CONFIG_STATUS_MIRROR_TIMEOUT_SCALE = 16,
+	kSB_I2C_CONFIG_FAST_ACCESS_TIMEOUT_SCALE   = 8,
+
+	/*
+	 * 	Slave addresses of i2c_scan_all(), without the reserved ones
+	 */
+	kSB_I2C_CONFIG_SCAN_FIRST_ADDRESS = 0x08,
+	kSB_I2C_CONFIG_SCAN_LAST_ADDRESS  = 0x77,
 } SB_I2C_CONFIG;
 
+/*
+ * 	Status of an I2C bus call, from the I2C Status Register, or of the arguments
+ */
+typedef enum I2C_STATUS_enum
+{
+	kI2C_STATUS_OK       = 0,
+	kI2C_STATUS_NACK     = 1, /* The slave did not acknowledge (RARC) */
+	kI2C_STATUS_ARB_LOST = 2, /* Arbitration was lost to another master (ARBL) */
+	kI2C_STATUS_TIMEOUT  = 3, /* The I2C Hard IP did not become ready in time, and has been reset */
+	kI2C_STATUS_OVERRUN  = 4, /* A received byte was overwritten before it was read (TROE) */
+	kI2C_STATUS_INVALID  = 5, /* The arguments do not form a valid transaction, nothing was sent */
+} I2C_STATUS_t;
+
+/*
+ * 	Deadline of a wait on the I2C Hard IP or of a delay, in timer0 uptime cycles, or in I2C Status
+ * 	Register reads without the uptime of timer0
+ */
+typedef struct i2c_timeout
+{
+	uint64_t		deadline;
+	uint32_t		polls;
+} i2c_timeout_t;
+
+struct i2c_xfer;
+struct i2c_slave;
+
+/*
+ * 	Clock stretching of the transactions with a device. The I2C Hard IP holds SCL low while the
+ * 	receive register is full or the transmit register is empty, instead of overrunning
+ */
+typedef enum I2C_STRETCH_enum
+{
+	kI2C_STRETCH_OFF  = 0, /* The I2C bus never waits for the driver, a late byte is overrun */
+	kI2C_STRETCH_ON   = 1, /* The I2C bus waits for the driver */
+	kI2C_STRETCH_AUTO = 2, /* Off, and on from the first overrun */
+} I2C_STRETCH_t;
+
+/*
+ * 	Speed profile of a device, set with i2c_bus_set_device_speed() and
+ * 	i2c_bus_set_device_stretch()
+ */
+typedef struct i2c_speed_profile
+{
+	uint8_t			address;
+	uint8_t			sda_del;
+	uint16_t		prescaler;
+	uint8_t			stretch;
+	uint16_t		overruns;
+} i2c_speed_profile_t;
+
+/*
+ * 	I2C bus, one per ICE40UP_I2C instance. The System Bus access method is selected at compile
+ * 	time from the CSRs of the sb_i2c instance, so all instances must be built with the same
+ * 	options (corner aside).
+ *
+ * 	Single-threaded builds can define I2C_BUS_NO_LOCKING, which removes the calls of the lock
+ * 	hooks and their checks. The hooks are still members, so the layout of i2c_bus_t does not
+ * 	depend on it.
+ */
+typedef struct i2c_bus
+{
+	/*
+	 * 	CSR base address of the ICE40UP_I2C instance, CSR_<NAME>_BASE in generated/csr.h
+	 */
+	unsigned long		csr_base;
+
+	/*
+	 * 	Base address of the Wishbone bridge (with_wishbone), <NAME>_REGS_BASE in generated/mem.h
+	 */
+	unsigned long		regs_base;
+
+	/*
+	 * 	I2C clock prescaler, for the I2CBRLSB/I2CBRMSB registers, and SDA output delay
+	 * 	(kI2CCR1_SDA_DEL_SEL_*_gc), of the devices without speed profile
+	 */
+	uint16_t		prescaler;
+	uint8_t			sda_del;
+
+	/*
+	 * 	Per-device speed profiles, applied when a transaction begins
+	 */
+	i2c_speed_profile_t	speeds[kSB_I2C_CONFIG_SPEED_PROFILES];
+	uint8_t			speed_count;
+
+	/*
+	 * 	Retries of a transaction which lost arbitration, and upper bound of the random backoff
+	 * 	before the first retry, in SCL periods, set with i2c_bus_set_arbitration_retry()
+	 */
+	uint8_t			arb_retries;
+	uint16_t		arb_backoff;
+
+	/*
+	 * 	Optional lock, held for one I2C transaction: from i2c_bus_begin() to i2c_bus_end(), or for
+	 * 	the whole of the other functions. For example, taking and giving an RTOS mutex. Without
+	 * 	lock (NULL), the bus must only be used from one thread. Not called with I2C_BUS_NO_LOCKING.
+	 * 	Either way, the driver sets owned while the lock would be held, so the i2c_sample.h
+	 * 	sampler holds off.
+	 */
+	void			(*lock)(void *lock_context);
+	void			(*unlock)(void *lock_context);
+	void *			lock_context;
+
+	/*
+	 * 	Set by the driver
+	 */
+	bool			sbrwi_status;
+	bool			sbstbi_status;
+	uint8_t			shadow_sbadri;
+	uint8_t			shadow_sbdati;
+	uint8_t			shadow_valid;
+	uint32_t		skipped_writes;
+	uint16_t		active_prescaler;
+	uint8_t			active_sda_del;
+	I2C_STATUS_t		status;
+	bool			stop_sent;
+	bool			stretch;
+	uint8_t			active_profile;
+	volatile bool		owned;
+	struct i2c_xfer * volatile	xfer;
+	bool			xfer_polled;
+	struct i2c_slave *	slave;
+	bool			general_call;
+	uint32_t		arb_losses;
+	uint32_t		arb_seed;
+} i2c_bus_t;
+
+/*
+ * 	I2C clock prescaler of the highest I2C bus frequency up to the given one: the System Bus clock
+ * 	is divided by (prescaler + 1) * 4, rounded up as by i2c_set_speed()
+ */
+#define I2C_BUS_PRESCALER(frequency) \
+	((uint16_t)((CONFIG_CLOCK_FREQUENCY + 4 * (frequency) - 1) / (4 * (frequency)) - 1))
+
+/*
+ * 	Initializer of an i2c_bus_t at kSB_I2C_CONFIG_TARGET_I2C_FREQUENCY. For example, for a second
+ * 	ICE40UP_I2C instance named sb_i2c1, without Wishbone bridge:
+ *
+ * 	i2c_bus_t i2c_bus1 = I2C_BUS_INIT(CSR_SB_I2C1_BASE, 0);
+ */
+#define I2C_BUS_INIT(csr_base_, regs_base_)							\
+	I2C_BUS_INIT_PRESCALER(csr_base_, regs_base_, I2C_BUS_PRESCALER(kSB_I2C_CONFIG_TARGET_I2C_FREQUENCY))
+
+/*
+ * 	Initializer of an i2c_bus_t with the given I2C clock prescaler
+ */
+#define I2C_BUS_INIT_PRESCALER(csr_base_, regs_base_, prescaler_)				\
+	{											\
+		.csr_base  = (csr_base_),							\
+		.regs_base = (regs_base_),							\
+		.prescaler = (prescaler_),							\
+		.arb_retries = kSB_I2C_CONFIG_ARB_RETRIES,					\
+		.arb_backoff = kSB_I2C_CONFIG_ARB_BACKOFF_PERIODS,				\
+	}
+
+/*
+ * 	The sb_i2c instance, used by the functions without an i2c_bus_t parameter
+ */
+extern i2c_bus_t i2c_bus_default;
+
+/*
+ * 	Flags of an I2C message, with the values of Linux
+ */
+typedef enum I2C_MSG_FLAGS_enum
+{
+	I2C_M_RD         = 0x0001, /* Read from the slave, else write to it */
+	I2C_M_IGNORE_NAK = 0x1000, /* Carry on when the slave does not acknowledge */
+	I2C_M_NOSTART    = 0x4000, /* Continue the previous message, without a repeated START */
+} I2C_MSG_FLAGS_t;
+
+/*
+ * 	I2C message of i2c_transfer(), as struct i2c_msg of Linux
+ */
+struct i2c_msg
+{
+	uint16_t		addr;
+	uint16_t		flags;
+	uint16_t		len;
+	uint8_t *		buf;
+};
+
 /**
  * 	@brief Initializes the I2C Hard IP.
  */
 void i2c_init(void);
 
+/**
+ * 	@brief Waits for the given number of SCL periods at the I2C bus frequency in use. With the
+ * 	uptime of timer0 (timer_uptime=True of the SoC), the delay is counted in system clock cycles,
+ * 	and, with the driver built with I2C_DELAY_WFI, one of at least
+ * 	kSB_I2C_CONFIG_DELAY_WFI_MIN_CYCLES sleeps in WFI until a one-shot timer0 interrupt. The other
+ * 	interrupts wake it up and are taken during the delay. The countdown and the interrupt of timer0
+ * 	are then reserved to the driver, which leaves timer0 disabled after the delay; its uptime is
+ * 	not affected. Without the uptime, it is a busy loop of about as many CPU cycles.
+ *
+ * 	@param cycles is the number of SCL periods
+ */
+void i2c_wait_for_i2c_cycles(uint32_t cycles);
+
 /**
  * 	@brief Initiates an I2C transaction, for slave with given address, as a read or write command.
+ * 	The START is retried after an arbitration loss, see i2c_set_arbitration_retry(). A loss later
+ * 	in the transaction is returned by i2c_write() or i2c_read(), and the transaction has then to
+ * 	be ended and begun again.
  *
  * 	@param address is the slave address
  * 	@param is_read_cmd sets the read or write command
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error. The acknowledge of the slave address of a
+ * 	write command is only known once it has been sent, so it is returned by the next i2c_write() or
+ * 	by i2c_end()
  */
-void i2c_begin(uint8_t address, bool is_read_cmd);
+I2C_STATUS_t i2c_begin(uint8_t address, bool is_read_cmd);
+
+/**
+ * 	@brief Sends a repeated START in an I2C transaction that has already begun, for slave with
+ * 	given address, as a read or write command.
+ *
+ * 	@param address is the slave address
+ * 	@param is_read_cmd sets the read or write command
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error, see i2c_begin()
+ */
+I2C_STATUS_t i2c_restart(uint8_t address, bool is_read_cmd);
 
 /**
  * 	@brief Writes a byte to the I2C bus.
  *
  * 	@param data is the byte to write
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error. The transmit register is freed while the
+ * 	byte shifts out, so kI2C_STATUS_NACK is the acknowledge of the previous byte (or slave address),
+ * 	and the one of the last byte is returned by i2c_end()
  */
-void i2c_write(uint8_t data);
+I2C_STATUS_t i2c_write(uint8_t data);
 
 /**
- * 	@brief Reads a byte from the I2C bus.
+ * 	@brief Reads a byte from the I2C bus. Its status is returned by i2c_status().
  *
  * 	@param is_last_read sets if this is the last read
  * 	@return uint8_t the read byte
@@ -75,8 +338,11 @@ uint8_t i2c_read(bool is_last_read);
 
 /**
  * 	@brief Ends an I2C transaction, and releases the I2C bus.
+ *
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error of the last byte written. The I2C bus is
+ * 	released in any case, without a STOP after an arbitration loss, as the other master owns it
  */
-void i2c_end(void);
+I2C_STATUS_t i2c_end(void);
 
 /**
  * 	@brief Scans for a slave with given address.
@@ -87,6 +353,439 @@ void i2c_end(void);
  */
 bool i2c_scan(uint8_t address);
 
+/**
+ * 	@brief Scans for all slaves, from address 0x08 to 0x77, in a single I2C transaction. Each
+ * 	address is probed after a repeated START, without writing data to the slave, and the I2C bus is
+ * 	released once at the end. With the gateware probe of ICE40UP_I2C (with_probe=True) the sweep
+ * 	runs without the CPU.
+ *
+ * 	@param bitmap is set to the slaves found: bit (address & 7) of bitmap[address >> 3]
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error which ended the scan
+ */
+I2C_STATUS_t i2c_scan_all(uint8_t bitmap[16]);
+
+/**
+ * 	@brief Writes a buffer to a slave, as a single I2C transaction.
+ *
+ * 	Each byte is loaded to the transmit register as soon as the previous one has moved to the
+ * 	shift register, so the bytes are sent back-to-back.
+ *
+ * 	@param address is the slave address
+ * 	@param data is the buffer to write
+ * 	@param len is the number of bytes to write
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the first error
+ */
+I2C_STATUS_t i2c_write_buf(uint8_t address, const uint8_t *data, size_t len);
+
+/**
+ * 	@brief Reads a buffer from a slave, as a single I2C transaction.
+ *
+ * 	The receive double buffering of the I2C Hard IP is used, so the next byte is received while
+ * 	the current one is being read.
+ *
+ * 	@param address is the slave address
+ * 	@param data is the buffer to read to
+ * 	@param len is the number of bytes to read
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the first error
+ */
+I2C_STATUS_t i2c_read_buf(uint8_t address, uint8_t *data, size_t len);
+
+/**
+ * 	@brief Writes a buffer to a slave and then reads a buffer from it, as a single I2C transaction
+ * 	with a repeated START in between.
+ *
+ * 	@param address is the slave address
+ * 	@param wr is the buffer to write
+ * 	@param wr_len is the number of bytes to write
+ * 	@param rd is the buffer to read to
+ * 	@param rd_len is the number of bytes to read
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the first error
+ */
+I2C_STATUS_t i2c_write_read(uint8_t address, const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len);
+
+/**
+ * 	@brief Reads consecutive registers of a slave, starting from the given register.
+ *
+ * 	@param address is the slave address
+ * 	@param reg is the first register
+ * 	@param data is the buffer to read to
+ * 	@param len is the number of registers to read
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the first error
+ */
+I2C_STATUS_t i2c_reg_read(uint8_t address, uint8_t reg, uint8_t *data, size_t len);
+
+/**
+ * 	@brief Writes consecutive registers of a slave, starting from the given register.
+ *
+ * 	@param address is the slave address
+ * 	@param reg is the first register
+ * 	@param data is the buffer to write
+ * 	@param len is the number of registers to write
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the first error
+ */
+I2C_STATUS_t i2c_reg_write(uint8_t address, uint8_t reg, const uint8_t *data, size_t len);
+
+/**
+ * 	@brief Sets the I2C bus frequency, of the devices without speed profile.
+ *
+ * 	Only the I2CBRLSB/I2CBRMSB registers are rewritten, and only when the prescaler changes. The
+ * 	I2CCR1 register, which resets the I2C core, is rewritten when the SDA output delay for the new
+ * 	frequency differs: 300 ns up to Fast-mode (400 kHz), and 75 ns for Fast-mode Plus (1 MHz).
+ * 	Must be called between transactions.
+ *
+ * 	The lowest frequency is that of the largest prescaler, CONFIG_CLOCK_FREQUENCY / 4096. A lower
+ * 	frequency, or 0, is rejected, and the I2C bus frequency is left unchanged.
+ *
+ * 	@param frequency is the I2C bus frequency in Hz, up to kSB_I2C_CONFIG_MAX_I2C_FREQUENCY
+ * 	@return uint32_t the achieved I2C bus frequency in Hz, the highest one up to frequency, or 0 if
+ * 	frequency is below the lowest one
+ */
+uint32_t i2c_set_speed(uint32_t frequency);
+
+/**
+ * 	@brief Sets the I2C bus frequency of a device, applied by every transaction which begins with
+ * 	its address. See i2c_set_speed().
+ *
+ * 	@param address is the slave address
+ * 	@param frequency is the I2C bus frequency in Hz, or 0 to remove the speed profile of the device
+ * 	@return uint32_t the achieved I2C bus frequency in Hz, or 0 if there are already
+ * 	kSB_I2C_CONFIG_SPEED_PROFILES speed profiles, or frequency is below the lowest one of
+ * 	i2c_set_speed()
+ */
+uint32_t i2c_set_device_speed(uint8_t address, uint32_t frequency);
+
+/**
+ * 	@brief Sets the clock stretching of the transactions with a device. Devices without it set,
+ * 	and all devices by default, do not stretch (kI2C_STRETCH_OFF), as stretching slows down the
+ * 	I2C bus to the pace of the driver. Stretching suits a slow slave, or a driver with interrupt
+ * 	latencies, without lowering the speed of the other devices. The device gets a speed profile
+ * 	at the current I2C bus frequency if it has none, and removing its speed profile with
+ * 	i2c_set_device_speed() also removes its clock stretching.
+ *
+ * 	@param address is the slave address
+ * 	@param stretch is the clock stretching
+ * 	@return true if it was set
+ * 	@return false if there are already kSB_I2C_CONFIG_SPEED_PROFILES speed profiles
+ */
+bool i2c_set_device_stretch(uint8_t address, I2C_STRETCH_t stretch);
+
+/**
+ * 	@brief Gets the number of receive overruns (kI2C_STATUS_OVERRUN) of the transactions with a
+ * 	device which has a speed profile. With kI2C_STRETCH_AUTO, the first one turns clock stretching
+ * 	on for the device.
+ *
+ * 	@param address is the slave address
+ * 	@return uint16_t the number of overruns, 0 without speed profile
+ */
+uint16_t i2c_device_overruns(uint8_t address);
+
+/**
+ * 	@brief Sets the retries of a transaction which loses arbitration to another master on the I2C
+ * 	bus. After a loss, the driver waits for the other master to release the I2C bus, then for a
+ * 	random number of SCL periods below the backoff, which doubles at each retry, and sends the
+ * 	whole transaction again. The buffer functions and i2c_transfer() retry the whole transaction,
+ * 	and i2c_begin() its START.
+ *
+ * 	@param retries is the number of retries, 0 to return kI2C_STATUS_ARB_LOST at the first loss
+ * 	@param backoff is the upper bound of the backoff before the first retry, in SCL periods
+ */
+void i2c_set_arbitration_retry(uint8_t retries, uint16_t backoff);
+
+/**
+ * 	@brief Gets the number of arbitration losses (kI2C_STATUS_ARB_LOST) on the I2C bus, retried
+ * 	or not, for monitoring.
+ *
+ * 	@return uint32_t the number of arbitration losses since the I2C bus was initialized
+ */
+uint32_t i2c_arbitration_losses(void);
+
+/**
+ * 	@brief Transfers an array of messages as a single I2C transaction, as i2c_transfer() of Linux.
+ *
+ * 	Each message begins with a repeated START, unless it has I2C_M_NOSTART, in which case it
+ * 	continues the previous message in the same direction. The transaction ends with a single STOP.
+ * 	A read message must not be empty, as the last byte of a read is NACKed.
+ *
+ * 	The speed profile of the slave of the first message (see i2c_set_device_speed()) applies to
+ * 	the whole transaction, as changing the prescaler resets the I2C Hard IP. Messages to slaves
+ * 	with different profiles go in separate transfers.
+ *
+ * 	@param msgs is the array of messages
+ * 	@param n is the number of messages
+ * 	@return int the number of messages, or the negated I2C_STATUS_t of the first error. A slave
+ * 	which does not acknowledge a message with I2C_M_IGNORE_NAK is not an error. An empty read
+ * 	message is kI2C_STATUS_INVALID
+ */
+int i2c_transfer(struct i2c_msg *msgs, size_t n);
+
+/**
+ * 	@brief Recovers the I2C bus from a slave which holds SDA low, with the gateware bus recovery of
+ * 	ICE40UP_I2C (with_bus_recovery=True): up to 9 SCL pulses and a STOP, in at most 23 SCL half
+ * 	periods. The I2C Hard IP is then reinitialized, which is all that is done without the bus
+ * 	recovery. The timeouts of the other functions run the bus recovery if SDA is held low.
+ *
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or kI2C_STATUS_TIMEOUT if SCL or SDA is still held low
+ */
+I2C_STATUS_t i2c_recover(void);
+
+/**
+ * 	@brief Gets the status of the last call on the I2C bus, such as the one of the last i2c_read().
+ *
+ * 	@return I2C_STATUS_t the status
+ */
+I2C_STATUS_t i2c_status(void);
+
+/**
+ * 	@brief Gets the number of register writes skipped on the I2C bus, as the register already held
+ * 	the value, for debugging. The driver keeps the last value written to the System Bus CSRs
+ * 	(SBCTRL, SBADRI, SBDATI) within each call, and to the I2CCR1, I2CBRLSB and I2CBRMSB registers.
+ *
+ * 	@return uint32_t the number of skipped writes since the I2C bus was initialized
+ */
+uint32_t i2c_skipped_writes(void);
+
+/*
+ * 	The same API on a given I2C bus. Transfers on different buses are independent. A transaction
+ * 	opened with i2c_bus_begin() must be closed with i2c_bus_end(), also after a last i2c_bus_read()
+ * 	and after an error.
+ */
+
+/**
+ * 	@brief Initializes the I2C Hard IP of an I2C bus.
+ *
+ * 	@param bus is the I2C bus
+ */
+void i2c_bus_init(i2c_bus_t *bus);
+
+/**
+ * 	@brief Initiates an I2C transaction on an I2C bus, see i2c_begin(). Takes the lock of the I2C
+ * 	bus, until i2c_bus_end().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param address is the slave address
+ * 	@param is_read_cmd sets the read or write command
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error
+ */
+I2C_STATUS_t i2c_bus_begin(i2c_bus_t *bus, uint8_t address, bool is_read_cmd);
+
+/**
+ * 	@brief Sends a repeated START on an I2C bus, see i2c_restart(). The lock of the I2C bus stays
+ * 	held, so a repeated START must not use i2c_bus_begin().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param address is the slave address
+ * 	@param is_read_cmd sets the read or write command
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error
+ */
+I2C_STATUS_t i2c_bus_restart(i2c_bus_t *bus, uint8_t address, bool is_read_cmd);
+
+/**
+ * 	@brief Writes a byte to an I2C bus, see i2c_write().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param data is the byte to write
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error
+ */
+I2C_STATUS_t i2c_bus_write(i2c_bus_t *bus, uint8_t data);
+
+/**
+ * 	@brief Reads a byte from an I2C bus, see i2c_read().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param is_last_read sets if this is the last read
+ * 	@return uint8_t the read byte
+ */
+uint8_t i2c_bus_read(i2c_bus_t *bus, bool is_last_read);
+
+/**
+ * 	@brief Ends an I2C transaction on an I2C bus, see i2c_end(). Releases the lock of the I2C bus.
+ *
+ * 	@param bus is the I2C bus
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error
+ */
+I2C_STATUS_t i2c_bus_end(i2c_bus_t *bus);
+
+/**
+ * 	@brief Scans an I2C bus for a slave with given address, see i2c_scan().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param address is the slave address
+ * 	@return true if the slave was found (ACK received)
+ * 	@return false if the slave was not found (no ACK received)
+ */
+bool i2c_bus_scan(i2c_bus_t *bus, uint8_t address);
+
+/**
+ * 	@brief Scans an I2C bus for all slaves, see i2c_scan_all().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param bitmap is set to the slaves found
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error which ended the scan
+ */
+I2C_STATUS_t i2c_bus_scan_all(i2c_bus_t *bus, uint8_t bitmap[16]);
+
+/**
+ * 	@brief Writes a buffer to a slave on an I2C bus, see i2c_write_buf().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param address is the slave address
+ * 	@param data is the buffer to write
+ * 	@param len is the number of bytes to write
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error
+ */
+I2C_STATUS_t i2c_bus_write_buf(i2c_bus_t *bus, uint8_t address, const uint8_t *data, size_t len);
+
+/**
+ * 	@brief Reads a buffer from a slave on an I2C bus, see i2c_read_buf().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param address is the slave address
+ * 	@param data is the buffer to read to
+ * 	@param len is the number of bytes to read
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error
+ */
+I2C_STATUS_t i2c_bus_read_buf(i2c_bus_t *bus, uint8_t address, uint8_t *data, size_t len);
+
+/**
+ * 	@brief Writes and then reads a slave on an I2C bus, see i2c_write_read().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param address is the slave address
+ * 	@param wr is the buffer to write
+ * 	@param wr_len is the number of bytes to write
+ * 	@param rd is the buffer to read to
+ * 	@param rd_len is the number of bytes to read
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error
+ */
+I2C_STATUS_t i2c_bus_write_read(i2c_bus_t *bus, uint8_t address, const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len);
+
+/**
+ * 	@brief Reads consecutive registers of a slave on an I2C bus, see i2c_reg_read().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param address is the slave address
+ * 	@param reg is the first register
+ * 	@param data is the buffer to read to
+ * 	@param len is the number of registers to read
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error
+ */
+I2C_STATUS_t i2c_bus_reg_read(i2c_bus_t *bus, uint8_t address, uint8_t reg, uint8_t *data, size_t len);
+
+/**
+ * 	@brief Writes consecutive registers of a slave on an I2C bus, see i2c_reg_write().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param address is the slave address
+ * 	@param reg is the first register
+ * 	@param data is the buffer to write
+ * 	@param len is the number of registers to write
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error
+ */
+I2C_STATUS_t i2c_bus_reg_write(i2c_bus_t *bus, uint8_t address, uint8_t reg, const uint8_t *data, size_t len);
+
+/**
+ * 	@brief Sets the I2C bus frequency of an I2C bus, see i2c_set_speed().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param frequency is the I2C bus frequency in Hz
+ * 	@return uint32_t the achieved I2C bus frequency in Hz, or 0 if frequency is too low
+ */
+uint32_t i2c_bus_set_speed(i2c_bus_t *bus, uint32_t frequency);
+
+/**
+ * 	@brief Waits for the given number of SCL periods at the frequency in use on an I2C bus, see
+ * 	i2c_wait_for_i2c_cycles().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param cycles is the number of SCL periods
+ */
+void i2c_bus_wait_for_i2c_cycles(i2c_bus_t *bus, uint32_t cycles);
+
+/**
+ * 	@brief Sets the I2C bus frequency of a device on an I2C bus, see i2c_set_device_speed().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param address is the slave address
+ * 	@param frequency is the I2C bus frequency in Hz, or 0 to remove the speed profile of the device
+ * 	@return uint32_t the achieved I2C bus frequency in Hz, or 0 if the speed profiles are full, or
+ * 	frequency is too low
+ */
+uint32_t i2c_bus_set_device_speed(i2c_bus_t *bus, uint8_t address, uint32_t frequency);
+
+/**
+ * 	@brief Sets the clock stretching of a device on an I2C bus, see i2c_set_device_stretch().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param address is the slave address
+ * 	@param stretch is the clock stretching
+ * 	@return true if it was set
+ * 	@return false if there are already kSB_I2C_CONFIG_SPEED_PROFILES speed profiles
+ */
+bool i2c_bus_set_device_stretch(i2c_bus_t *bus, uint8_t address, I2C_STRETCH_t stretch);
+
+/**
+ * 	@brief Gets the number of receive overruns of a device on an I2C bus, see
+ * 	i2c_device_overruns().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param address is the slave address
+ * 	@return uint16_t the number of overruns
+ */
+uint16_t i2c_bus_device_overruns(i2c_bus_t *bus, uint8_t address);
+
+/**
+ * 	@brief Sets the retries of a transaction which loses arbitration on an I2C bus, see
+ * 	i2c_set_arbitration_retry().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param retries is the number of retries
+ * 	@param backoff is the upper bound of the backoff before the first retry, in SCL periods
+ */
+void i2c_bus_set_arbitration_retry(i2c_bus_t *bus, uint8_t retries, uint16_t backoff);
+
+/**
+ * 	@brief Gets the number of arbitration losses on an I2C bus, see i2c_arbitration_losses().
+ *
+ * 	@param bus is the I2C bus
+ * 	@return uint32_t the number of arbitration losses
+ */
+uint32_t i2c_bus_arbitration_losses(i2c_bus_t *bus);
+
+/**
+ * 	@brief Transfers an array of messages as a single I2C transaction on an I2C bus, see
+ * 	i2c_transfer().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param msgs is the array of messages
+ * 	@param n is the number of messages
+ * 	@return int the number of messages, or the negated I2C_STATUS_t of the first error
+ */
+int i2c_bus_transfer(i2c_bus_t *bus, struct i2c_msg *msgs, size_t n);
+
+/**
+ * 	@brief Recovers an I2C bus, see i2c_recover().
+ *
+ * 	@param bus is the I2C bus
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or kI2C_STATUS_TIMEOUT if SCL or SDA is still held low
+ */
+I2C_STATUS_t i2c_bus_recover(i2c_bus_t *bus);
+
+/**
+ * 	@brief Gets the status of the last call on an I2C bus, see i2c_status().
+ *
+ * 	@param bus is the I2C bus
+ * 	@return I2C_STATUS_t the status
+ */
+I2C_STATUS_t i2c_bus_status(i2c_bus_t *bus);
+
+/**
+ * 	@brief Gets the number of register writes skipped on an I2C bus, see i2c_skipped_writes().
+ *
+ * 	@param bus is the I2C bus
+ * 	@return uint32_t the number of skipped writes
+ */
+uint32_t i2c_bus_skipped_writes(i2c_bus_t *bus);
+
 #ifdef __cplusplus
 }
 #endif
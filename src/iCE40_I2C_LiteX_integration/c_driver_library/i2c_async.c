@@ -0,0 +1,553 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+#include <generated/csr.h>
+#include <generated/soc.h>
+#include <irq.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c.h"
+#include "i2c_async.h"
+#include "sb_i2c.h"
+#include "sb_i2c_regs.h"
+
+/*
+ * 	Transfer states. Each state either does a single System Bus access, or waits for an I2C Status
+ * 	Register condition.
+ */
+typedef enum I2C_ASYNC_STATE_enum
+{
+	kI2C_ASYNC_STATE_START_TXDR,
+	kI2C_ASYNC_STATE_START_CMD,
+	kI2C_ASYNC_STATE_START_CLEAR,
+	kI2C_ASYNC_STATE_WAIT_TX,
+	kI2C_ASYNC_STATE_TX_DATA,
+	kI2C_ASYNC_STATE_TX_CMD,
+	kI2C_ASYNC_STATE_TX_CLEAR,
+	kI2C_ASYNC_STATE_WAIT_ACK,
+	kI2C_ASYNC_STATE_WAIT_SRW,
+	kI2C_ASYNC_STATE_RX_CMD,
+	kI2C_ASYNC_STATE_WAIT_RX,
+	kI2C_ASYNC_STATE_RX_STOP,
+	kI2C_ASYNC_STATE_RX_DATA,
+	kI2C_ASYNC_STATE_STOP,
+	kI2C_ASYNC_STATE_DONE,
+} I2C_ASYNC_STATE_t;
+
+/*
+ * 	Interrupts used to advance a transfer
+ */
+static const uint8_t irq_mask = 0
+	| kI2CIRQEN_IRQTROEEN_bm
+	| kI2CIRQEN_IRQTRRDYEN_bm
+	| kI2CIRQEN_IRQARBLEN_bm;
+
+/**
+ * 	@brief Checks if the transfer is in its read part.
+ *
+ * 	@param xfer is the transfer.
+ * 	@return true if all bytes have been written, and there are bytes to read.
+ */
+static bool
+i2c_async_is_reading(i2c_xfer_t *xfer)
+{
+	return xfer->wr_index >= xfer->wr_len && xfer->rd_len > 0;
+}
+
+/**
+ * 	@brief Checks the timeout of a wait state check that has failed, starting it at the first one.
+ *
+ * 	@param xfer is the transfer.
+ * 	@return true if waiting has timed out, and the transfer has advanced to its STOP.
+ * 	@return false if the transfer keeps waiting.
+ */
+static bool
+i2c_async_wait(i2c_xfer_t *xfer)
+{
+	if (!xfer->waiting)
+	{
+		sb_i2c_timeout_start(xfer->bus, &xfer->timeout);
+		xfer->waiting = true;
+
+		return false;
+	}
+
+	if (!sb_i2c_timeout_expired(&xfer->timeout))
+	{
+		return false;
+	}
+
+	xfer->result = kI2C_ASYNC_RESULT_TIMEOUT;
+	xfer->state = kI2C_ASYNC_STATE_STOP;
+
+	return true;
+}
+
+/**
+ * 	@brief Performs the current state of a transfer, with at most one System Bus access.
+ *
+ * 	@param xfer is the transfer.
+ * 	@return true if the transfer has advanced.
+ * 	@return false if the transfer is waiting for an I2C Status Register condition.
+ */
+static bool
+i2c_async_step(i2c_xfer_t *xfer)
+{
+	i2c_bus_t *bus = xfer->bus;
+	uint8_t status;
+
+	switch (xfer->state)
+	{
+	case kI2C_ASYNC_STATE_START_TXDR:
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CTXDR, xfer->address << 1 | (i2c_async_is_reading(xfer) ? 0b1 : 0b0));
+		xfer->state = kI2C_ASYNC_STATE_START_CMD;
+		return true;
+
+	case kI2C_ASYNC_STATE_START_CMD:
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CCMDR,
+			0
+			| sb_i2c_cksdis(bus)
+			| kI2CCMDR_WR_bm
+			| kI2CCMDR_STA_bm
+		);
+		xfer->state = kI2C_ASYNC_STATE_START_CLEAR;
+		return true;
+
+	case kI2C_ASYNC_STATE_START_CLEAR:
+		/*
+		 * 	Clear the command, to avoid sending it again
+		 */
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CCMDR, sb_i2c_cksdis(bus));
+		xfer->state = i2c_async_is_reading(xfer) ? kI2C_ASYNC_STATE_WAIT_SRW : kI2C_ASYNC_STATE_WAIT_TX;
+		return true;
+
+	case kI2C_ASYNC_STATE_WAIT_TX:
+		status = sb_i2c_get_status(bus);
+		if (status & kI2CSR_ARBL_bm)
+		{
+			xfer->result = kI2C_ASYNC_RESULT_ARB_LOST;
+			xfer->state = kI2C_ASYNC_STATE_DONE;
+			return true;
+		}
+		if (!(status & kI2CSR_TRRDY_bm))
+		{
+			return i2c_async_wait(xfer);
+		}
+		xfer->waiting = false;
+		if (status & kI2CSR_RARC_bm)
+		{
+			xfer->result = kI2C_ASYNC_RESULT_NACK;
+			xfer->state = kI2C_ASYNC_STATE_STOP;
+		}
+		else if (xfer->wr_index < xfer->wr_len)
+		{
+			xfer->state = kI2C_ASYNC_STATE_TX_DATA;
+		}
+		else
+		{
+			/*
+			 * 	TRRDY only tells that the last byte has left the transmit register, its acknowledge
+			 * 	is known once it has been sent
+			 */
+			xfer->state = kI2C_ASYNC_STATE_WAIT_ACK;
+		}
+		return true;
+
+	case kI2C_ASYNC_STATE_TX_DATA:
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CTXDR, xfer->wr[xfer->wr_index++]);
+		xfer->state = kI2C_ASYNC_STATE_TX_CMD;
+		return true;
+
+	case kI2C_ASYNC_STATE_TX_CMD:
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CCMDR,
+			0
+			| sb_i2c_cksdis(bus)
+			| kI2CCMDR_WR_bm
+		);
+		xfer->state = kI2C_ASYNC_STATE_TX_CLEAR;
+		return true;
+
+	case kI2C_ASYNC_STATE_TX_CLEAR:
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CCMDR, sb_i2c_cksdis(bus));
+		xfer->state = kI2C_ASYNC_STATE_WAIT_TX;
+		return true;
+
+	case kI2C_ASYNC_STATE_WAIT_ACK:
+		if (bus->xfer_polled)
+		{
+			status = sb_i2c_get_status(bus);
+			if (status & kI2CSR_ARBL_bm)
+			{
+				xfer->result = kI2C_ASYNC_RESULT_ARB_LOST;
+			}
+			else if (status & kI2CSR_TIP_bm)
+			{
+				return i2c_async_wait(xfer);
+			}
+			else if (status & kI2CSR_RARC_bm)
+			{
+				xfer->result = kI2C_ASYNC_RESULT_NACK;
+			}
+		}
+		/*
+		 * 	There is no interrupt for the end of a byte, it is within a byte time after TRRDY
+		 */
+		else
+		{
+			xfer->result = (I2C_ASYNC_RESULT_t)sb_i2c_wait_for_ack(bus);
+		}
+		xfer->waiting = false;
+		if (xfer->result == kI2C_ASYNC_RESULT_OK && xfer->rd_len > 0)
+		{
+			/*
+			 * 	Repeated START for the read part
+			 */
+			xfer->state = kI2C_ASYNC_STATE_START_TXDR;
+		}
+		else
+		{
+			xfer->state = xfer->result == kI2C_ASYNC_RESULT_ARB_LOST ? kI2C_ASYNC_STATE_DONE : kI2C_ASYNC_STATE_STOP;
+		}
+		return true;
+
+	case kI2C_ASYNC_STATE_WAIT_SRW:
+		if (bus->xfer_polled)
+		{
+			I2C_STATUS_t result;
+
+			if (!sb_i2c_address_done(sb_i2c_get_status(bus), &result))
+			{
+				return i2c_async_wait(xfer);
+			}
+			xfer->result = (I2C_ASYNC_RESULT_t)result;
+		}
+		/*
+		 * 	There is no interrupt for SRW, nor for a NACKed address: the address phase ends within
+		 * 	a byte time
+		 */
+		else
+		{
+			xfer->result = (I2C_ASYNC_RESULT_t)sb_i2c_wait_for_srw(bus);
+		}
+		xfer->waiting = false;
+		if (xfer->result != kI2C_ASYNC_RESULT_OK)
+		{
+			xfer->state = xfer->result == kI2C_ASYNC_RESULT_ARB_LOST ? kI2C_ASYNC_STATE_DONE : kI2C_ASYNC_STATE_STOP;
+			return true;
+		}
+		xfer->state = kI2C_ASYNC_STATE_RX_CMD;
+		return true;
+
+	case kI2C_ASYNC_STATE_RX_CMD:
+		/*
+		 * 	A single byte read is NACKed and STOPped right away
+		 */
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CCMDR,
+			0
+			| sb_i2c_cksdis(bus)
+			| kI2CCMDR_RD_bm
+			| (xfer->rd_len == 1 ? kI2CCMDR_ACK_bm | kI2CCMDR_STO_bm : 0)
+		);
+		xfer->state = kI2C_ASYNC_STATE_WAIT_RX;
+		return true;
+
+	case kI2C_ASYNC_STATE_WAIT_RX:
+		status = sb_i2c_get_status(bus);
+		if (status & kI2CSR_ARBL_bm)
+		{
+			xfer->result = kI2C_ASYNC_RESULT_ARB_LOST;
+			xfer->state = kI2C_ASYNC_STATE_DONE;
+			return true;
+		}
+		if (!(status & kI2CSR_TRRDY_bm))
+		{
+			return i2c_async_wait(xfer);
+		}
+		xfer->waiting = false;
+		/*
+		 * 	TROE without RARC is an overrun, with RARC it is the NACK of the last byte
+		 */
+		if ((status & kI2CSR_TROE_bm) && !(status & kI2CSR_RARC_bm))
+		{
+			xfer->result = kI2C_ASYNC_RESULT_OVERRUN;
+		}
+		/*
+		 * 	The next byte is received while this one waits in the receive register, so the NACK and
+		 * 	STOP command is issued when two bytes are left
+		 */
+		xfer->state = (xfer->rd_index + 2 == xfer->rd_len) ? kI2C_ASYNC_STATE_RX_STOP : kI2C_ASYNC_STATE_RX_DATA;
+		return true;
+
+	case kI2C_ASYNC_STATE_RX_STOP:
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CCMDR,
+			0
+			| sb_i2c_cksdis(bus)
+			| kI2CCMDR_ACK_bm
+			| kI2CCMDR_RD_bm
+			| kI2CCMDR_STO_bm
+		);
+		xfer->state = kI2C_ASYNC_STATE_RX_DATA;
+		return true;
+
+	case kI2C_ASYNC_STATE_RX_DATA:
+		xfer->rd[xfer->rd_index++] = sb_i2c_get_register(bus, kSB_I2C_REGS_I2CRXDR);
+		xfer->state = (xfer->rd_index == xfer->rd_len) ? kI2C_ASYNC_STATE_DONE : kI2C_ASYNC_STATE_WAIT_RX;
+		return true;
+
+	case kI2C_ASYNC_STATE_STOP:
+		sb_i2c_stop(bus);
+		xfer->state = kI2C_ASYNC_STATE_DONE;
+		return true;
+
+	default:
+		return false;
+	}
+}
+
+/**
+ * 	@brief Completes the transfer in flight.
+ *
+ * 	@param bus is the I2C bus.
+ */
+static void
+i2c_async_complete(i2c_bus_t *bus)
+{
+	i2c_xfer_t *xfer = bus->xfer;
+
+	if (!bus->xfer_polled)
+	{
+		sb_i2c_set_register(bus, kSB_I2C_REGS_I2CIRQEN, 0x00);
+	}
+	bus->xfer = NULL;
+	sb_i2c_monitor(bus, (I2C_STATUS_t)xfer->result);
+
+	if (xfer->callback != NULL)
+	{
+		xfer->callback(xfer);
+	}
+}
+
+/**
+ * 	@brief Advances the transfer in flight until it waits for the I2C bus.
+ *
+ * 	@param bus is the I2C bus.
+ */
+static void
+i2c_async_run(i2c_bus_t *bus)
+{
+	i2c_xfer_t *xfer = bus->xfer;
+
+	while (xfer->state != kI2C_ASYNC_STATE_DONE && i2c_async_step(xfer));
+
+	if (xfer->state == kI2C_ASYNC_STATE_DONE)
+	{
+		i2c_async_complete(bus);
+	}
+}
+
+void
+i2c_bus_async_init(i2c_bus_t *bus, unsigned int irq)
+{
+#ifdef CSR_SB_I2C_EV_ENABLE_ADDR
+	csr_write_simple(1 << CSR_SB_I2C_EV_ENABLE_I2C_OFFSET, SB_I2C_CSR(bus, EV_ENABLE));
+	irq_setmask(irq_getmask() | (1 << irq));
+#else
+	(void)bus;
+	(void)irq;
+#endif
+}
+
+/**
+ * 	@brief Initializes the driver state of a transfer, and of the I2C bus, as
+ * 	i2c_bus_lock() does for the blocking API.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param xfer is the transfer.
+ */
+static void
+i2c_async_prepare(i2c_bus_t *bus, i2c_xfer_t *xfer)
+{
+	xfer->bus = bus;
+	xfer->result = kI2C_ASYNC_RESULT_OK;
+	xfer->state = kI2C_ASYNC_STATE_START_TXDR;
+	xfer->wr_index = 0;
+	xfer->rd_index = 0;
+	xfer->waiting = false;
+	sb_i2c_shadow_invalidate(bus);
+}
+
+bool
+i2c_bus_async_start(i2c_bus_t *bus, i2c_xfer_t *xfer)
+{
+	if (bus->xfer != NULL)
+	{
+		return false;
+	}
+
+	i2c_async_prepare(bus, xfer);
+	bus->xfer_polled = false;
+	sb_i2c_select_speed(bus, xfer->address);
+
+	/*
+	 * 	The interrupt handler must not run before the transfer has reached its first wait
+	 */
+	unsigned int ie = irq_getie();
+	irq_setie(0);
+
+	bus->xfer = xfer;
+
+	/*
+	 * 	Clear stale interrupts, and enable the transfer interrupts
+	 */
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CIRQ, irq_mask);
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CIRQEN, irq_mask);
+
+	i2c_async_run(bus);
+
+	irq_setie(ie);
+
+	return true;
+}
+
+bool
+i2c_bus_async_busy(i2c_bus_t *bus)
+{
+	i2c_xfer_t *xfer = bus->xfer;
+
+	/*
+	 * 	A stalled transfer raises no SB_I2C interrupt, so its timeout is also checked here, with
+	 * 	the interrupt handler held off
+	 */
+	if (xfer != NULL && !bus->xfer_polled && xfer->waiting)
+	{
+		unsigned int ie = irq_getie();
+		irq_setie(0);
+
+		if (bus->xfer == xfer && xfer->waiting)
+		{
+			i2c_async_run(bus);
+		}
+
+		irq_setie(ie);
+	}
+
+	return bus->xfer != NULL;
+}
+
+void
+i2c_bus_async_isr(i2c_bus_t *bus)
+{
+	/*
+	 * 	Clear the pending interrupts, by writing them back
+	 */
+	uint8_t irq = sb_i2c_get_register(bus, kSB_I2C_REGS_I2CIRQ);
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CIRQ, irq);
+
+	if (bus->xfer != NULL && !bus->xfer_polled)
+	{
+		i2c_async_run(bus);
+	}
+}
+
+bool
+i2c_bus_poll_start(i2c_bus_t *bus, i2c_xfer_t *xfer)
+{
+	if (bus->xfer != NULL)
+	{
+		return false;
+	}
+
+	i2c_async_prepare(bus, xfer);
+	bus->xfer_polled = true;
+	sb_i2c_select_speed(bus, xfer->address);
+	bus->xfer = xfer;
+
+	return true;
+}
+
+bool
+i2c_bus_poll(i2c_bus_t *bus)
+{
+	i2c_xfer_t *xfer = bus->xfer;
+
+	if (xfer == NULL || !bus->xfer_polled)
+	{
+		return false;
+	}
+
+	if (xfer->state != kI2C_ASYNC_STATE_DONE)
+	{
+		i2c_async_step(xfer);
+	}
+
+	if (xfer->state == kI2C_ASYNC_STATE_DONE)
+	{
+		i2c_async_complete(bus);
+	}
+
+	return bus->xfer != NULL;
+}
+
+/*
+ * 	API on the default bus, the sb_i2c instance
+ */
+
+void
+i2c_async_init(void)
+{
+#ifdef SB_I2C_INTERRUPT
+	i2c_bus_async_init(&i2c_bus_default, SB_I2C_INTERRUPT);
+#endif
+}
+
+bool
+i2c_async_start(i2c_xfer_t *xfer)
+{
+	return i2c_bus_async_start(&i2c_bus_default, xfer);
+}
+
+bool
+i2c_async_busy(void)
+{
+	return i2c_bus_async_busy(&i2c_bus_default);
+}
+
+void
+i2c_async_isr(void)
+{
+	i2c_bus_async_isr(&i2c_bus_default);
+}
+
+bool
+i2c_poll_start(i2c_xfer_t *xfer)
+{
+	return i2c_bus_poll_start(&i2c_bus_default, xfer);
+}
+
+bool
+i2c_poll(void)
+{
+	return i2c_bus_poll(&i2c_bus_default);
+}
@@ -0,0 +1,203 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+#ifndef __I2C_ASYNC_H
+#define __I2C_ASYNC_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 	Non-blocking I2C transfers, advanced either from interrupts or by polling.
+ *
+ * 	Interrupt driven transfers need ICE40UP_I2C to be instantiated with with_irq=True. A transfer
+ * 	is started with i2c_async_start() and advanced from the SB_I2C interrupt, by calling
+ * 	i2c_async_isr() from the SoC interrupt handler when SB_I2C_INTERRUPT is pending. Its callback
+ * 	runs from the interrupt handler once the transfer has completed. A stalled transfer raises no
+ * 	interrupt, so its timeout is checked by i2c_async_busy(), which must be called until it returns
+ * 	false; the callback of a timed out transfer runs from there.
+ *
+ * 	Polled transfers are started with i2c_poll_start() and advanced by calling i2c_poll(), for
+ * 	example from a super-loop. Each call does at most one System Bus access and never waits. The
+ * 	callback runs from i2c_poll() once the transfer has completed.
+ *
+ * 	One transfer can be in flight at a time on each I2C bus. The i2c_bus_ functions do the same on a
+ * 	given I2C bus, with the interrupt handler calling i2c_bus_async_isr() for the interrupt of that
+ * 	bus.
+ *
+ * 	These transfers do not take the lock of the I2C bus, as they complete from the interrupt handler.
+ * 	With several threads, the thread which starts them has to hold off the blocking API, for example
+ * 	by holding the lock of the I2C bus until the callback has run.
+ */
+
+typedef enum I2C_ASYNC_RESULT_enum
+{
+	kI2C_ASYNC_RESULT_OK       = kI2C_STATUS_OK,
+	kI2C_ASYNC_RESULT_NACK     = kI2C_STATUS_NACK,     /* The slave did not acknowledge */
+	kI2C_ASYNC_RESULT_ARB_LOST = kI2C_STATUS_ARB_LOST, /* Arbitration was lost to another master */
+	kI2C_ASYNC_RESULT_TIMEOUT  = kI2C_STATUS_TIMEOUT,  /* The I2C bus did not become ready */
+	kI2C_ASYNC_RESULT_OVERRUN  = kI2C_STATUS_OVERRUN,  /* A received byte was overwritten */
+} I2C_ASYNC_RESULT_t;
+
+typedef struct i2c_xfer i2c_xfer_t;
+
+typedef void (*i2c_xfer_callback_t)(i2c_xfer_t *xfer);
+
+/*
+ * 	Transfer descriptor. Writes wr_len bytes from wr, and then reads rd_len bytes to rd after a
+ * 	repeated START. Either part can be empty.
+ */
+struct i2c_xfer
+{
+	uint8_t			address;
+	const uint8_t *		wr;
+	size_t			wr_len;
+	uint8_t *		rd;
+	size_t			rd_len;
+	i2c_xfer_callback_t	callback;
+	void *			context;
+
+	/*
+	 * 	Set by the driver
+	 */
+	i2c_bus_t *		bus;
+	I2C_ASYNC_RESULT_t	result;
+	uint8_t			state;
+	size_t			wr_index;
+	size_t			rd_index;
+	i2c_timeout_t		timeout;
+	bool			waiting;
+};
+
+/**
+ * 	@brief Enables the SB_I2C interrupt.
+ */
+void i2c_async_init(void);
+
+/**
+ * 	@brief Starts a transfer, and returns without waiting for it.
+ *
+ * 	@param xfer is the transfer descriptor, which must stay valid until its callback runs
+ * 	@return true if the transfer has started
+ * 	@return false if another transfer is in flight
+ */
+bool i2c_async_start(i2c_xfer_t *xfer);
+
+/**
+ * 	@brief Checks if a transfer is in flight. A transfer which waits for the I2C bus is advanced,
+ * 	and completed with kI2C_ASYNC_RESULT_TIMEOUT once its timeout has expired, as no SB_I2C
+ * 	interrupt comes then.
+ *
+ * 	@return true if a transfer is in flight
+ * 	@return false if no transfer is in flight
+ */
+bool i2c_async_busy(void);
+
+/**
+ * 	@brief Advances the transfer in flight. Call from the SoC interrupt handler.
+ */
+void i2c_async_isr(void);
+
+/**
+ * 	@brief Starts a polled transfer, and returns without waiting for it.
+ *
+ * 	@param xfer is the transfer descriptor, which must stay valid until its callback runs
+ * 	@return true if the transfer has started
+ * 	@return false if another transfer is in flight
+ */
+bool i2c_poll_start(i2c_xfer_t *xfer);
+
+/**
+ * 	@brief Advances the polled transfer in flight by at most one System Bus access.
+ *
+ * 	@return true if the transfer is still in flight
+ * 	@return false if no transfer is in flight
+ */
+bool i2c_poll(void);
+
+/**
+ * 	@brief Enables the interrupt of an I2C bus.
+ *
+ * 	@param bus is the I2C bus
+ * 	@param irq is the SoC interrupt of the I2C bus, <NAME>_INTERRUPT in generated/soc.h
+ */
+void i2c_bus_async_init(i2c_bus_t *bus, unsigned int irq);
+
+/**
+ * 	@brief Starts a transfer on an I2C bus, see i2c_async_start().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param xfer is the transfer descriptor, which must stay valid until its callback runs
+ * 	@return true if the transfer has started
+ * 	@return false if another transfer is in flight on the I2C bus
+ */
+bool i2c_bus_async_start(i2c_bus_t *bus, i2c_xfer_t *xfer);
+
+/**
+ * 	@brief Checks if a transfer is in flight on an I2C bus. A transfer waiting for the I2C bus is
+ * 	advanced, and timed out once its timeout has expired, see i2c_async_busy().
+ *
+ * 	@param bus is the I2C bus
+ * 	@return true if a transfer is in flight
+ * 	@return false if no transfer is in flight
+ */
+bool i2c_bus_async_busy(i2c_bus_t *bus);
+
+/**
+ * 	@brief Advances the transfer in flight on an I2C bus. Call from the SoC interrupt handler.
+ *
+ * 	@param bus is the I2C bus
+ */
+void i2c_bus_async_isr(i2c_bus_t *bus);
+
+/**
+ * 	@brief Starts a polled transfer on an I2C bus, see i2c_poll_start().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param xfer is the transfer descriptor, which must stay valid until its callback runs
+ * 	@return true if the transfer has started
+ * 	@return false if another transfer is in flight on the I2C bus
+ */
+bool i2c_bus_poll_start(i2c_bus_t *bus, i2c_xfer_t *xfer);
+
+/**
+ * 	@brief Advances the polled transfer in flight on an I2C bus, see i2c_poll().
+ *
+ * 	@param bus is the I2C bus
+ * 	@return true if the transfer is still in flight
+ * 	@return false if no transfer is in flight
+ */
+bool i2c_bus_poll(i2c_bus_t *bus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
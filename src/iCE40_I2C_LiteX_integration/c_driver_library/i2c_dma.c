@@ -0,0 +1,125 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+#include <generated/csr.h>
+#include <system.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c_dma.h"
+#include "i2c_seq.h"
+
+#ifdef CSR_SB_I2C_DMA_CONTROL_ADDR
+
+/*
+ * 	Set while a read transfer has not been seen as completed, the CPU data cache has to be
+ * 	flushed before its buffer is used
+ */
+static bool dma_read_pending = false;
+
+/**
+ * 	@brief Starts a DMA transfer.
+ *
+ * 	@param address is the slave address.
+ * 	@param buf is the buffer.
+ * 	@param len is the number of bytes.
+ * 	@param is_read sets the transfer direction.
+ * 	@return true if the transfer has started.
+ * 	@return false if the length does not fit the length CSR.
+ */
+static bool
+i2c_dma_start(uint8_t address, const void *buf, size_t len, bool is_read)
+{
+	if (len > kI2C_DMA_CONFIG_MAX_LEN)
+	{
+		return false;
+	}
+
+	/*
+	 * 	Clear the errors of the previous transfer
+	 */
+	i2c_seq_reset();
+
+	sb_i2c_dma_address_write((uintptr_t)buf);
+	sb_i2c_dma_length_write(len);
+	sb_i2c_dma_control_write(
+		0
+		| 1 << CSR_SB_I2C_DMA_CONTROL_START_OFFSET
+		| (is_read ? 1 : 0) << CSR_SB_I2C_DMA_CONTROL_READ_OFFSET
+		| address << CSR_SB_I2C_DMA_CONTROL_ADDR_OFFSET
+	);
+
+	dma_read_pending = is_read;
+
+	return true;
+}
+
+bool
+i2c_dma_write(uint8_t address, const void *buf, size_t len)
+{
+	return i2c_dma_start(address, buf, len, false);
+}
+
+bool
+i2c_dma_read(uint8_t address, void *buf, size_t len)
+{
+	return i2c_dma_start(address, buf, len, true);
+}
+
+bool
+i2c_dma_done(void)
+{
+	if (sb_i2c_dma_status_read() & (1 << CSR_SB_I2C_DMA_STATUS_BUSY_OFFSET))
+	{
+		return false;
+	}
+
+	if (dma_read_pending)
+	{
+		/*
+		 * 	The buffer was written behind the CPU data cache
+		 */
+		flush_cpu_dcache();
+		dma_read_pending = false;
+	}
+
+	return true;
+}
+
+uint8_t
+i2c_dma_get_errors(void)
+{
+	uint8_t errors = i2c_seq_get_errors();
+
+#ifdef CSR_SB_I2C_DMA_STATUS_BUS_ERROR_OFFSET
+	if (sb_i2c_dma_status_read() & (1 << CSR_SB_I2C_DMA_STATUS_BUS_ERROR_OFFSET))
+	{
+		errors |= kI2C_SEQ_ERROR_DMA_BUS_bm;
+	}
+#endif
+
+	return errors;
+}
+
+#endif
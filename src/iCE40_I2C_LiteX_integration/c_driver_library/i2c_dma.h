@@ -0,0 +1,97 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+#ifndef __I2C_DMA_H
+#define __I2C_DMA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 	Driver for the ICE40UP_I2C DMA engine (with_dma=True).
+ *
+ * 	A transfer is a single I2C transaction between a buffer in memory and a slave. The calls
+ * 	return as soon as the transfer has started, and the buffer must not be used until
+ * 	i2c_dma_done() returns true. The sequencer must be idle when a transfer starts. A transfer
+ * 	ends early on a NACK, a timeout or an arbitration loss, see i2c_dma_get_errors(), and a read
+ * 	buffer is then only partly written. A failed memory access ends a write transfer with a STOP,
+ * 	and drops the rest of the bytes of a read transfer. A transfer is at most
+ * 	kI2C_DMA_CONFIG_MAX_LEN bytes, the size of the length CSR.
+ */
+
+typedef enum I2C_DMA_CONFIG_enum
+{
+	/*
+	 * 	Maximum number of bytes of a transfer
+	 */
+	kI2C_DMA_CONFIG_MAX_LEN = 0xFFFF,
+} I2C_DMA_CONFIG;
+
+/**
+ * 	@brief Starts writing a buffer to a slave.
+ *
+ * 	@param address is the slave address
+ * 	@param buf is the buffer to write
+ * 	@param len is the number of bytes to write
+ * 	@return true if the transfer has started
+ * 	@return false if len is above kI2C_DMA_CONFIG_MAX_LEN
+ */
+bool i2c_dma_write(uint8_t address, const void *buf, size_t len);
+
+/**
+ * 	@brief Starts reading from a slave to a buffer.
+ *
+ * 	@param address is the slave address
+ * 	@param buf is the buffer to read to
+ * 	@param len is the number of bytes to read
+ * 	@return true if the transfer has started
+ * 	@return false if len is above kI2C_DMA_CONFIG_MAX_LEN
+ */
+bool i2c_dma_read(uint8_t address, void *buf, size_t len);
+
+/**
+ * 	@brief Checks if the last transfer has completed.
+ *
+ * 	@return true if the transfer has completed, and its buffer can be used
+ * 	@return false if the transfer is still in progress
+ */
+bool i2c_dma_done(void);
+
+/**
+ * 	@brief Gets the errors of the last transfer, including kI2C_SEQ_ERROR_DMA_BUS_bm.
+ *
+ * 	@return uint8_t the I2C_SEQ_ERROR_t bit mask
+ */
+uint8_t i2c_dma_get_errors(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
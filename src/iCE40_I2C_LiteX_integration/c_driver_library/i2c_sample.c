@@ -0,0 +1,200 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+
+#include <generated/csr.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c.h"
+#include "i2c_sample.h"
+#include "sb_i2c.h"
+#include "sb_i2c_regs.h"
+
+/**
+ * 	@brief Gets the timestamp of a sample.
+ *
+ * 	@param sampler is the sampler.
+ * 	@return uint64_t the uptime of timer0 in system clock cycles, or else the tick number.
+ */
+static uint64_t
+i2c_sampler_timestamp(i2c_sampler_t *sampler)
+{
+#ifdef CSR_TIMER0_UPTIME_CYCLES_ADDR
+	(void)sampler;
+
+	timer0_uptime_latch_write(1);
+
+	return timer0_uptime_cycles_read();
+#else
+	return sampler->ticks;
+#endif
+}
+
+void
+i2c_sampler_init(i2c_sampler_t *sampler, i2c_bus_t *bus, i2c_sample_entry_t *entries, size_t entry_count, i2c_sample_t *ring, uint32_t ring_size)
+{
+	sampler->bus = bus;
+	sampler->entries = entries;
+	sampler->entry_count = entry_count;
+	sampler->ring = ring;
+	sampler->ring_size = ring_size;
+	sampler->head = 0;
+	sampler->tail = 0;
+	sampler->ticks = 0;
+	sampler->dropped = 0;
+
+	for (size_t i = 0; i < entry_count; i++)
+	{
+		entries[i].countdown = 1;
+	}
+}
+
+void
+i2c_sampler_tick(i2c_sampler_t *sampler)
+{
+	i2c_bus_t *bus = sampler->bus;
+	size_t due = 0;
+
+	sampler->ticks++;
+
+	/*
+	 * 	A countdown of 0 marks a due entry. A held off entry stays due for the next tick
+	 */
+	for (size_t i = 0; i < sampler->entry_count; i++)
+	{
+		i2c_sample_entry_t *entry = &sampler->entries[i];
+
+		if (entry->countdown > 1)
+		{
+			entry->countdown--;
+		}
+		else
+		{
+			entry->countdown = 0;
+			due++;
+		}
+	}
+
+	if (due == 0)
+	{
+		return;
+	}
+
+	/*
+	 * 	Hold off while the application uses the I2C bus: it may be between i2c_begin() and its
+	 * 	START, or within a System Bus access, while the I2C bus is not busy yet
+	 */
+	if (bus->owned || bus->xfer != NULL)
+	{
+		return;
+	}
+	sb_i2c_shadow_invalidate(bus);
+	if (sb_i2c_get_status(bus) & kI2CSR_BUSY_bm)
+	{
+		return;
+	}
+
+	uint32_t head = sampler->head;
+	uint32_t space = sampler->ring_size - (head - __atomic_load_n(&sampler->tail, __ATOMIC_ACQUIRE));
+	for (size_t i = 0; i < sampler->entry_count && due > 0; i++)
+	{
+		i2c_sample_entry_t *entry = &sampler->entries[i];
+
+		if (entry->countdown != 0)
+		{
+			continue;
+		}
+
+		entry->countdown = entry->period;
+		due--;
+
+		if (space == 0)
+		{
+			sampler->dropped++;
+			continue;
+		}
+		space--;
+
+		/*
+		 * 	The next due entry to be read follows with a repeated START, if it is on the same
+		 * 	slave
+		 */
+		i2c_sample_entry_t *next = NULL;
+
+		for (size_t j = i + 1; j < sampler->entry_count && space > 0; j++)
+		{
+			if (sampler->entries[j].countdown == 0)
+			{
+				next = &sampler->entries[j];
+				break;
+			}
+		}
+
+		/*
+		 * 	The read goes straight into the ring buffer slot, which is published once complete
+		 */
+		i2c_sample_t *sample = &sampler->ring[head & (sampler->ring_size - 1)];
+
+		sample->timestamp = i2c_sampler_timestamp(sampler);
+		sample->entry = i;
+		sample->len = entry->len < kI2C_SAMPLE_CONFIG_MAX_LEN ? entry->len : kI2C_SAMPLE_CONFIG_MAX_LEN;
+		sample->status = sb_i2c_write_read(bus,
+			entry->address,
+			&entry->reg,
+			1,
+			sample->data,
+			sample->len,
+			next == NULL || next->address != entry->address
+		);
+
+		__atomic_store_n(&sampler->head, ++head, __ATOMIC_RELEASE);
+	}
+}
+
+size_t
+i2c_sampler_read(i2c_sampler_t *sampler, i2c_sample_t *samples, size_t max)
+{
+	uint32_t tail = sampler->tail;
+	uint32_t head = __atomic_load_n(&sampler->head, __ATOMIC_ACQUIRE);
+	size_t n = 0;
+
+	while (tail != head && n < max)
+	{
+		samples[n++] = sampler->ring[tail++ & (sampler->ring_size - 1)];
+	}
+
+	/*
+	 * 	Release the slots only once they have been copied
+	 */
+	__atomic_store_n(&sampler->tail, tail, __ATOMIC_RELEASE);
+
+	return n;
+}
+
+uint32_t
+i2c_sampler_dropped(i2c_sampler_t *sampler)
+{
+	return __atomic_load_n(&sampler->dropped, __ATOMIC_RELAXED);
+}
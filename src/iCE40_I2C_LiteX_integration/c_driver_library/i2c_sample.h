@@ -0,0 +1,165 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+
+#ifndef __I2C_SAMPLE_H
+#define __I2C_SAMPLE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 	Periodic register sampling, run from a timer interrupt.
+ *
+ * 	A sampler reads a table of device registers, each every period ticks, where a tick is a call
+ * 	of i2c_sampler_tick() from the timer interrupt handler. Each read is a register write and a
+ * 	repeated START read, as i2c_reg_read(), done with the burst functions of the driver straight
+ * 	into a slot of a single-producer/single-consumer ring buffer. The due registers of a slave
+ * 	which follow each other in the table are read in a single transaction, with a repeated START
+ * 	instead of a STOP and a START between them. The application takes the samples out with
+ * 	i2c_sampler_read(), which never blocks. With the driver built with I2C_DELAY_WFI, the timer
+ * 	interrupt can not be the one of timer0, which the delays reserve, see i2c_wait_for_i2c_cycles().
+ *
+ * 	The sampler does not take the lock of the I2C bus, as it runs from an interrupt handler. A
+ * 	tick is held off while a call of the blocking API owns the I2C bus, as it would hold its lock
+ * 	(also with I2C_BUS_NO_LOCKING), while an i2c_async.h transfer is in flight, or while the I2C
+ * 	bus is busy, and its due registers are read at the next tick.
+ */
+
+typedef enum I2C_SAMPLE_CONFIG_enum
+{
+	/*
+	 * 	Maximum number of bytes of a sample
+	 */
+	kI2C_SAMPLE_CONFIG_MAX_LEN = 8,
+} I2C_SAMPLE_CONFIG;
+
+/*
+ * 	Register sampling table entry. Reads len bytes, up to kI2C_SAMPLE_CONFIG_MAX_LEN, from register
+ * 	reg of the slave, every period ticks.
+ */
+typedef struct i2c_sample_entry
+{
+	uint8_t			address;
+	uint8_t			reg;
+	uint8_t			len;
+	uint32_t		period;
+
+	/*
+	 * 	Set by the driver
+	 */
+	uint32_t		countdown;
+} i2c_sample_entry_t;
+
+/*
+ * 	Sample in the ring buffer
+ */
+typedef struct i2c_sample
+{
+	/*
+	 * 	System clock cycles of the uptime of timer0 when the read started, or the tick number
+	 * 	without it
+	 */
+	uint64_t		timestamp;
+
+	/*
+	 * 	Index of the entry in the sampling table
+	 */
+	uint8_t			entry;
+	uint8_t			len;
+	I2C_STATUS_t		status;
+	uint8_t			data[kI2C_SAMPLE_CONFIG_MAX_LEN];
+} i2c_sample_t;
+
+/*
+ * 	Sampler. The ring buffer indices run freely, and are only written by one side each: head by
+ * 	i2c_sampler_tick(), tail by i2c_sampler_read().
+ */
+typedef struct i2c_sampler
+{
+	i2c_bus_t *		bus;
+	i2c_sample_entry_t *	entries;
+	size_t			entry_count;
+	i2c_sample_t *		ring;
+	uint32_t		ring_size;
+
+	/*
+	 * 	Set by the driver
+	 */
+	uint32_t		head;
+	uint32_t		tail;
+	uint32_t		ticks;
+	uint32_t		dropped;
+} i2c_sampler_t;
+
+/**
+ * 	@brief Initializes a sampler. The first tick reads all entries.
+ *
+ * 	@param sampler is the sampler
+ * 	@param bus is the I2C bus, &i2c_bus_default for the sb_i2c instance
+ * 	@param entries is the sampling table, which must stay valid while the sampler runs
+ * 	@param entry_count is the number of entries
+ * 	@param ring is the ring buffer
+ * 	@param ring_size is the number of samples of the ring buffer, a power of two
+ */
+void i2c_sampler_init(i2c_sampler_t *sampler, i2c_bus_t *bus, i2c_sample_entry_t *entries, size_t entry_count, i2c_sample_t *ring, uint32_t ring_size);
+
+/**
+ * 	@brief Reads the due entries into the ring buffer. Call from the timer interrupt handler. A due
+ * 	entry is dropped, without being read, if the ring buffer is full.
+ *
+ * 	@param sampler is the sampler
+ */
+void i2c_sampler_tick(i2c_sampler_t *sampler);
+
+/**
+ * 	@brief Takes samples out of the ring buffer, without waiting for any.
+ *
+ * 	@param sampler is the sampler
+ * 	@param samples is the buffer to take the samples to
+ * 	@param max is the maximum number of samples to take
+ * 	@return size_t the number of samples taken
+ */
+size_t i2c_sampler_read(i2c_sampler_t *sampler, i2c_sample_t *samples, size_t max);
+
+/**
+ * 	@brief Gets the number of samples dropped since the sampler was initialized, as the ring
+ * 	buffer was full.
+ *
+ * 	@param sampler is the sampler
+ * 	@return uint32_t the number of dropped samples
+ */
+uint32_t i2c_sampler_dropped(i2c_sampler_t *sampler);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,121 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+#include <generated/csr.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c_seq.h"
+
+#ifdef CSR_SB_I2C_SEQUENCER_CMD_ADDR
+
+/**
+ * 	@brief Gets a field of the sequencer status register.
+ */
+#define SEQ_STATUS_FIELD(status, field) \
+	(((status) >> CSR_SB_I2C_SEQUENCER_STATUS_##field##_OFFSET) & ((1 << CSR_SB_I2C_SEQUENCER_STATUS_##field##_SIZE) - 1))
+
+void
+i2c_seq_reset(void)
+{
+	sb_i2c_sequencer_control_write(1 << CSR_SB_I2C_SEQUENCER_CONTROL_RESET_OFFSET);
+}
+
+void
+i2c_seq_submit(const I2C_SEQ_CMD_t *cmds, size_t count)
+{
+	while (count > 0)
+	{
+		/*
+		 * 	Read the free space once, and then fill it without any further CSR reads
+		 */
+		size_t space = SEQ_STATUS_FIELD(sb_i2c_sequencer_status_read(), CMD_SPACE);
+
+		for (; space > 0 && count > 0; space--, count--, cmds++)
+		{
+			sb_i2c_sequencer_cmd_write(
+				0
+				| cmds->data << CSR_SB_I2C_SEQUENCER_CMD_DATA_OFFSET
+				| cmds->op << CSR_SB_I2C_SEQUENCER_CMD_OP_OFFSET
+			);
+		}
+	}
+}
+
+void
+i2c_seq_push(I2C_SEQ_OP_t op, uint8_t data)
+{
+	I2C_SEQ_CMD_t cmd = { op, data };
+
+	i2c_seq_submit(&cmd, 1);
+}
+
+bool
+i2c_seq_busy(void)
+{
+	return SEQ_STATUS_FIELD(sb_i2c_sequencer_status_read(), BUSY);
+}
+
+size_t
+i2c_seq_collect(uint8_t *data, size_t max)
+{
+	size_t count = 0;
+
+	while (count < max)
+	{
+		/*
+		 * 	Reading the RX register pops the RX FIFO
+		 */
+		uint32_t rx = sb_i2c_sequencer_rx_read();
+
+		if (!(rx & (1 << CSR_SB_I2C_SEQUENCER_RX_VALID_OFFSET)))
+		{
+			break;
+		}
+
+		data[count++] = rx >> CSR_SB_I2C_SEQUENCER_RX_DATA_OFFSET;
+	}
+
+	return count;
+}
+
+uint8_t
+i2c_seq_get_errors(void)
+{
+	uint32_t status = sb_i2c_sequencer_status_read();
+	uint8_t errors = 0
+		| (SEQ_STATUS_FIELD(status, NACK) ? kI2C_SEQ_ERROR_NACK_bm : 0)
+		| (SEQ_STATUS_FIELD(status, TIMEOUT) ? kI2C_SEQ_ERROR_TIMEOUT_bm : 0);
+
+#ifdef CSR_SB_I2C_SEQUENCER_STATUS_ARB_LOST_OFFSET
+	if (SEQ_STATUS_FIELD(status, ARB_LOST))
+	{
+		errors |= kI2C_SEQ_ERROR_ARB_LOST_bm;
+	}
+#endif
+
+	return errors;
+}
+
+#endif
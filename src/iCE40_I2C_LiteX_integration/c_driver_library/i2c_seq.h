@@ -0,0 +1,129 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+#ifndef __I2C_SEQ_H
+#define __I2C_SEQ_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 	Driver for the ICE40UP_I2C gateware sequencer (with_sequencer=True).
+ *
+ * 	A transaction is described as a list of commands, which the sequencer executes with the same
+ * 	System Bus register sequences as i2c_begin(), i2c_write(), i2c_read() and i2c_end(), while the
+ * 	CPU is free. Bytes read from the I2C bus are collected from the RX FIFO afterwards.
+ *
+ * 	A NACK or a timeout drops the commands still queued, and ends the transaction with a STOP.
+ * 	An arbitration loss drops them without a STOP. The commands submitted afterwards are executed,
+ * 	so a transaction has to be checked with i2c_seq_get_errors() before the next one is submitted.
+ */
+
+typedef enum I2C_SEQ_OP_enum
+{
+	kI2C_SEQ_OP_START     = 0, /* (Repeated) START, data is the slave address and R/W bit */
+	kI2C_SEQ_OP_WRITE     = 1, /* Write data */
+	kI2C_SEQ_OP_READ      = 2, /* Read a byte */
+	kI2C_SEQ_OP_READ_LAST = 3, /* Read the last byte, and STOP */
+	kI2C_SEQ_OP_STOP      = 4, /* STOP */
+} I2C_SEQ_OP_t;
+
+typedef enum I2C_SEQ_ERROR_enum
+{
+	kI2C_SEQ_ERROR_NACK_bm     = (0b1 << 0), /* A written byte or the slave address was not acknowledged */
+	kI2C_SEQ_ERROR_TIMEOUT_bm  = (0b1 << 1), /* Waiting for the I2C Status Register has timed out */
+	kI2C_SEQ_ERROR_ARB_LOST_bm = (0b1 << 2), /* Arbitration was lost */
+	kI2C_SEQ_ERROR_DMA_BUS_bm  = (0b1 << 3), /* A Wishbone access of the DMA engine has failed */
+} I2C_SEQ_ERROR_t;
+
+typedef struct
+{
+	uint8_t op;
+	uint8_t data;
+} I2C_SEQ_CMD_t;
+
+/*
+ * 	Command list helpers
+ */
+#define I2C_SEQ_START(address, is_read_cmd) ((I2C_SEQ_CMD_t){ kI2C_SEQ_OP_START, (uint8_t)((address) << 1 | ((is_read_cmd) ? 0b1 : 0b0)) })
+#define I2C_SEQ_WRITE(data)                 ((I2C_SEQ_CMD_t){ kI2C_SEQ_OP_WRITE, (uint8_t)(data) })
+#define I2C_SEQ_READ()                      ((I2C_SEQ_CMD_t){ kI2C_SEQ_OP_READ, 0 })
+#define I2C_SEQ_READ_LAST()                 ((I2C_SEQ_CMD_t){ kI2C_SEQ_OP_READ_LAST, 0 })
+#define I2C_SEQ_STOP()                      ((I2C_SEQ_CMD_t){ kI2C_SEQ_OP_STOP, 0 })
+
+/**
+ * 	@brief Flushes the sequencer FIFOs, and clears its errors.
+ */
+void i2c_seq_reset(void);
+
+/**
+ * 	@brief Pushes a command list to the sequencer. Returns as soon as the last command is queued.
+ *
+ * 	@param cmds is the command list
+ * 	@param count is the number of commands
+ */
+void i2c_seq_submit(const I2C_SEQ_CMD_t *cmds, size_t count);
+
+/**
+ * 	@brief Pushes a single command to the sequencer.
+ *
+ * 	@param op is the command operation
+ * 	@param data is the command data
+ */
+void i2c_seq_push(I2C_SEQ_OP_t op, uint8_t data);
+
+/**
+ * 	@brief Checks if the sequencer has pending or executing commands.
+ *
+ * 	@return true if the sequencer is busy
+ * 	@return false if all commands have been executed
+ */
+bool i2c_seq_busy(void);
+
+/**
+ * 	@brief Collects the bytes read by the sequencer so far.
+ *
+ * 	@param data is the buffer to store the bytes in
+ * 	@param max is the size of the buffer
+ * 	@return size_t the number of bytes collected
+ */
+size_t i2c_seq_collect(uint8_t *data, size_t max);
+
+/**
+ * 	@brief Gets the sequencer errors, since the last i2c_seq_reset().
+ *
+ * 	@return uint8_t the I2C_SEQ_ERROR_t bit mask
+ */
+uint8_t i2c_seq_get_errors(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
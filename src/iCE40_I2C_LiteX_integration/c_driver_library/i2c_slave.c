@@ -0,0 +1,422 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+#include <generated/csr.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c.h"
+#include "i2c_slave.h"
+#include "sb_i2c.h"
+#include "sb_i2c_regs.h"
+
+/*
+ * 	Interrupts used to service the stream mode slave
+ */
+static const uint8_t irq_mask = 0
+	| kI2CIRQEN_IRQHGCEN_bm
+	| kI2CIRQEN_IRQTROEEN_bm
+	| kI2CIRQEN_IRQTRRDYEN_bm;
+
+/**
+ * 	@brief Reinitializes the I2C Hard IP as a slave.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param address is the slave address.
+ * 	@param general_call sets if the hardware general call is received.
+ */
+static void
+i2c_slave_setup(i2c_bus_t *bus, uint8_t address, bool general_call)
+{
+	bus->general_call = general_call;
+	i2c_bus_init(bus);
+
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CSADDR, (address >> 2) & kI2CSADDR_7BIT_ADDR_bm);
+
+	/*
+	 * 	Stretch SCL until each byte has been serviced
+	 */
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CCMDR, 0x00);
+}
+
+/**
+ * 	@brief Runs the callback of a slave, if it has one.
+ *
+ * 	@param slave is the slave.
+ * 	@param event is the event.
+ */
+static void
+i2c_slave_notify(i2c_slave_t *slave, I2C_SLAVE_EVENT_t event)
+{
+	if (slave->callback != NULL)
+	{
+		slave->callback(slave, event);
+	}
+}
+
+/**
+ * 	@brief Moves a byte written by the host to the RX ring buffer.
+ *
+ * 	@param slave is the slave.
+ */
+static void
+i2c_slave_receive(i2c_slave_t *slave)
+{
+	uint8_t data = sb_i2c_get_register(slave->bus, kSB_I2C_REGS_I2CRXDR);
+	uint32_t head = slave->rx_head;
+
+	if (head - __atomic_load_n(&slave->rx_tail, __ATOMIC_ACQUIRE) >= slave->rx_size)
+	{
+		slave->rx_dropped++;
+		return;
+	}
+
+	slave->rx_ring[head & (slave->rx_size - 1)] = data;
+	__atomic_store_n(&slave->rx_head, head + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * 	@brief Accounts for the byte loaded in the transmit register, once it has moved to the shift
+ * 	register: a byte of the TX ring buffer is taken out of it, and a 0xFF is an underrun.
+ *
+ * 	@param slave is the slave.
+ */
+static void
+i2c_slave_sent(i2c_slave_t *slave)
+{
+	if (slave->tx_loaded)
+	{
+		__atomic_store_n(&slave->tx_tail, slave->tx_tail + 1, __ATOMIC_RELEASE);
+	}
+	else if (slave->tx_filler)
+	{
+		slave->tx_underruns++;
+	}
+	slave->tx_loaded = false;
+	slave->tx_filler = false;
+}
+
+/**
+ * 	@brief Loads the transmit register with the next byte of the TX ring buffer, or 0xFF if it is
+ * 	empty. The transmit register is ready again once the byte loaded before has moved to the shift
+ * 	register, which is then accounted for.
+ *
+ * 	@param slave is the slave.
+ */
+static void
+i2c_slave_transmit(i2c_slave_t *slave)
+{
+	uint32_t tail;
+	uint8_t data = 0xFF;
+
+	i2c_slave_sent(slave);
+	tail = slave->tx_tail;
+
+	if (tail == __atomic_load_n(&slave->tx_head, __ATOMIC_ACQUIRE))
+	{
+		i2c_slave_notify(slave, kI2C_SLAVE_EVENT_TX_EMPTY);
+	}
+
+	slave->tx_loaded = tail != __atomic_load_n(&slave->tx_head, __ATOMIC_ACQUIRE);
+	slave->tx_filler = !slave->tx_loaded;
+	if (slave->tx_loaded)
+	{
+		data = slave->tx_ring[tail & (slave->tx_size - 1)];
+	}
+
+	sb_i2c_set_register(slave->bus, kSB_I2C_REGS_I2CTXDR, data);
+}
+
+void
+i2c_bus_slave_init(i2c_bus_t *bus, i2c_slave_t *slave)
+{
+	slave->bus = bus;
+	slave->rx_head = 0;
+	slave->rx_tail = 0;
+	slave->tx_head = 0;
+	slave->tx_tail = 0;
+	slave->tx_loaded = false;
+	slave->tx_filler = false;
+	slave->rx_dropped = 0;
+	slave->tx_underruns = 0;
+	slave->gc_data = 0;
+	slave->gc_count = 0;
+
+	i2c_slave_setup(bus, slave->address, slave->general_call);
+	bus->slave = slave;
+
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CIRQ, irq_mask);
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CIRQEN, irq_mask);
+}
+
+void
+i2c_bus_slave_isr(i2c_bus_t *bus)
+{
+	i2c_slave_t *slave = bus->slave;
+	bool received = false;
+
+	sb_i2c_shadow_invalidate(bus);
+
+	/*
+	 * 	Clear the pending interrupts, by writing them back
+	 */
+	uint8_t irq = sb_i2c_get_register(bus, kSB_I2C_REGS_I2CIRQ);
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CIRQ, irq);
+
+	if (slave == NULL)
+	{
+		return;
+	}
+
+	if (irq & kI2CIRQ_IRQHGC_bm)
+	{
+		slave->gc_data = sb_i2c_get_register(bus, kSB_I2C_REGS_I2CGCDR);
+		slave->gc_count++;
+		i2c_slave_notify(slave, kI2C_SLAVE_EVENT_GENERAL_CALL);
+	}
+
+	/*
+	 * 	The host has not acknowledged the last byte it read, so a byte loaded after it is not
+	 * 	sent, and stays in the TX ring buffer. If the last byte has moved to the shift register
+	 * 	since the interrupt was last handled, it is the one loaded, and has been sent.
+	 */
+	if (irq & kI2CIRQ_IRQTROE_bm)
+	{
+		if (irq & kI2CIRQ_IRQTRRDY_bm)
+		{
+			i2c_slave_sent(slave);
+		}
+		slave->tx_loaded = false;
+		slave->tx_filler = false;
+	}
+
+	/*
+	 * 	Service the byte of the interrupt, which can be the last one received before a STOP, and
+	 * 	the next ones which are ready during the transaction, as the next one can already be while
+	 * 	the interrupt is handled
+	 */
+	uint8_t status = sb_i2c_get_status(bus);
+	bool ready = (irq & kI2CIRQ_IRQTRRDY_bm) && (status & kI2CSR_TRRDY_bm);
+
+	for (;; ready = false, status = sb_i2c_get_status(bus))
+	{
+		if (!ready && (status & (kI2CSR_BUSY_bm | kI2CSR_TRRDY_bm)) != (kI2CSR_BUSY_bm | kI2CSR_TRRDY_bm))
+		{
+			break;
+		}
+
+		if (status & kI2CSR_SRW_bm)
+		{
+			/*
+			 * 	No byte is loaded after the NACK of the host
+			 */
+			if (status & kI2CSR_TROE_bm)
+			{
+				break;
+			}
+			i2c_slave_transmit(slave);
+		}
+		else
+		{
+			i2c_slave_receive(slave);
+			received = true;
+		}
+	}
+
+	if (received)
+	{
+		i2c_slave_notify(slave, kI2C_SLAVE_EVENT_RX);
+	}
+}
+
+size_t
+i2c_slave_read(i2c_slave_t *slave, uint8_t *data, size_t max)
+{
+	uint32_t tail = slave->rx_tail;
+	uint32_t head = __atomic_load_n(&slave->rx_head, __ATOMIC_ACQUIRE);
+	size_t n = 0;
+
+	while (tail != head && n < max)
+	{
+		data[n++] = slave->rx_ring[tail++ & (slave->rx_size - 1)];
+	}
+
+	/*
+	 * 	Release the bytes only once they have been copied
+	 */
+	__atomic_store_n(&slave->rx_tail, tail, __ATOMIC_RELEASE);
+
+	return n;
+}
+
+size_t
+i2c_slave_write(i2c_slave_t *slave, const uint8_t *data, size_t len)
+{
+	uint32_t head = slave->tx_head;
+	uint32_t tail = __atomic_load_n(&slave->tx_tail, __ATOMIC_ACQUIRE);
+	size_t n = 0;
+
+	while (head - tail < slave->tx_size && n < len)
+	{
+		slave->tx_ring[head++ & (slave->tx_size - 1)] = data[n++];
+	}
+
+	/*
+	 * 	Publish the bytes only once they have been copied
+	 */
+	__atomic_store_n(&slave->tx_head, head, __ATOMIC_RELEASE);
+
+	return n;
+}
+
+void
+i2c_bus_slave_stop(i2c_bus_t *bus)
+{
+	sb_i2c_shadow_invalidate(bus);
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CIRQEN, 0x00);
+	bus->slave = NULL;
+
+#ifdef CSR_SB_I2C_TARGET_CONTROL_ADDR
+	/*
+	 * 	The gateware target releases the I2C Hard IP between transactions
+	 */
+	csr_write_simple(0, SB_I2C_CSR(bus, TARGET_CONTROL));
+	while (csr_read_simple(SB_I2C_CSR(bus, TARGET_STATUS)) & (1 << CSR_SB_I2C_TARGET_STATUS_ACTIVE_OFFSET));
+#endif
+
+	bus->general_call = false;
+	i2c_bus_init(bus);
+}
+
+bool
+i2c_bus_slave_regs_init(i2c_bus_t *bus, uint8_t address)
+{
+#ifdef CSR_SB_I2C_TARGET_CONTROL_ADDR
+	sb_i2c_shadow_invalidate(bus);
+	sb_i2c_set_register(bus, kSB_I2C_REGS_I2CIRQEN, 0x00);
+	bus->slave = NULL;
+
+	i2c_slave_setup(bus, address, false);
+	csr_write_simple(1 << CSR_SB_I2C_TARGET_CONTROL_ENABLE_OFFSET, SB_I2C_CSR(bus, TARGET_CONTROL));
+
+	return true;
+#else
+	(void)bus;
+	(void)address;
+
+	return false;
+#endif
+}
+
+void
+i2c_bus_slave_regs_write(i2c_bus_t *bus, uint8_t reg, const uint8_t *data, size_t len)
+{
+#ifdef CSR_SB_I2C_TARGET_CONTROL_ADDR
+	for (size_t i = 0; i < len; i++)
+	{
+		csr_write_simple((uint8_t)(reg + i), SB_I2C_CSR(bus, TARGET_REGS_ADR));
+		csr_write_simple(data[i], SB_I2C_CSR(bus, TARGET_REGS_DAT_W));
+	}
+#else
+	(void)bus;
+	(void)reg;
+	(void)data;
+	(void)len;
+#endif
+}
+
+void
+i2c_bus_slave_regs_read(i2c_bus_t *bus, uint8_t reg, uint8_t *data, size_t len)
+{
+#ifdef CSR_SB_I2C_TARGET_CONTROL_ADDR
+	for (size_t i = 0; i < len; i++)
+	{
+		csr_write_simple((uint8_t)(reg + i), SB_I2C_CSR(bus, TARGET_REGS_ADR));
+		data[i] = csr_read_simple(SB_I2C_CSR(bus, TARGET_REGS_DAT_R));
+	}
+#else
+	(void)bus;
+	(void)reg;
+	(void)data;
+	(void)len;
+#endif
+}
+
+uint16_t
+i2c_bus_slave_regs_writes(i2c_bus_t *bus)
+{
+#ifdef CSR_SB_I2C_TARGET_CONTROL_ADDR
+	return csr_read_simple(SB_I2C_CSR(bus, TARGET_STATUS)) >> CSR_SB_I2C_TARGET_STATUS_WRITES_OFFSET;
+#else
+	(void)bus;
+
+	return 0;
+#endif
+}
+
+/*
+ * 	API on the default bus, the sb_i2c instance
+ */
+
+void
+i2c_slave_init(i2c_slave_t *slave)
+{
+	i2c_bus_slave_init(&i2c_bus_default, slave);
+}
+
+void
+i2c_slave_isr(void)
+{
+	i2c_bus_slave_isr(&i2c_bus_default);
+}
+
+void
+i2c_slave_stop(void)
+{
+	i2c_bus_slave_stop(&i2c_bus_default);
+}
+
+bool
+i2c_slave_regs_init(uint8_t address)
+{
+	return i2c_bus_slave_regs_init(&i2c_bus_default, address);
+}
+
+void
+i2c_slave_regs_write(uint8_t reg, const uint8_t *data, size_t len)
+{
+	i2c_bus_slave_regs_write(&i2c_bus_default, reg, data, len);
+}
+
+void
+i2c_slave_regs_read(uint8_t reg, uint8_t *data, size_t len)
+{
+	i2c_bus_slave_regs_read(&i2c_bus_default, reg, data, len);
+}
+
+uint16_t
+i2c_slave_regs_writes(void)
+{
+	return i2c_bus_slave_regs_writes(&i2c_bus_default);
+}
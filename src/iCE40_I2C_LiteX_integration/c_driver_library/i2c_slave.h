@@ -0,0 +1,264 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+#ifndef __I2C_SLAVE_H
+#define __I2C_SLAVE_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 	Slave (target) mode, where a host on the I2C bus addresses the I2C Hard IP.
+ *
+ * 	The slave address is set at runtime through I2CSADDR, which holds its five most significant
+ * 	bits. Its two least significant bits are fixed by the corner of the I2C Hard IP: 0b01 for
+ * 	"upper_left", 0b10 for "upper_right" (the I2C_SLAVE_INIT_ADDR parameter of SB_I2C). The I2C
+ * 	Hard IP stretches SCL until each byte has been serviced.
+ *
+ * 	In stream mode, the bytes written by the host are moved to an RX ring buffer, and the bytes it
+ * 	reads are taken from a TX ring buffer, from the SB_I2C interrupt (with_irq=True). The SoC
+ * 	interrupt handler has to call i2c_slave_isr() when SB_I2C_INTERRUPT is pending. Both ring
+ * 	buffers are single-producer/single-consumer, and the application side never blocks. The
+ * 	hardware general call (address 0x00) is received, when enabled, with its second byte.
+ *
+ * 	In register file mode, the gateware target of ICE40UP_I2C (with_target=True) emulates a
+ * 	register file device without CPU work per byte: the first byte written by the host sets the
+ * 	register pointer, the following ones are written to the registers, and reads return the
+ * 	registers from the pointer on, which auto-increments. The application updates the registers
+ * 	with i2c_slave_regs_write() and collects the ones written by the host with
+ * 	i2c_slave_regs_read().
+ *
+ * 	The master API must not be used on an I2C bus while it is a slave.
+ */
+
+typedef enum I2C_SLAVE_EVENT_enum
+{
+	kI2C_SLAVE_EVENT_RX           = 0, /* Bytes written by the host have been put in the RX ring buffer */
+	kI2C_SLAVE_EVENT_TX_EMPTY     = 1, /* The host reads, and the TX ring buffer is empty */
+	kI2C_SLAVE_EVENT_GENERAL_CALL = 2, /* A hardware general call has been received */
+} I2C_SLAVE_EVENT_t;
+
+typedef struct i2c_slave i2c_slave_t;
+
+/*
+ * 	Called from the interrupt handler. On kI2C_SLAVE_EVENT_TX_EMPTY, it can queue bytes with
+ * 	i2c_slave_write(), else 0xFF is sent to the host.
+ */
+typedef void (*i2c_slave_callback_t)(i2c_slave_t *slave, I2C_SLAVE_EVENT_t event);
+
+/*
+ * 	Stream mode slave. The ring buffer indices run freely, and are only written by one side each:
+ * 	rx_head and tx_tail by the interrupt handler, rx_tail and tx_head by the application.
+ */
+struct i2c_slave
+{
+	uint8_t			address;
+	bool			general_call;
+	uint8_t *		rx_ring;
+	uint32_t		rx_size;
+	uint8_t *		tx_ring;
+	uint32_t		tx_size;
+	i2c_slave_callback_t	callback;
+	void *			context;
+
+	/*
+	 * 	Set by the driver. tx_loaded is set while the byte at tx_tail has been loaded in the
+	 * 	transmit register, and is only taken out of the TX ring buffer once it has been sent.
+	 * 	tx_filler is set while 0xFF has been loaded instead, as the TX ring buffer was empty.
+	 */
+	i2c_bus_t *		bus;
+	uint32_t		rx_head;
+	uint32_t		rx_tail;
+	uint32_t		tx_head;
+	uint32_t		tx_tail;
+	bool			tx_loaded;
+	bool			tx_filler;
+
+	/*
+	 * 	Bytes written by the host while the RX ring buffer was full, and bytes sent as 0xFF while
+	 * 	the TX ring buffer was empty
+	 */
+	uint32_t		rx_dropped;
+	uint32_t		tx_underruns;
+
+	/*
+	 * 	Second byte of the last hardware general call (I2CGCDR), and number of general calls
+	 */
+	uint8_t			gc_data;
+	uint32_t		gc_count;
+};
+
+/**
+ * 	@brief Makes the I2C bus a stream mode slave, and enables its interrupts in the I2C Hard IP,
+ * 	which it reinitializes. The SB_I2C interrupt is enabled in the SoC with i2c_async_init().
+ *
+ * 	@param slave is the slave, with the address, general_call, ring buffers and callback set. The
+ * 	ring buffer sizes are powers of two. It must stay valid until i2c_slave_stop().
+ */
+void i2c_slave_init(i2c_slave_t *slave);
+
+/**
+ * 	@brief Services the slave. Call from the SoC interrupt handler.
+ */
+void i2c_slave_isr(void);
+
+/**
+ * 	@brief Takes bytes written by the host out of the RX ring buffer, without waiting for any.
+ *
+ * 	@param slave is the slave
+ * 	@param data is the buffer to take the bytes to
+ * 	@param max is the maximum number of bytes to take
+ * 	@return size_t the number of bytes taken
+ */
+size_t i2c_slave_read(i2c_slave_t *slave, uint8_t *data, size_t max);
+
+/**
+ * 	@brief Queues bytes for the host to read in the TX ring buffer, without waiting for space.
+ *
+ * 	@param slave is the slave
+ * 	@param data is the bytes
+ * 	@param len is the number of bytes
+ * 	@return size_t the number of bytes queued
+ */
+size_t i2c_slave_write(i2c_slave_t *slave, const uint8_t *data, size_t len);
+
+/**
+ * 	@brief Stops the slave mode, in stream or register file mode, and reinitializes the I2C Hard IP
+ * 	for the master API. The I2C Hard IP still acknowledges its slave address, but no longer
+ * 	stretches SCL.
+ */
+void i2c_slave_stop(void);
+
+/**
+ * 	@brief Makes the I2C bus a register file mode slave, with the gateware target of
+ * 	ICE40UP_I2C (with_target=True). Reinitializes the I2C Hard IP, and leaves its interrupts
+ * 	disabled. The registers keep their values.
+ *
+ * 	@param address is the slave address
+ * 	@return true if the slave mode has started
+ * 	@return false without the gateware target
+ */
+bool i2c_slave_regs_init(uint8_t address);
+
+/**
+ * 	@brief Sets registers of the register file mode slave. A host read in progress can return
+ * 	either value of a register being set.
+ *
+ * 	@param reg is the first register
+ * 	@param data is the register values
+ * 	@param len is the number of registers, which wrap at the target_depth of the target
+ */
+void i2c_slave_regs_write(uint8_t reg, const uint8_t *data, size_t len);
+
+/**
+ * 	@brief Gets registers of the register file mode slave, as last written by either side.
+ *
+ * 	@param reg is the first register
+ * 	@param data is the buffer to store the register values in
+ * 	@param len is the number of registers
+ */
+void i2c_slave_regs_read(uint8_t reg, uint8_t *data, size_t len);
+
+/**
+ * 	@brief Gets the number of register writes by the host, which wraps at 65536. A change tells
+ * 	that the host has written registers.
+ *
+ * 	@return uint16_t the number of register writes
+ */
+uint16_t i2c_slave_regs_writes(void);
+
+/**
+ * 	@brief Makes an I2C bus a stream mode slave, see i2c_slave_init().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param slave is the slave
+ */
+void i2c_bus_slave_init(i2c_bus_t *bus, i2c_slave_t *slave);
+
+/**
+ * 	@brief Services the slave of an I2C bus. Call from the SoC interrupt handler.
+ *
+ * 	@param bus is the I2C bus
+ */
+void i2c_bus_slave_isr(i2c_bus_t *bus);
+
+/**
+ * 	@brief Stops the slave mode of an I2C bus, see i2c_slave_stop().
+ *
+ * 	@param bus is the I2C bus
+ */
+void i2c_bus_slave_stop(i2c_bus_t *bus);
+
+/**
+ * 	@brief Makes an I2C bus a register file mode slave, see i2c_slave_regs_init().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param address is the slave address
+ * 	@return true if the slave mode has started
+ * 	@return false without the gateware target
+ */
+bool i2c_bus_slave_regs_init(i2c_bus_t *bus, uint8_t address);
+
+/**
+ * 	@brief Sets registers of the register file mode slave of an I2C bus, see
+ * 	i2c_slave_regs_write().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param reg is the first register
+ * 	@param data is the register values
+ * 	@param len is the number of registers
+ */
+void i2c_bus_slave_regs_write(i2c_bus_t *bus, uint8_t reg, const uint8_t *data, size_t len);
+
+/**
+ * 	@brief Gets registers of the register file mode slave of an I2C bus, see
+ * 	i2c_slave_regs_read().
+ *
+ * 	@param bus is the I2C bus
+ * 	@param reg is the first register
+ * 	@param data is the buffer to store the register values in
+ * 	@param len is the number of registers
+ */
+void i2c_bus_slave_regs_read(i2c_bus_t *bus, uint8_t reg, uint8_t *data, size_t len);
+
+/**
+ * 	@brief Gets the number of register writes by the host on an I2C bus, see
+ * 	i2c_slave_regs_writes().
+ *
+ * 	@param bus is the I2C bus
+ * 	@return uint16_t the number of register writes
+ */
+uint16_t i2c_bus_slave_regs_writes(i2c_bus_t *bus);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
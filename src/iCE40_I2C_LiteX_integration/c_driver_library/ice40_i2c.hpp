@@ -0,0 +1,705 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+
+#ifndef __ICE40_I2C_HPP
+#define __ICE40_I2C_HPP
+
+#include <generated/csr.h>
+#include <generated/soc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c.h"
+#include "sb_i2c_regs.h"
+
+/*
+ * 	Header-only C++ driver of an ICE40UP_I2C instance, for C++17.
+ *
+ * 	The instance, clock and I2C bus frequency are template parameters, so the prescaler is computed
+ * 	at compile time and every System Bus access is inlined down to its CSR (or Wishbone) stores:
+ * 	* RegsBase != 0: one store to the Wishbone bridge (with_wishbone)
+ * 	* sbcmd CSR: one CSR store per write, once the command FIFO has space (with_sb_command)
+ * 	* otherwise: the System Bus handshake of the C driver, with the Read/Write and Strobe signals
+ * 	  set in a single SBCTRL store, as their values are known at compile time
+ *
+ * 	Write commands are cleared after sending, as the C driver does, to avoid sending them again.
+ *
+ * 	The System Bus Strobe is left deasserted after each access, as the C driver leaves it, and the C
+ * 	driver writes its System Bus CSRs again at each call, so both can drive the same instance.
+ * 	c_bus() gives the i2c_bus_t of the instance for the C API, for example for i2c_bus_transfer(),
+ * 	or to share the I2C bus with its lock hooks. init() rewrites the speed registers, so the C
+ * 	driver writes them again at its next call on c_bus().
+ *
+ * 	For example, for the sb_i2c instance:
+ *
+ * 	using I2c = Ice40I2c<CSR_SB_I2C_BASE, CONFIG_CLOCK_FREQUENCY, 400000>;
+ */
+#if defined(CONFIG_CSR_DATA_WIDTH)
+static_assert(CONFIG_CSR_DATA_WIDTH == 32, "Ice40I2c accesses each CSR with a single csr_read_simple() or csr_write_simple(), which requires csr_data_width=32");
+#endif
+
+template<uintptr_t CsrBase, uint32_t SysClk, uint32_t BusHz, uintptr_t RegsBase = 0>
+class Ice40I2c
+{
+	static_assert(BusHz > 0 && SysClk / BusHz / 4 >= 1, "The I2C bus frequency is too high for the system clock");
+
+public:
+	/*
+	 * 	I2C clock prescaler, for the I2CBRLSB/I2CBRMSB registers, as I2C_BUS_PRESCALER()
+	 */
+	static constexpr uint16_t prescaler = (SysClk + 4 * BusHz - 1) / (4 * BusHz) - 1;
+
+	static_assert(prescaler <= (kI2CBRMSB_bm << 8 | kI2CBRLSB_bm), "The prescaler does not fit the 10-bit I2CBRLSB/I2CBRMSB");
+
+	/**
+	 * 	@brief Sets a System Bus Register.
+	 *
+	 * 	@param address is the register address to set.
+	 * 	@param data is the data to set.
+	 */
+	static inline void
+	set_register(SB_I2C_REGS_t address, uint8_t data)
+	{
+		if constexpr (RegsBase != 0)
+		{
+			reg(address) = data;
+		}
+		else
+		{
+#ifdef CSR_SB_I2C_SBCMD_ADDR
+			wait_sbcmd_space();
+			csr_write_simple(
+				0
+				| (uint32_t)data << CSR_SB_I2C_SBCMD_DATA_OFFSET
+				| (uint32_t)address << CSR_SB_I2C_SBCMD_ADDR_OFFSET
+				| 1 << CSR_SB_I2C_SBCMD_RW_OFFSET,
+				csr(CSR_SB_I2C_SBCMD_ADDR)
+			);
+#else
+			csr_write_simple(address, csr(CSR_SB_I2C_SBADRI_ADDR));
+			csr_write_simple(data, csr(CSR_SB_I2C_SBDATI_ADDR));
+			csr_write_simple(
+				0
+				| 1 << CSR_SB_I2C_SBCTRL_SBRWI_OFFSET
+				| 1 << CSR_SB_I2C_SBCTRL_SBSTBI_OFFSET,
+				csr(CSR_SB_I2C_SBCTRL_ADDR)
+			);
+			while (!(csr_read_simple(csr(CSR_SB_I2C_SBSTATUS_ADDR)) & (1 << CSR_SB_I2C_SBSTATUS_SBACKO_OFFSET)));
+			csr_write_simple(0, csr(CSR_SB_I2C_SBCTRL_ADDR));
+#endif
+		}
+	}
+
+	/**
+	 * 	@brief Gets a System Bus Register.
+	 *
+	 * 	@param address is the register address to get.
+	 * 	@return uint8_t the data.
+	 */
+	static inline uint8_t
+	get_register(SB_I2C_REGS_t address)
+	{
+		if constexpr (RegsBase != 0)
+		{
+			return reg(address);
+		}
+		else
+		{
+#ifdef CSR_SB_I2C_SBCMD_ADDR
+			uint32_t status;
+
+			wait_sbcmd_space();
+			csr_write_simple(
+				0
+				| (uint32_t)address << CSR_SB_I2C_SBCMD_ADDR_OFFSET
+				| 0 << CSR_SB_I2C_SBCMD_RW_OFFSET,
+				csr(CSR_SB_I2C_SBCMD_ADDR)
+			);
+			do
+			{
+				status = csr_read_simple(csr(CSR_SB_I2C_SBCMD_STATUS_ADDR));
+			} while (status & (1 << CSR_SB_I2C_SBCMD_STATUS_BUSY_OFFSET));
+
+			return status >> CSR_SB_I2C_SBCMD_STATUS_DATA_OFFSET;
+#else
+			csr_write_simple(address, csr(CSR_SB_I2C_SBADRI_ADDR));
+			csr_write_simple(1 << CSR_SB_I2C_SBCTRL_SBSTBI_OFFSET, csr(CSR_SB_I2C_SBCTRL_ADDR));
+			while (!(csr_read_simple(csr(CSR_SB_I2C_SBSTATUS_ADDR)) & (1 << CSR_SB_I2C_SBSTATUS_SBACKO_OFFSET)));
+			uint8_t data = csr_read_simple(csr(CSR_SB_I2C_SBDATO_ADDR));
+			csr_write_simple(0, csr(CSR_SB_I2C_SBCTRL_ADDR));
+
+			return data;
+#endif
+		}
+	}
+
+	/**
+	 * 	@brief Gets the I2C Status Register, from the status mirror when present.
+	 *
+	 * 	@return uint8_t the I2C Status Register.
+	 */
+	static inline uint8_t
+	get_status()
+	{
+#ifdef CSR_SB_I2C_SBMIRROR_ADDR
+		uint32_t mirror;
+
+		do
+		{
+			mirror = csr_read_simple(csr(CSR_SB_I2C_SBMIRROR_ADDR));
+		} while (!(mirror & (1 << CSR_SB_I2C_SBMIRROR_VALID_OFFSET)));
+
+		return mirror >> CSR_SB_I2C_SBMIRROR_I2CSR_OFFSET;
+#else
+		return get_register(kSB_I2C_REGS_I2CSR);
+#endif
+	}
+
+	/**
+	 * 	@brief Waits for any of the given I2C Status Register bits to be set.
+	 *
+	 * 	@param mask is the bits to wait for.
+	 * 	@return true if any of the bits was set.
+	 * 	@return false if waiting has timed out, in which case the I2C Hard IP is reinitialized.
+	 */
+	static inline bool
+	wait_for_status(uint8_t mask)
+	{
+		uint8_t status;
+
+		return wait(mask, true, status);
+	}
+
+	/**
+	 * 	@brief Initializes the I2C Hard IP, see i2c_init().
+	 */
+	static inline void
+	init()
+	{
+		end();
+		set_register(kSB_I2C_REGS_I2CCR1, 0 | kI2CCR1_SDA_DEL_SEL_300NS_gc | kI2CCR1_I2CEN_bm);
+		set_register(kSB_I2C_REGS_I2CBRLSB, prescaler & 0xFF);
+		set_register(kSB_I2C_REGS_I2CBRMSB, prescaler >> 8);
+
+		/*
+		 * 	The speed of c_bus() may differ, and the C driver skips the writes of the registers it
+		 * 	last wrote, so it forgets them all
+		 */
+		c_bus().shadow_valid = 0;
+	}
+
+	/**
+	 * 	@brief Sends a START, or a repeated START, see i2c_begin().
+	 *
+	 * 	@param address is the slave address.
+	 * 	@param is_read_cmd sets the read or write command.
+	 * 	@return true if the I2C bus is ready.
+	 * 	@return false if the slave did not acknowledge a read command, or waiting has timed out.
+	 */
+	static inline bool
+	begin(uint8_t address, bool is_read_cmd)
+	{
+		return start(address, is_read_cmd) == kI2C_STATUS_OK;
+	}
+
+	/**
+	 * 	@brief Writes a byte, see i2c_write().
+	 *
+	 * 	@param data is the byte to write.
+	 * 	@return true if the slave acknowledged it.
+	 * 	@return false if the slave did not acknowledge it, or waiting has timed out.
+	 */
+	static inline bool
+	write(uint8_t data)
+	{
+		set_register(kSB_I2C_REGS_I2CTXDR, data);
+		send_command(0 | kI2CCMDR_CKSDIS_bm | kI2CCMDR_WR_bm);
+
+		/*
+		 * 	At TRRDY, RARC is still the acknowledge of the previous byte
+		 */
+		return wait_for_status(kI2CSR_TRRDY_bm) && wait_for_ack() == kI2C_STATUS_OK;
+	}
+
+	/**
+	 * 	@brief Reads a byte, see i2c_read(). The last read NACKs the byte in progress, and STOPs.
+	 *
+	 * 	@param is_last_read sets if this is the last read.
+	 * 	@return uint8_t the read byte.
+	 */
+	static inline uint8_t
+	read(bool is_last_read)
+	{
+		if (is_last_read)
+		{
+			set_register(kSB_I2C_REGS_I2CCMDR, 0 | kI2CCMDR_CKSDIS_bm | kI2CCMDR_ACK_bm | kI2CCMDR_RD_bm | kI2CCMDR_STO_bm);
+		}
+		wait_for_status(kI2CSR_TRRDY_bm);
+
+		return get_register(kSB_I2C_REGS_I2CRXDR);
+	}
+
+	/**
+	 * 	@brief Sends a STOP, see i2c_end().
+	 */
+	static inline void
+	end()
+	{
+		set_register(kSB_I2C_REGS_I2CCMDR, 0 | kI2CCMDR_CKSDIS_bm | kI2CCMDR_STO_bm);
+	}
+
+	/**
+	 * 	@brief Scans for a slave with given address, see i2c_scan().
+	 *
+	 * 	@param address is the slave address.
+	 * 	@return true if the slave was found (ACK received).
+	 */
+	static inline bool
+	scan(uint8_t address)
+	{
+		/*
+		 * 	Address only, as sb_i2c_probe(): the address is in the shift register at TRRDY, and
+		 * 	its acknowledge is checked once it has been sent, before the STOP
+		 */
+		return finish(start(address, false)) == kI2C_STATUS_OK;
+	}
+
+	/**
+	 * 	@brief Writes a buffer to a slave, see i2c_write_buf().
+	 *
+	 * 	@param address is the slave address.
+	 * 	@param data is the buffer to write.
+	 * 	@param len is the number of bytes to write.
+	 * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the first error
+	 */
+	static inline I2C_STATUS_t
+	write_buf(uint8_t address, const uint8_t *data, size_t len)
+	{
+		I2C_STATUS_t status = start(address, false);
+
+		if (status == kI2C_STATUS_OK)
+		{
+			status = write_burst(data, len);
+		}
+
+		return finish(status);
+	}
+
+	/**
+	 * 	@brief Reads a buffer from a slave, see i2c_read_buf().
+	 *
+	 * 	@param address is the slave address.
+	 * 	@param data is the buffer to read to.
+	 * 	@param len is the number of bytes to read.
+	 * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the first error
+	 */
+	static inline I2C_STATUS_t
+	read_buf(uint8_t address, uint8_t *data, size_t len)
+	{
+		if (len == 0)
+		{
+			return kI2C_STATUS_OK;
+		}
+
+		I2C_STATUS_t status = start(address, true);
+
+		if (status != kI2C_STATUS_OK)
+		{
+			return finish(status);
+		}
+
+		return read_burst(data, len);
+	}
+
+	/**
+	 * 	@brief Reads consecutive registers of a slave, see i2c_reg_read().
+	 *
+	 * 	@param address is the slave address.
+	 * 	@param reg is the first register.
+	 * 	@param data is the buffer to read to.
+	 * 	@param len is the number of registers to read.
+	 * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the first error
+	 */
+	static inline I2C_STATUS_t
+	reg_read(uint8_t address, uint8_t reg, uint8_t *data, size_t len)
+	{
+		I2C_STATUS_t status = start(address, false);
+
+		if (status == kI2C_STATUS_OK)
+		{
+			status = write_burst(&reg, 1);
+		}
+
+		if (status != kI2C_STATUS_OK || len == 0)
+		{
+			return finish(status);
+		}
+
+		/*
+		 * 	The register is acknowledged before the repeated START
+		 */
+		status = wait_for_ack();
+
+		if (status == kI2C_STATUS_OK)
+		{
+			status = start(address, true);
+		}
+
+		if (status != kI2C_STATUS_OK)
+		{
+			return finish(status);
+		}
+
+		return read_burst(data, len);
+	}
+
+	/**
+	 * 	@brief Writes consecutive registers of a slave, see i2c_reg_write().
+	 *
+	 * 	@param address is the slave address.
+	 * 	@param reg is the first register.
+	 * 	@param data is the buffer to write.
+	 * 	@param len is the number of registers to write.
+	 * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the first error
+	 */
+	static inline I2C_STATUS_t
+	reg_write(uint8_t address, uint8_t reg, const uint8_t *data, size_t len)
+	{
+		I2C_STATUS_t status = start(address, false);
+
+		if (status == kI2C_STATUS_OK)
+		{
+			status = write_burst(&reg, 1);
+		}
+		if (status == kI2C_STATUS_OK)
+		{
+			status = write_burst(data, len);
+		}
+
+		return finish(status);
+	}
+
+	/**
+	 * 	@brief Gets the I2C bus of the instance, for the C API. There is a single one per instance,
+	 * 	initialized as I2C_BUS_INIT() at the I2C bus frequency of the instance, so its lock hooks,
+	 * 	arbitration retries and driver state are shared by all the C calls on it.
+	 *
+	 * 	@return i2c_bus_t& the I2C bus.
+	 */
+	static inline i2c_bus_t &
+	c_bus()
+	{
+		/*
+		 * 	Constant initialized, the members I2C_BUS_INIT() leaves out are zero as in C
+		 */
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmissing-field-initializers"
+		static i2c_bus_t bus = I2C_BUS_INIT_PRESCALER(CsrBase, RegsBase, prescaler);
+#pragma GCC diagnostic pop
+
+		return bus;
+	}
+
+private:
+	/*
+	 * 	System clock cycles before giving up, kSB_I2C_CONFIG_TIMEOUT_SCL_PERIODS as the C driver
+	 */
+	static constexpr uint64_t timeout_cycles = (uint64_t)kSB_I2C_CONFIG_TIMEOUT_SCL_PERIODS * 4 * (prescaler + 1);
+
+	/*
+	 * 	Status reads before giving up without the uptime of timer0, as kSB_I2C_CONFIG_TRRDY_TIMEOUT
+	 * 	scaled by the C driver
+	 */
+	static constexpr uint32_t status_timeout = (uint32_t)kSB_I2C_CONFIG_TRRDY_TIMEOUT *
+#if defined(CSR_SB_I2C_SBMIRROR_ADDR)
+		kSB_I2C_CONFIG_STATUS_MIRROR_TIMEOUT_SCALE;
+#elif defined(CSR_SB_I2C_SBCMD_ADDR)
+		kSB_I2C_CONFIG_FAST_ACCESS_TIMEOUT_SCALE;
+#else
+		(RegsBase != 0 ? kSB_I2C_CONFIG_FAST_ACCESS_TIMEOUT_SCALE : 1);
+#endif
+
+	/**
+	 * 	@brief Gets the address of a CSR of the instance.
+	 *
+	 * 	@param address is the address of the CSR of the sb_i2c instance.
+	 * 	@return unsigned long the address of the CSR.
+	 */
+	static constexpr unsigned long
+	csr(unsigned long address)
+	{
+		return CsrBase + (address - CSR_SB_I2C_BASE);
+	}
+
+	/**
+	 * 	@brief Gets a register of the Wishbone bridge, one 32-bit word per register.
+	 *
+	 * 	@param address is the register address.
+	 * 	@return volatile uint32_t& the register.
+	 */
+	static inline volatile uint32_t &
+	reg(SB_I2C_REGS_t address)
+	{
+		return *reinterpret_cast<volatile uint32_t *>(RegsBase + ((uint32_t)address << 2));
+	}
+
+#ifdef CSR_SB_I2C_SBCMD_ADDR
+	/**
+	 * 	@brief Waits until a command written to the sbcmd CSR is not dropped, as the C driver does.
+	 */
+	static inline void
+	wait_sbcmd_space()
+	{
+#ifdef CSR_SB_I2C_SBCMD_STATUS_FULL_OFFSET
+		while (csr_read_simple(csr(CSR_SB_I2C_SBCMD_STATUS_ADDR)) & (1 << CSR_SB_I2C_SBCMD_STATUS_FULL_OFFSET));
+#else
+		while (csr_read_simple(csr(CSR_SB_I2C_SBCMD_STATUS_ADDR)) & (1 << CSR_SB_I2C_SBCMD_STATUS_BUSY_OFFSET));
+#endif
+	}
+#endif
+
+	/**
+	 * 	@brief Waits for any of the given I2C Status Register bits to be set, or, with is_set false,
+	 * 	for all of them to be clear, see sb_i2c_wait().
+	 *
+	 * 	@param mask is the I2C Status Register bit mask to wait for.
+	 * 	@param is_set sets if the bits are waited to be set or clear.
+	 * 	@param status is set to the last I2C Status Register read.
+	 * 	@return true if the bits reached the awaited state.
+	 * 	@return false if waiting has timed out, in which case the I2C Hard IP is reinitialized.
+	 */
+	static inline bool
+	wait(uint8_t mask, bool is_set, uint8_t &status)
+	{
+#ifdef CSR_TIMER0_UPTIME_CYCLES_ADDR
+		timer0_uptime_latch_write(1);
+		const uint64_t deadline = timer0_uptime_cycles_read() + timeout_cycles;
+
+		for (;;)
+		{
+			status = get_status();
+			if (((status & mask) != 0) == is_set)
+			{
+				return true;
+			}
+
+			timer0_uptime_latch_write(1);
+			if (timer0_uptime_cycles_read() > deadline)
+			{
+				break;
+			}
+		}
+#else
+		for (uint32_t i = 0; i < status_timeout; i++)
+		{
+			status = get_status();
+			if (((status & mask) != 0) == is_set)
+			{
+				return true;
+			}
+		}
+#endif
+
+		init();
+
+		return false;
+	}
+
+	/**
+	 * 	@brief Sends a write command, and clears it, see sb_i2c_send_command().
+	 *
+	 * 	@param command is the command to send.
+	 */
+	static inline void
+	send_command(uint8_t command)
+	{
+		set_register(kSB_I2C_REGS_I2CCMDR, command);
+		set_register(kSB_I2C_REGS_I2CCMDR, kI2CCMDR_CKSDIS_bm);
+	}
+
+	/**
+	 * 	@brief Sends a START, or a repeated START, see sb_i2c_start().
+	 *
+	 * 	@param address is the slave address.
+	 * 	@param is_read_cmd sets the read or write command.
+	 * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error.
+	 */
+	static inline I2C_STATUS_t
+	start(uint8_t address, bool is_read_cmd)
+	{
+		uint8_t status;
+
+		set_register(kSB_I2C_REGS_I2CTXDR, address << 1 | (is_read_cmd ? 0b1 : 0b0));
+		send_command(0 | kI2CCMDR_CKSDIS_bm | kI2CCMDR_WR_bm | kI2CCMDR_STA_bm);
+
+		if (!is_read_cmd)
+		{
+			return wait(kI2CSR_TRRDY_bm, true, status) ? kI2C_STATUS_OK : kI2C_STATUS_TIMEOUT;
+		}
+
+		/*
+		 * 	The Master receiving mode (SRW) is never entered if the slave does not acknowledge its
+		 * 	address, which is then known once the address has been sent
+		 */
+		if (!wait(kI2CSR_SRW_bm | kI2CSR_TRRDY_bm, true, status))
+		{
+			return kI2C_STATUS_TIMEOUT;
+		}
+		if (!(status & kI2CSR_SRW_bm))
+		{
+			if (!wait(kI2CSR_TIP_bm, false, status))
+			{
+				return kI2C_STATUS_TIMEOUT;
+			}
+			if ((status & (kI2CSR_SRW_bm | kI2CSR_RARC_bm)) == kI2CSR_RARC_bm)
+			{
+				return kI2C_STATUS_NACK;
+			}
+			if (!wait(kI2CSR_SRW_bm, true, status))
+			{
+				return kI2C_STATUS_TIMEOUT;
+			}
+		}
+		set_register(kSB_I2C_REGS_I2CCMDR, 0 | kI2CCMDR_CKSDIS_bm | kI2CCMDR_RD_bm);
+
+		return kI2C_STATUS_OK;
+	}
+
+	/**
+	 * 	@brief Waits for the last byte written to be sent, and checks its acknowledge.
+	 *
+	 * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error.
+	 */
+	static inline I2C_STATUS_t
+	wait_for_ack()
+	{
+		uint8_t status;
+
+		if (!wait(kI2CSR_TIP_bm, false, status))
+		{
+			return kI2C_STATUS_TIMEOUT;
+		}
+
+		return (status & kI2CSR_RARC_bm) ? kI2C_STATUS_NACK : kI2C_STATUS_OK;
+	}
+
+	/**
+	 * 	@brief Ends a write transaction, see sb_i2c_finish(): checks the acknowledge of the last
+	 * 	byte, and sends a STOP, unless waiting has timed out and the I2C Hard IP was reinitialized.
+	 *
+	 * 	@param status is the status of the transaction so far.
+	 * 	@return I2C_STATUS_t the status of the transaction.
+	 */
+	static inline I2C_STATUS_t
+	finish(I2C_STATUS_t status)
+	{
+		if (status == kI2C_STATUS_OK)
+		{
+			status = wait_for_ack();
+		}
+
+		if (status != kI2C_STATUS_TIMEOUT)
+		{
+			end();
+		}
+
+		return status;
+	}
+
+	/**
+	 * 	@brief Writes bytes in an I2C write transaction that has already begun, see
+	 * 	sb_i2c_write_burst().
+	 *
+	 * 	@param data is the buffer to write.
+	 * 	@param len is the number of bytes to write.
+	 * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the first error, at which it stops. The acknowledge
+	 * 	of the last byte is not checked.
+	 */
+	static inline I2C_STATUS_t
+	write_burst(const uint8_t *data, size_t len)
+	{
+		uint8_t status;
+
+		for (size_t i = 0; i < len; i++)
+		{
+			set_register(kSB_I2C_REGS_I2CTXDR, data[i]);
+			send_command(0 | kI2CCMDR_CKSDIS_bm | kI2CCMDR_WR_bm);
+
+			if (!wait(kI2CSR_TRRDY_bm, true, status))
+			{
+				return kI2C_STATUS_TIMEOUT;
+			}
+			if (status & kI2CSR_RARC_bm)
+			{
+				return kI2C_STATUS_NACK;
+			}
+		}
+
+		return kI2C_STATUS_OK;
+	}
+
+	/**
+	 * 	@brief Reads bytes in an I2C read transaction that has already begun, and ends it, see
+	 * 	sb_i2c_read_burst().
+	 *
+	 * 	@param data is the buffer to read to.
+	 * 	@param len is the number of bytes to read.
+	 * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the first error. It stops at a timeout, but not at
+	 * 	an overrun, so that the transaction still ends.
+	 */
+	static inline I2C_STATUS_t
+	read_burst(uint8_t *data, size_t len)
+	{
+		I2C_STATUS_t result = kI2C_STATUS_OK;
+		uint8_t status;
+
+		for (size_t i = 0; i < len; i++)
+		{
+			if (i + 1 == len)
+			{
+				set_register(kSB_I2C_REGS_I2CCMDR, 0 | kI2CCMDR_CKSDIS_bm | kI2CCMDR_ACK_bm | kI2CCMDR_RD_bm | kI2CCMDR_STO_bm);
+			}
+
+			if (!wait(kI2CSR_TRRDY_bm, true, status))
+			{
+				return kI2C_STATUS_TIMEOUT;
+			}
+
+			/*
+			 * 	TROE without RARC is an overrun, with RARC it is the NACK of the last byte
+			 */
+			if ((status & kI2CSR_TROE_bm) && !(status & kI2CSR_RARC_bm) && result == kI2C_STATUS_OK)
+			{
+				result = kI2C_STATUS_OVERRUN;
+			}
+
+			data[i] = get_register(kSB_I2C_REGS_I2CRXDR);
+		}
+
+		return result;
+	}
+};
+
+#endif
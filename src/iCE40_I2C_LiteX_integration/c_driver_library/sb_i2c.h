@@ -0,0 +1,233 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+#ifndef __SB_I2C_H
+#define __SB_I2C_H
+
+#include <generated/soc.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include "i2c.h"
+#include "sb_i2c_regs.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * 	System Bus access to the SB_I2C hard IP registers, shared by the driver modules.
+ */
+
+/*
+ * 	Address of a CSR of the ICE40UP_I2C instance of a bus. All instances have the CSR layout of
+ * 	the sb_i2c instance.
+ */
+#define SB_I2C_CSR(bus, name) ((bus)->csr_base + (CSR_SB_I2C_##name##_ADDR - CSR_SB_I2C_BASE))
+
+/*
+ * 	The CSRs of an instance are accessed through SB_I2C_CSR() with csr_read_simple() and
+ * 	csr_write_simple(), a single access per CSR, which only holds all the fields of a CSR with
+ * 	32-bit wide CSRs
+ */
+#if defined(CONFIG_CSR_DATA_WIDTH) && CONFIG_CSR_DATA_WIDTH != 32
+#error "The SB_I2C driver requires csr_data_width=32"
+#endif
+
+/**
+ * 	@brief Sets a System Bus Register.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param address is the register address to set.
+ * 	@param data is the data to set.
+ */
+void sb_i2c_set_register(i2c_bus_t *bus, SB_I2C_REGS_t address, uint8_t data);
+
+/**
+ * 	@brief Gets a System Bus Register.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param address is the register address to get.
+ * 	@return uint8_t the data.
+ */
+uint8_t sb_i2c_get_register(i2c_bus_t *bus, SB_I2C_REGS_t address);
+
+/**
+ * 	@brief Gets the I2C Status Register.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@return uint8_t the I2C Status Register.
+ */
+uint8_t sb_i2c_get_status(i2c_bus_t *bus);
+
+/**
+ * 	@brief Forgets the values last written to the System Bus CSRs, for them to be written again at
+ * 	the next access. Called at the beginning of each call which takes the lock of the I2C bus, and
+ * 	of the transfers which do not, as the C++ driver may have accessed the instance in between.
+ *
+ * 	@param bus is the I2C bus.
+ */
+void sb_i2c_shadow_invalidate(i2c_bus_t *bus);
+
+/**
+ * 	@brief Scales a timeout, given in legacy CSR System Bus reads of the I2C Status Register, to the
+ * 	number of reads with the access method in use.
+ *
+ * 	@param timeout is the timeout.
+ * 	@return uint32_t the scaled timeout.
+ */
+uint32_t sb_i2c_scale_timeout(uint32_t timeout);
+
+/**
+ * 	@brief Starts a deadline, the given number of SCL periods at the active I2C bus frequency from
+ * 	now with the uptime of timer0, or else kSB_I2C_CONFIG_TRRDY_TIMEOUT scaled I2C Status Register
+ * 	reads per kSB_I2C_CONFIG_TIMEOUT_SCL_PERIODS SCL periods.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param timeout is the deadline to start.
+ * 	@param periods is the number of SCL periods.
+ */
+void sb_i2c_deadline_start(i2c_bus_t *bus, i2c_timeout_t *timeout, uint32_t periods);
+
+/**
+ * 	@brief Starts the timeout of a wait on the I2C Hard IP, a deadline of
+ * 	kSB_I2C_CONFIG_TIMEOUT_SCL_PERIODS.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param timeout is the timeout to start.
+ */
+void sb_i2c_timeout_start(i2c_bus_t *bus, i2c_timeout_t *timeout);
+
+/**
+ * 	@brief Checks a timeout started with sb_i2c_timeout_start() or sb_i2c_deadline_start(), once
+ * 	per I2C Status Register read.
+ *
+ * 	@param timeout is the timeout.
+ * 	@return true if the timeout has expired.
+ * 	@return false otherwise.
+ */
+bool sb_i2c_timeout_expired(i2c_timeout_t *timeout);
+
+/**
+ * 	@brief Checks the address phase of a read command START: it ends in the Master receiving mode
+ * 	(SRW) if the slave acknowledges its address, and without it otherwise.
+ *
+ * 	@param status is the I2C Status Register.
+ * 	@param result is set to kI2C_STATUS_OK, kI2C_STATUS_NACK or kI2C_STATUS_ARB_LOST once the
+ * 	address phase has ended.
+ * 	@return true if the address phase has ended.
+ * 	@return false if the address is still being sent.
+ */
+bool sb_i2c_address_done(uint8_t status, I2C_STATUS_t *result);
+
+/**
+ * 	@brief Waits for the address phase of a read command START to end, see sb_i2c_address_done().
+ *
+ * 	@param bus is the I2C bus.
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK in the Master receiving mode, kI2C_STATUS_NACK,
+ * 	kI2C_STATUS_ARB_LOST or kI2C_STATUS_TIMEOUT. The I2C Hard IP is not reset.
+ */
+I2C_STATUS_t sb_i2c_wait_for_srw(i2c_bus_t *bus);
+
+/**
+ * 	@brief Waits for the last byte written to be sent, and checks its acknowledge.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, kI2C_STATUS_NACK, kI2C_STATUS_ARB_LOST or
+ * 	kI2C_STATUS_TIMEOUT. The I2C Hard IP is not reset.
+ */
+I2C_STATUS_t sb_i2c_wait_for_ack(i2c_bus_t *bus);
+
+/**
+ * 	@brief Applies the speed profile of a device, if the I2C bus runs at another speed, and selects
+ * 	its clock stretching. Call between transactions.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param address is the slave address.
+ */
+void sb_i2c_select_speed(i2c_bus_t *bus, uint8_t address);
+
+/**
+ * 	@brief Gets the Clock Stretching Disable bit of the I2CCMDR commands of the transaction, as
+ * 	selected by sb_i2c_select_speed().
+ *
+ * 	@param bus is the I2C bus.
+ * 	@return uint8_t kI2CCMDR_CKSDIS_bm, or 0 to stretch.
+ */
+static inline uint8_t
+sb_i2c_cksdis(i2c_bus_t *bus)
+{
+	return bus->stretch ? 0 : kI2CCMDR_CKSDIS_bm;
+}
+
+/**
+ * 	@brief Accounts the status of a transaction to the speed profile selected for it: counts an
+ * 	overrun, and turns clock stretching on for kI2C_STRETCH_AUTO.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param status is the status of the transaction.
+ */
+void sb_i2c_monitor(i2c_bus_t *bus, I2C_STATUS_t status);
+
+/**
+ * 	@brief Sends a START, or a repeated START, with the slave address and mode. Does not take the
+ * 	lock of the I2C bus.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param address is the slave address.
+ * 	@param is_read_cmd sets the read or write command.
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error. The I2C Hard IP is not reset.
+ */
+I2C_STATUS_t sb_i2c_start(i2c_bus_t *bus, uint8_t address, bool is_read_cmd);
+
+/**
+ * 	@brief Sends a STOP. Does not release the lock of the I2C bus.
+ *
+ * 	@param bus is the I2C bus.
+ */
+void sb_i2c_stop(i2c_bus_t *bus);
+
+/**
+ * 	@brief Writes and then reads a slave in a single transaction, see i2c_bus_write_read(). Does
+ * 	not take the lock of the I2C bus. Applies the speed of the slave, which only writes the
+ * 	prescaler if it differs from the one in use.
+ *
+ * 	@param bus is the I2C bus.
+ * 	@param address is the slave address.
+ * 	@param wr is the buffer to write.
+ * 	@param wr_len is the number of bytes to write.
+ * 	@param rd is the buffer to read to.
+ * 	@param rd_len is the number of bytes to read.
+ * 	@param stop sets if the read ends with a STOP. Otherwise, the I2C bus is held for the next call
+ * 	to begin with a repeated START, unless the read has failed. The next call has to be to the
+ * 	same slave, as the speed of the slave is applied before its START.
+ * 	@return I2C_STATUS_t kI2C_STATUS_OK, or the error. The I2C Hard IP is reset after a timeout.
+ */
+I2C_STATUS_t sb_i2c_write_read(i2c_bus_t *bus, uint8_t address, const uint8_t *wr, size_t wr_len, uint8_t *rd, size_t rd_len, bool stop);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -19,11 +19,35 @@
 # 	DEALINGS IN THE SOFTWARE.
 
 
+from functools import reduce
+from operator import or_
+
 from litex.soc.integration.doc import AutoDoc, ModuleDoc
 from litex.soc.integration.soc import (
+    FSM,
+    Array,
+    Case,
+    Cat,
+    Const,
+    If,
     Instance,
+    Memory,
     Module,
+    Mux,
+    NextState,
+    NextValue,
+    Record,
+    Replicate,
+    ResetInserter,
     Signal,
+    bits_for,
+)
+from migen.genlib.cdc import MultiReg
+from litex.soc.interconnect import stream, wishbone
+from litex.soc.interconnect.csr_eventmanager import (
+    EventManager,
+    EventSourceLevel,
+    EventSourcePulse,
 )
 from litex.soc.interconnect.csr import (
     AutoCSR,
@@ -34,9 +58,1506 @@ from litex.soc.interconnect.csr import (
 )
 
 
+#   SB_I2C registers and bits used in gateware, see c_driver_library/sb_i2c_regs.h
+SB_I2C_REGS_I2CCR1 = 0x8
+SB_I2C_REGS_I2CCMDR = 0x9
+SB_I2C_REGS_I2CBRLSB = 0xA
+SB_I2C_REGS_I2CBRMSB = 0xB
+SB_I2C_REGS_I2CSR = 0xC
+SB_I2C_REGS_I2CTXDR = 0xD
+SB_I2C_REGS_I2CRXDR = 0xE
+SB_I2C_REGS_I2CSADDR = 0x3
+SB_I2C_REGS_I2CIRQEN = 0x7
+SB_I2C_REGS_I2CIRQ = 0x6
+
+I2CCMDR_CKSDIS = 1 << 2
+I2CCMDR_ACK = 1 << 3
+I2CCMDR_WR = 1 << 4
+I2CCMDR_RD = 1 << 5
+I2CCMDR_STO = 1 << 6
+I2CCMDR_STA = 1 << 7
+
+I2CSR_TRRDY = 1 << 2
+I2CSR_ARBL = 1 << 3
+I2CSR_SRW = 1 << 4
+I2CSR_RARC = 1 << 5
+I2CSR_BUSY = 1 << 6
+I2CSR_TIP = 1 << 7
+
+#   SB_I2C hard IP of each corner of the iCE40UP: System Bus address bits 7..4,
+#   and initial I2C slave address
+SB_I2C_CORNERS = {
+    "upper_left": (0b0001, "0b1111100001"),
+    "upper_right": (0b0011, "0b1111100010"),
+}
+
+#   Internal System Bus interface of the SB_I2C hard IP
+SB_LAYOUT = [
+    ("adr", 4),
+    ("dat_w", 8),
+    ("dat_r", 8),
+    ("we", 1),
+    ("stb", 1),
+    ("ack", 1),
+]
+
+
+class SBArbiter(Module):
+    """Fixed priority arbiter between System Bus masters.
+
+    masters[0] has the highest priority. A grant is held for as long as the
+    granted master keeps its strobe asserted, so an access is never split.
+    """
+
+    def __init__(self, masters: list, slave: Record) -> None:
+        grant = Signal(max=max(len(masters), 2))
+
+        stbs = Array(master.stb for master in masters)
+
+        #   Pick the highest priority requesting master when the bus is free
+        choose = []
+        for i, master in reversed(list(enumerate(masters))):
+            if choose:
+                choose = [If(master.stb, grant.eq(i)).Else(*choose)]
+            else:
+                choose = [If(master.stb, grant.eq(i))]
+        self.sync += If(~stbs[grant], *choose)
+
+        self.comb += [
+            slave.adr.eq(Array(master.adr for master in masters)[grant]),
+            slave.dat_w.eq(Array(master.dat_w for master in masters)[grant]),
+            slave.we.eq(Array(master.we for master in masters)[grant]),
+            slave.stb.eq(stbs[grant]),
+        ]
+        for i, master in enumerate(masters):
+            self.comb += [
+                master.dat_r.eq(slave.dat_r),
+                master.ack.eq(slave.ack & (grant == i)),
+            ]
+
+
+#   Sequencer command opcodes
+SEQ_OP_START = 0
+SEQ_OP_WRITE = 1
+SEQ_OP_READ = 2
+SEQ_OP_READ_LAST = 3
+SEQ_OP_STOP = 4
+
+
+class ICE40UP_I2CSequencer(Module, AutoCSR, AutoDoc):
+    def __init__(
+        self, sb: Record, depth: int = 16, timeout: int = 2**20
+    ) -> None:
+        self.intro = ModuleDoc(
+            """ICE40UP_I2C Sequencer.
+            Executes I2C transactions from a command FIFO, with the same System
+            Bus register sequences as the C driver's ``i2c_begin``,
+            ``i2c_write``, ``i2c_read`` and ``i2c_end``. Bytes read from the
+            I2C bus are pushed to the RX FIFO. Each written byte, address
+            included, is acknowledged once it has been sent (TIP clear), and a
+            read address once SRW is set, or NACKed if the address phase ends
+            without it. A NACK, or a wait that lasts more than ``timeout``
+            system clock cycles, sets NACK or TIMEOUT, drops the pending
+            commands and releases the I2C bus. An arbitration loss sets
+            ARB_LOST and drops the pending commands, without a STOP, as the
+            I2C bus is not driven anymore. A WR command is cleared after it
+            has been written to I2CCMDR, keeping CKSDIS, as the C driver does.
+            """
+        )
+
+        #   Sequencer Command
+        self._cmd = CSRStorage(
+            size=11,
+            fields=[
+                CSRField(
+                    name="DATA",
+                    size=8,
+                    description="""Slave address and R/W bit for START, data for WRITE""",
+                ),
+                CSRField(
+                    name="OP",
+                    size=3,
+                    description="""Command operation""",
+                    values=[
+                        (SEQ_OP_START, "START", "(Repeated) START and slave address"),
+                        (SEQ_OP_WRITE, "WRITE", "Write a byte"),
+                        (SEQ_OP_READ, "READ", "Read a byte"),
+                        (SEQ_OP_READ_LAST, "READ_LAST", "Read the last byte, and STOP"),
+                        (SEQ_OP_STOP, "STOP", "STOP"),
+                    ],
+                ),
+            ],
+        )
+
+        #   Sequencer Received Data, reading pops the RX FIFO
+        self._rx = CSRStatus(
+            size=9,
+            fields=[
+                CSRField(
+                    name="DATA",
+                    size=8,
+                    description="""Received byte""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="VALID",
+                    size=1,
+                    description="""DATA holds a received byte""",
+                    access=CSRAccess.ReadOnly,
+                ),
+            ],
+        )
+
+        #   Sequencer Status
+        self._status = CSRStatus(
+            fields=[
+                CSRField(
+                    name="BUSY",
+                    size=1,
+                    description="""Commands are pending or executing""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="NACK",
+                    size=1,
+                    description="""A written byte or the slave address was not acknowledged""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="TIMEOUT",
+                    size=1,
+                    description="""Waiting for the I2C Status Register has timed out""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="CMD_SPACE",
+                    size=bits_for(depth),
+                    description="""Free entries in the command FIFO""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="RX_LEVEL",
+                    size=bits_for(depth),
+                    description="""Bytes in the RX FIFO""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="ARB_LOST",
+                    size=1,
+                    description="""Arbitration was lost""",
+                    access=CSRAccess.ReadOnly,
+                ),
+            ],
+        )
+
+        #   Sequencer Control
+        self._control = CSRStorage(
+            fields=[
+                CSRField(
+                    name="RESET",
+                    size=1,
+                    pulse=True,
+                    description="""Flush the FIFOs and clear the errors""",
+                ),
+            ],
+        )
+
+        reset = self._control.fields.RESET
+
+        #   Command and received data streams of the DMA engine, which replace
+        #   the CSRs while dma_active is set
+        self.dma_cmd = stream.Endpoint([("op", 3), ("data", 8)])
+        self.dma_rx = stream.Endpoint([("data", 8)])
+        self.dma_active = Signal()
+        self.busy = Signal()
+        self.nack = Signal()
+        self.timed_out = Signal()
+        self.arb_lost = Signal()
+
+        #   FIFOs
+        cmd_fifo = ResetInserter()(
+            stream.SyncFIFO([("op", 3), ("data", 8)], depth)
+        )
+        rx_fifo = ResetInserter()(stream.SyncFIFO([("data", 8)], depth))
+        self.submodules.cmd_fifo = cmd_fifo
+        self.submodules.rx_fifo = rx_fifo
+        self.comb += [
+            cmd_fifo.reset.eq(reset),
+            rx_fifo.reset.eq(reset),
+            If(
+                self.dma_active,
+                self.dma_cmd.connect(cmd_fifo.sink),
+                rx_fifo.source.connect(self.dma_rx),
+            ).Else(
+                cmd_fifo.sink.valid.eq(self._cmd.re),
+                cmd_fifo.sink.op.eq(self._cmd.fields.OP),
+                cmd_fifo.sink.data.eq(self._cmd.fields.DATA),
+                self._rx.fields.DATA.eq(rx_fifo.source.data),
+                self._rx.fields.VALID.eq(rx_fifo.source.valid),
+                rx_fifo.source.ready.eq(self._rx.we),
+            ),
+        ]
+
+        #   Errors
+        nack = self.nack
+        set_nack = Signal()
+        timed_out = self.timed_out
+        set_timed_out = Signal()
+        arb_lost = self.arb_lost
+        set_arb_lost = Signal()
+        self.sync += [
+            If(reset, nack.eq(0)).Elif(set_nack, nack.eq(1)),
+            If(reset, timed_out.eq(0)).Elif(set_timed_out, timed_out.eq(1)),
+            If(reset, arb_lost.eq(0)).Elif(set_arb_lost, arb_lost.eq(1)),
+        ]
+
+        #   I2CSR wait timer
+        waiting = Signal()
+        timer = Signal(max=timeout + 1)
+        self.sync += If(~waiting, timer.eq(0)).Elif(
+            timer != timeout, timer.eq(timer + 1)
+        )
+
+        #   System Bus accesses, with the strobe released for at least one
+        #   cycle between consecutive accesses
+        sb_req = Signal()
+        self.sync += If(sb.ack, sb.stb.eq(0)).Elif(sb_req, sb.stb.eq(1))
+
+        data = Signal(8)
+
+        self.submodules.fsm = fsm = FSM(reset_state="IDLE")
+
+        def sb_write(state, adr, dat, *on_ack):
+            fsm.act(
+                state,
+                sb_req.eq(~sb.stb),
+                sb.we.eq(1),
+                sb.adr.eq(adr),
+                sb.dat_w.eq(dat),
+                If(sb.ack, *on_ack),
+            )
+
+        #   An arbitration loss frees the transmit register as well, so it is
+        #   checked first, as in sb_i2c_wait()
+        def sb_wait(state, ready, *on_ready):
+            fsm.act(
+                state,
+                waiting.eq(1),
+                sb_req.eq(~sb.stb),
+                sb.adr.eq(SB_I2C_REGS_I2CSR),
+                If(
+                    sb.ack,
+                    If(
+                        (sb.dat_r & I2CSR_ARBL) != 0,
+                        set_arb_lost.eq(1),
+                        NextState("DROP"),
+                    ).Elif(
+                        ready,
+                        *on_ready,
+                    ).Elif(
+                        timer >= timeout,
+                        set_timed_out.eq(1),
+                        NextState("ABORT"),
+                    ),
+                ),
+            )
+
+        fsm.act(
+            "IDLE",
+            cmd_fifo.source.ready.eq(1),
+            If(
+                cmd_fifo.source.valid,
+                NextValue(data, cmd_fifo.source.data),
+                Case(
+                    cmd_fifo.source.op,
+                    {
+                        SEQ_OP_START: NextState("START"),
+                        SEQ_OP_WRITE: NextState("WRITE"),
+                        SEQ_OP_READ: NextState("READ"),
+                        SEQ_OP_READ_LAST: NextState("READ_LAST"),
+                        SEQ_OP_STOP: NextState("STOP"),
+                    },
+                ),
+            ),
+        )
+
+        #   START: i2c_begin()
+        sb_write(
+            "START", SB_I2C_REGS_I2CTXDR, data, NextState("START_CMD")
+        )
+        sb_write(
+            "START_CMD",
+            SB_I2C_REGS_I2CCMDR,
+            I2CCMDR_CKSDIS | I2CCMDR_WR | I2CCMDR_STA,
+            NextState("START_CLEAR"),
+        )
+        sb_write(
+            "START_CLEAR",
+            SB_I2C_REGS_I2CCMDR,
+            I2CCMDR_CKSDIS,
+            If(data[0], NextState("START_WAIT_SRW")).Else(
+                NextState("WRITE_WAIT")
+            ),
+        )
+        #   A read address phase ends in the receiving mode (SRW), or without
+        #   it if the slave does not acknowledge, see sb_i2c_address_done()
+        sb_wait(
+            "START_WAIT_SRW",
+            ((sb.dat_r & I2CSR_SRW) != 0)
+            | (
+                (sb.dat_r & (I2CSR_TRRDY | I2CSR_TIP | I2CSR_RARC))
+                == (I2CSR_TRRDY | I2CSR_RARC)
+            ),
+            If(
+                (sb.dat_r & I2CSR_SRW) != 0,
+                NextState("START_READ"),
+            ).Else(
+                set_nack.eq(1),
+                NextState("ABORT"),
+            ),
+        )
+        sb_write(
+            "START_READ",
+            SB_I2C_REGS_I2CCMDR,
+            I2CCMDR_CKSDIS | I2CCMDR_RD,
+            NextState("IDLE"),
+        )
+
+        #   WRITE: i2c_write()
+        sb_write(
+            "WRITE", SB_I2C_REGS_I2CTXDR, data, NextState("WRITE_CMD")
+        )
+        sb_write(
+            "WRITE_CMD",
+            SB_I2C_REGS_I2CCMDR,
+            I2CCMDR_CKSDIS | I2CCMDR_WR,
+            NextState("WRITE_CLEAR"),
+        )
+        sb_write(
+            "WRITE_CLEAR",
+            SB_I2C_REGS_I2CCMDR,
+            I2CCMDR_CKSDIS,
+            NextState("WRITE_WAIT"),
+        )
+        #   At TRRDY, RARC is still the acknowledge of the previous byte, the
+        #   one of this byte is known once it has been sent, as in
+        #   sb_i2c_wait_for_ack()
+        sb_wait(
+            "WRITE_WAIT",
+            (sb.dat_r & I2CSR_TRRDY) != 0,
+            NextState("WRITE_ACK"),
+        )
+        sb_wait(
+            "WRITE_ACK",
+            (sb.dat_r & I2CSR_TIP) == 0,
+            If(
+                (sb.dat_r & I2CSR_RARC) != 0,
+                set_nack.eq(1),
+                NextState("ABORT"),
+            ).Else(
+                NextState("IDLE"),
+            ),
+        )
+
+        #   READ_LAST: i2c_read(true)
+        sb_write(
+            "READ_LAST",
+            SB_I2C_REGS_I2CCMDR,
+            I2CCMDR_CKSDIS | I2CCMDR_ACK | I2CCMDR_RD | I2CCMDR_STO,
+            NextState("READ"),
+        )
+
+        #   READ: i2c_read(false)
+        sb_wait("READ", (sb.dat_r & I2CSR_TRRDY) != 0, NextState("READ_SPACE"))
+        fsm.act(
+            "READ_SPACE",
+            If(rx_fifo.sink.ready, NextState("READ_DATA")),
+        )
+        fsm.act(
+            "READ_DATA",
+            sb_req.eq(~sb.stb),
+            sb.adr.eq(SB_I2C_REGS_I2CRXDR),
+            rx_fifo.sink.valid.eq(sb.ack),
+            rx_fifo.sink.data.eq(sb.dat_r),
+            If(sb.ack, NextState("IDLE")),
+        )
+
+        #   STOP: i2c_end()
+        sb_write(
+            "STOP",
+            SB_I2C_REGS_I2CCMDR,
+            I2CCMDR_CKSDIS | I2CCMDR_STO,
+            NextState("IDLE"),
+        )
+
+        #   Drop the rest of the transaction, and release the I2C bus
+        fsm.act(
+            "ABORT",
+            cmd_fifo.source.ready.eq(1),
+            If(~cmd_fifo.source.valid, NextState("STOP")),
+        )
+
+        #   Drop the rest of the transaction, after an arbitration loss
+        fsm.act(
+            "DROP",
+            cmd_fifo.source.ready.eq(1),
+            If(~cmd_fifo.source.valid, NextState("IDLE")),
+        )
+
+        self.comb += [
+            self.busy.eq(~fsm.ongoing("IDLE") | cmd_fifo.source.valid),
+            self._status.fields.BUSY.eq(self.busy),
+            self._status.fields.NACK.eq(nack),
+            self._status.fields.TIMEOUT.eq(timed_out),
+            self._status.fields.CMD_SPACE.eq(depth - cmd_fifo.level),
+            self._status.fields.RX_LEVEL.eq(rx_fifo.level),
+            self._status.fields.ARB_LOST.eq(arb_lost),
+        ]
+
+
+class ICE40UP_I2CDMA(Module, AutoCSR, AutoDoc):
+    def __init__(self, sequencer: ICE40UP_I2CSequencer) -> None:
+        self.intro = ModuleDoc(
+            """ICE40UP_I2C DMA.
+            Wishbone bus master which streams a buffer from memory to an I2C
+            slave, or received bytes from an I2C slave to memory, through the
+            sequencer. A transfer is a single I2C transaction (START, address,
+            ``length`` bytes, STOP). The sequencer must be idle when a transfer
+            starts, and its CSR interface is disabled while the transfer runs.
+            Errors are reported in the sequencer status, and end the transfer:
+            the sequencer has already released the I2C bus after a NACK or a
+            TIMEOUT, and no longer drives it after an arbitration loss. A
+            Wishbone error sets BUS_ERROR: a failed fetch ends the transaction
+            with a STOP, and after a failed write the rest of the received
+            bytes are dropped, while the transaction completes.
+            """
+        )
+
+        self.bus = bus = wishbone.Interface(data_width=32)
+        self.done = Signal()
+
+        #   DMA Buffer Address
+        self._address = CSRStorage(32, description="Buffer byte address.")
+
+        #   DMA Buffer Length
+        self._length = CSRStorage(16, description="Buffer length in bytes, up to 65535.")
+
+        #   DMA Control
+        self._control = CSRStorage(
+            fields=[
+                CSRField(
+                    name="START",
+                    size=1,
+                    pulse=True,
+                    description="""Start a transfer""",
+                ),
+                CSRField(
+                    name="READ",
+                    size=1,
+                    description="""Transfer direction. Write (memory to I2C)=0, Read (I2C to memory)=1""",
+                ),
+                CSRField(
+                    name="ADDR",
+                    size=7,
+                    description="""I2C slave address""",
+                ),
+            ],
+        )
+
+        #   DMA Status
+        self._status = CSRStatus(
+            fields=[
+                CSRField(
+                    name="BUSY",
+                    size=1,
+                    description="""Transfer in progress""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="BUS_ERROR",
+                    size=1,
+                    description="""A Wishbone access of the last transfer has failed""",
+                    access=CSRAccess.ReadOnly,
+                ),
+            ],
+        )
+
+        address = Signal(32)
+        rx_address = Signal(32)
+        remaining = Signal(16)
+        read = Signal()
+        slave = Signal(7)
+        data = Signal(8)
+        bus_error = Signal()
+
+        start = self._control.fields.START
+        cmd = sequencer.dma_cmd
+        rx = sequencer.dma_rx
+
+        self.sync += [
+            If(start, rx_address.eq(self._address.storage)).Elif(
+                bus.ack & bus.we, rx_address.eq(rx_address + 1)
+            ),
+            If(start, bus_error.eq(0)).Elif(bus.err, bus_error.eq(1)),
+        ]
+
+        self.submodules.fsm = fsm = FSM(reset_state="IDLE")
+
+        def push(state, *body):
+            #   No more commands are queued once the sequencer reports an error,
+            #   it drops the queued ones and ends the transaction itself
+            fsm.act(
+                state,
+                If(
+                    sequencer.timed_out | sequencer.nack | sequencer.arb_lost,
+                    NextState("WAIT"),
+                ).Else(*body),
+            )
+
+        fsm.act(
+            "IDLE",
+            If(
+                start,
+                NextValue(address, self._address.storage),
+                NextValue(remaining, self._length.storage),
+                NextValue(read, self._control.fields.READ),
+                NextValue(slave, self._control.fields.ADDR),
+                NextState("START"),
+            ),
+        )
+        push(
+            "START",
+            cmd.valid.eq(1),
+            cmd.op.eq(SEQ_OP_START),
+            cmd.data.eq(Cat(read, slave)),
+            If(
+                cmd.ready,
+                If(remaining == 0, NextState("STOP"))
+                .Elif(read, NextState("READ"))
+                .Else(NextState("FETCH")),
+            ),
+        )
+
+        #   Memory to I2C
+        lanes = Array(bus.dat_r[8 * i : 8 * (i + 1)] for i in range(4))
+        fsm.act(
+            "FETCH",
+            If(
+                bus.ack,
+                NextValue(data, lanes[address[0:2]]),
+                NextState("WRITE"),
+            ).Elif(
+                bus.err,
+                NextState("STOP"),
+            ),
+        )
+        push(
+            "WRITE",
+            cmd.valid.eq(1),
+            cmd.op.eq(SEQ_OP_WRITE),
+            cmd.data.eq(data),
+            If(
+                cmd.ready,
+                NextValue(address, address + 1),
+                NextValue(remaining, remaining - 1),
+                If(remaining == 1, NextState("STOP")).Else(NextState("FETCH")),
+            ),
+        )
+        push(
+            "STOP",
+            cmd.valid.eq(1),
+            cmd.op.eq(SEQ_OP_STOP),
+            If(cmd.ready, NextState("WAIT")),
+        )
+
+        #   I2C to memory, the received bytes are written while the commands
+        #   are being queued
+        push(
+            "READ",
+            cmd.valid.eq(1),
+            cmd.op.eq(Mux(remaining == 1, SEQ_OP_READ_LAST, SEQ_OP_READ)),
+            If(
+                cmd.ready,
+                NextValue(remaining, remaining - 1),
+                If(remaining == 1, NextState("WAIT")),
+            ),
+        )
+
+        fsm.act(
+            "WAIT",
+            If(
+                ~sequencer.busy & ~rx.valid,
+                self.done.eq(1),
+                NextState("IDLE"),
+            ),
+        )
+
+        rx_sel = Signal(4)
+        self.comb += [
+            Case(rx_address[0:2], {i: rx_sel.eq(1 << i) for i in range(4)}),
+            If(
+                fsm.ongoing("FETCH"),
+                bus.cyc.eq(1),
+                bus.stb.eq(1),
+                bus.adr.eq(address[2:]),
+                bus.sel.eq(0b1111),
+            ).Elif(
+                rx.valid & bus_error,
+                rx.ready.eq(1),
+            ).Elif(
+                rx.valid,
+                bus.cyc.eq(1),
+                bus.stb.eq(1),
+                bus.we.eq(1),
+                bus.adr.eq(rx_address[2:]),
+                bus.sel.eq(rx_sel),
+                bus.dat_w.eq(Replicate(rx.data, 4)),
+                rx.ready.eq(bus.ack | bus.err),
+            ),
+            sequencer.dma_active.eq(~fsm.ongoing("IDLE")),
+            self._status.fields.BUSY.eq(~fsm.ongoing("IDLE")),
+            self._status.fields.BUS_ERROR.eq(bus_error),
+        ]
+
+
+class ICE40UP_I2CRecovery(Module, AutoCSR, AutoDoc):
+    def __init__(self, scl: Signal, sda: Signal, max_pulses: int = 9) -> None:
+        self.intro = ModuleDoc(
+            """ICE40UP_I2C Bus Recovery.
+            Frees the I2C bus from a slave which holds SDA low, after it has
+            lost track of a transaction, as in section 3.1.16 of the I2C
+            specification (UM10204). While it runs, it overrides the SCL and
+            SDA pin drivers of the hard IP: it releases SDA, generates up to
+            ``max_pulses`` SCL pulses until the slave releases SDA, and then a
+            STOP. Each SCL phase lasts HALF_PERIOD system clock cycles, and
+            clock stretching is not followed. The hard IP has to be
+            reinitialized afterwards, as it has seen the pulses on its inputs.
+            The STATUS CSR also gives the levels of the SCL and SDA lines at
+            any time.
+            """
+        )
+
+        #   Bus Recovery Control
+        self._control = CSRStorage(
+            fields=[
+                CSRField(
+                    name="START",
+                    size=1,
+                    pulse=True,
+                    description="""Start a bus recovery""",
+                ),
+                CSRField(
+                    name="HALF_PERIOD",
+                    size=16,
+                    description="""SCL half period, in system clock cycles""",
+                ),
+            ],
+        )
+
+        #   Bus Recovery Status
+        self._status = CSRStatus(
+            fields=[
+                CSRField(
+                    name="SCL",
+                    size=1,
+                    description="""Level of the SCL line""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="SDA",
+                    size=1,
+                    description="""Level of the SDA line""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="BUSY",
+                    size=1,
+                    description="""A bus recovery is running""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="PULSES",
+                    size=bits_for(max_pulses),
+                    description="""SCL pulses generated by the last bus recovery""",
+                    access=CSRAccess.ReadOnly,
+                ),
+            ],
+        )
+
+        #   Pin driver override: the pins are driven low when set, and
+        #   released otherwise, while active is set
+        self.active = Signal()
+        self.scl_low = Signal()
+        self.sda_low = Signal()
+
+        #   Line levels, synchronized to the system clock
+        scl_level = Signal(reset=1)
+        sda_level = Signal(reset=1)
+        self.specials += [
+            MultiReg(scl, scl_level, reset=1),
+            MultiReg(sda, sda_level, reset=1),
+        ]
+
+        #   SCL phase timer
+        timer = Signal(16)
+        reload = Signal()
+        elapsed = Signal()
+        self.comb += elapsed.eq(timer == 0)
+        self.sync += If(
+            reload,
+            timer.eq(self._control.fields.HALF_PERIOD),
+        ).Elif(
+            ~elapsed,
+            timer.eq(timer - 1),
+        )
+
+        pulses = Signal(max=max_pulses + 1)
+
+        self.submodules.fsm = fsm = FSM(reset_state="IDLE")
+
+        def phase(state, scl_low, sda_low, *on_elapsed):
+            fsm.act(
+                state,
+                self.scl_low.eq(scl_low),
+                self.sda_low.eq(sda_low),
+                If(elapsed, reload.eq(1), *on_elapsed),
+            )
+
+        fsm.act(
+            "IDLE",
+            If(
+                self._control.fields.START,
+                reload.eq(1),
+                NextValue(pulses, 0),
+                NextState("RELEASE"),
+            ),
+        )
+        #   Release both lines, and check if the slave holds SDA
+        phase(
+            "RELEASE",
+            0,
+            0,
+            If(
+                sda_level,
+                NextState("STOP_SCL_LOW"),
+            ).Else(
+                NextState("SCL_LOW"),
+            ),
+        )
+        phase("SCL_LOW", 1, 0, NextState("SCL_HIGH"))
+        #   The slave shifts out a bit on each SCL pulse, and releases SDA
+        #   once the byte in progress is done
+        phase(
+            "SCL_HIGH",
+            0,
+            0,
+            NextValue(pulses, pulses + 1),
+            If(
+                sda_level | (pulses == max_pulses - 1),
+                NextState("STOP_SCL_LOW"),
+            ).Else(
+                NextState("SCL_LOW"),
+            ),
+        )
+        #   STOP: SDA rises while SCL is high
+        phase("STOP_SCL_LOW", 1, 0, NextState("STOP_SDA_LOW"))
+        phase("STOP_SDA_LOW", 1, 1, NextState("STOP_SCL_HIGH"))
+        phase("STOP_SCL_HIGH", 0, 1, NextState("STOP_SDA_HIGH"))
+        phase("STOP_SDA_HIGH", 0, 0, NextState("IDLE"))
+
+        self.comb += [
+            self.active.eq(~fsm.ongoing("IDLE")),
+            self._status.fields.SCL.eq(scl_level),
+            self._status.fields.SDA.eq(sda_level),
+            self._status.fields.BUSY.eq(self.active),
+            self._status.fields.PULSES.eq(pulses),
+        ]
+
+
+class ICE40UP_I2CProbe(Module, AutoCSR, AutoDoc):
+    def __init__(self, sb: Record, timeout: int = 2**20) -> None:
+        self.intro = ModuleDoc(
+            """ICE40UP_I2C Probe.
+            Sweeps the slave addresses from FIRST to LAST, as a single I2C
+            transaction: each address is sent after a (repeated) START as a
+            write command without data, and its acknowledge is read once the
+            address phase has completed, so no byte is written to the slaves.
+            The sweep ends with a STOP. Bit ``n`` of ``bitmap<k>`` is set if
+            address ``32 * k + n`` has acknowledged. A wait for TRRDY or for
+            the end of an address phase that lasts more than ``timeout``
+            system clock cycles sets TIMEOUT, and ends the sweep.
+            """
+        )
+
+        #   Probe Control
+        self._control = CSRStorage(
+            fields=[
+                CSRField(
+                    name="START",
+                    size=1,
+                    pulse=True,
+                    description="""Start a sweep, and clear the bitmap""",
+                ),
+                CSRField(
+                    name="FIRST",
+                    size=7,
+                    description="""First slave address""",
+                ),
+                CSRField(
+                    name="LAST",
+                    size=7,
+                    description="""Last slave address""",
+                ),
+            ],
+        )
+
+        #   Probe Status
+        self._status = CSRStatus(
+            fields=[
+                CSRField(
+                    name="BUSY",
+                    size=1,
+                    description="""A sweep is running""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="TIMEOUT",
+                    size=1,
+                    description="""The last sweep has timed out""",
+                    access=CSRAccess.ReadOnly,
+                ),
+            ],
+        )
+
+        #   Bitmap of the acknowledged addresses
+        bitmap = Signal(128)
+        for i in range(4):
+            csr = CSRStatus(
+                32,
+                name=f"bitmap{i}",
+                description=f"""Addresses 0x{32 * i:02x} to 0x{32 * i + 31:02x} acknowledged""",
+            )
+            setattr(self, f"_bitmap{i}", csr)
+            self.comb += csr.status.eq(bitmap[32 * i : 32 * (i + 1)])
+
+        address = Signal(7)
+        timed_out = Signal()
+
+        #   TRRDY/TIP wait timer
+        waiting = Signal()
+        timer = Signal(max=timeout + 1)
+        self.sync += If(~waiting, timer.eq(0)).Elif(
+            timer != timeout, timer.eq(timer + 1)
+        )
+
+        #   System Bus accesses, with the strobe released for at least one
+        #   cycle between consecutive accesses
+        sb_req = Signal()
+        self.sync += If(sb.ack, sb.stb.eq(0)).Elif(sb_req, sb.stb.eq(1))
+
+        self.submodules.fsm = fsm = FSM(reset_state="IDLE")
+
+        def sb_write(state, adr, dat, *on_ack):
+            fsm.act(
+                state,
+                sb_req.eq(~sb.stb),
+                sb.we.eq(1),
+                sb.adr.eq(adr),
+                sb.dat_w.eq(dat),
+                If(sb.ack, *on_ack),
+            )
+
+        def sb_wait(state, ready, *on_ready):
+            fsm.act(
+                state,
+                waiting.eq(1),
+                sb_req.eq(~sb.stb),
+                sb.adr.eq(SB_I2C_REGS_I2CSR),
+                If(
+                    sb.ack,
+                    If(
+                        ready,
+                        *on_ready,
+                    ).Elif(
+                        timer >= timeout,
+                        NextValue(timed_out, 1),
+                        NextState("STOP"),
+                    ),
+                ),
+            )
+
+        fsm.act(
+            "IDLE",
+            If(
+                self._control.fields.START,
+                NextValue(address, self._control.fields.FIRST),
+                NextValue(bitmap, 0),
+                NextValue(timed_out, 0),
+                NextState("ADDRESS"),
+            ),
+        )
+        sb_write(
+            "ADDRESS",
+            SB_I2C_REGS_I2CTXDR,
+            Cat(0, address),
+            NextState("ADDRESS_CMD"),
+        )
+        sb_write(
+            "ADDRESS_CMD",
+            SB_I2C_REGS_I2CCMDR,
+            I2CCMDR_CKSDIS | I2CCMDR_WR | I2CCMDR_STA,
+            NextState("ADDRESS_CLEAR"),
+        )
+        #   Clear the command, as the C driver and the sequencer do
+        sb_write(
+            "ADDRESS_CLEAR",
+            SB_I2C_REGS_I2CCMDR,
+            I2CCMDR_CKSDIS,
+            NextState("ADDRESS_WAIT"),
+        )
+        #   The address has moved to the shift register
+        sb_wait(
+            "ADDRESS_WAIT",
+            (sb.dat_r & I2CSR_TRRDY) != 0,
+            NextState("ACK_WAIT"),
+        )
+        #   The address phase, acknowledge included, has completed
+        sb_wait(
+            "ACK_WAIT",
+            (sb.dat_r & I2CSR_TIP) == 0,
+            If(
+                (sb.dat_r & I2CSR_RARC) == 0,
+                NextValue(bitmap, bitmap | (Const(1, 128) << address)),
+            ),
+            NextValue(address, address + 1),
+            If(
+                address == self._control.fields.LAST,
+                NextState("STOP"),
+            ).Else(
+                NextState("ADDRESS"),
+            ),
+        )
+        sb_write(
+            "STOP",
+            SB_I2C_REGS_I2CCMDR,
+            I2CCMDR_CKSDIS | I2CCMDR_STO,
+            NextState("IDLE"),
+        )
+
+        self.comb += [
+            self._status.fields.BUSY.eq(~fsm.ongoing("IDLE")),
+            self._status.fields.TIMEOUT.eq(timed_out),
+        ]
+
+
+class ICE40UP_I2CTarget(Module, AutoCSR, AutoDoc):
+    def __init__(self, sb: Record, depth: int = 16) -> None:
+        self.intro = ModuleDoc(
+            """ICE40UP_I2C Target.
+            Emulates a register file device on the I2C slave (target) port of
+            the hard IP, so that a host reads and writes bursts of registers
+            without CPU work per byte. The first byte written by the host
+            after the slave address sets the register pointer, the following
+            ones are stored in the registers. Reads return the registers from
+            the pointer on. The pointer auto-increments, and wraps at
+            ``depth`` registers.
+            While ENABLE is set, the module polls I2CSR and services TRRDY
+            from the registers. The hard IP stretches SCL until a byte has
+            been serviced, so the slave address, general call and clock
+            stretching have to be set up by software beforehand, and the
+            SB_I2C interrupts left disabled. ENABLE is only released between
+            transactions.
+            The CPU accesses the registers through ``regs_adr``, a write to
+            ``regs_dat_w`` and ``regs_dat_r``.
+            """
+        )
+
+        if depth & (depth - 1) or not 1 < depth <= 256:
+            raise ValueError(f"depth must be a power of 2 up to 256, not {depth}")
+
+        #   Target Control
+        self._control = CSRStorage(
+            fields=[
+                CSRField(
+                    name="ENABLE",
+                    size=1,
+                    description="""Service the slave port from the registers""",
+                ),
+            ],
+        )
+
+        #   Target Status
+        self._status = CSRStatus(
+            fields=[
+                CSRField(
+                    name="ACTIVE",
+                    size=1,
+                    description="""The slave port is being serviced""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="POINTER",
+                    size=8,
+                    description="""Register pointer""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="WRITES",
+                    size=16,
+                    description="""Number of register writes by the host, wrapping""",
+                    access=CSRAccess.ReadOnly,
+                ),
+            ],
+        )
+
+        #   CPU access to the registers
+        self._regs_adr = CSRStorage(
+            size=bits_for(depth - 1), description="Register address."
+        )
+        self._regs_dat_w = CSRStorage(
+            size=8, description="Register data, written to the register when written."
+        )
+        self._regs_dat_r = CSRStatus(size=8, description="Register data.")
+
+        regs = Array(Signal(8) for _ in range(depth))
+        pointer = Signal(max=depth)
+        writes = Signal(16)
+
+        #   The next byte written by the host is the register pointer
+        first = Signal()
+
+        #   A byte has been loaded for the host which it has not read yet
+        unsent = Signal()
+
+        #   The host writes the received byte to the register at the pointer
+        host_we = Signal()
+
+        #   System Bus accesses, with the strobe released for at least one
+        #   cycle between consecutive accesses
+        sb_req = Signal()
+        self.sync += If(sb.ack, sb.stb.eq(0)).Elif(sb_req, sb.stb.eq(1))
+
+        self.submodules.fsm = fsm = FSM(reset_state="IDLE")
+
+        fsm.act(
+            "IDLE",
+            If(
+                self._control.fields.ENABLE,
+                NextValue(first, 1),
+                NextValue(unsent, 0),
+                NextState("POLL"),
+            ),
+        )
+        fsm.act(
+            "POLL",
+            sb_req.eq(~sb.stb),
+            sb.adr.eq(SB_I2C_REGS_I2CSR),
+            If(
+                sb.ack,
+                If(
+                    (sb.dat_r & I2CSR_BUSY) == 0,
+                    #   Between transactions. The byte loaded ahead for the
+                    #   host is dropped after its NACK, so the pointer moves
+                    #   back to it.
+                    NextValue(first, 1),
+                    NextValue(unsent, 0),
+                    If(unsent, NextValue(pointer, pointer - 1)),
+                    If(~self._control.fields.ENABLE, NextState("IDLE")),
+                ).Elif(
+                    (sb.dat_r & I2CSR_TRRDY) != 0,
+                    If(
+                        (sb.dat_r & I2CSR_SRW) != 0,
+                        NextState("TX"),
+                    ).Else(
+                        NextState("RX"),
+                    ),
+                ),
+            ),
+        )
+        fsm.act(
+            "TX",
+            sb_req.eq(~sb.stb),
+            sb.we.eq(1),
+            sb.adr.eq(SB_I2C_REGS_I2CTXDR),
+            sb.dat_w.eq(regs[pointer]),
+            If(
+                sb.ack,
+                NextValue(pointer, pointer + 1),
+                NextValue(unsent, 1),
+                NextValue(first, 1),
+                NextState("POLL"),
+            ),
+        )
+        fsm.act(
+            "RX",
+            sb_req.eq(~sb.stb),
+            sb.adr.eq(SB_I2C_REGS_I2CRXDR),
+            If(
+                sb.ack,
+                If(
+                    first,
+                    NextValue(pointer, sb.dat_r),
+                    NextValue(first, 0),
+                ).Else(
+                    host_we.eq(1),
+                    NextValue(pointer, pointer + 1),
+                    NextValue(writes, writes + 1),
+                ),
+                NextState("POLL"),
+            ),
+        )
+
+        #   A register written by the host and by the CPU in the same cycle
+        #   takes the value of the CPU
+        self.sync += [
+            If(host_we, regs[pointer].eq(sb.dat_r)),
+            If(
+                self._regs_dat_w.re,
+                regs[self._regs_adr.storage].eq(self._regs_dat_w.storage),
+            ),
+        ]
+
+        self.comb += [
+            self._regs_dat_r.status.eq(regs[self._regs_adr.storage]),
+            self._status.fields.ACTIVE.eq(~fsm.ongoing("IDLE")),
+            self._status.fields.POINTER.eq(pointer),
+            self._status.fields.WRITES.eq(writes),
+        ]
+
+
+#   Shift states of the SB_I2C behavioral model
+MODEL_SHIFT_IDLE = 0
+MODEL_SHIFT_TX = 1
+MODEL_SHIFT_RX = 2
+MODEL_SHIFT_STOP = 3
+
+
+class ICE40UP_I2CModel(Module, AutoDoc):
+    def __init__(
+        self,
+        sb: Record,
+        irqo: Signal,
+        slave_address: int = 0x50,
+        slave_init: list = None,
+    ) -> None:
+        self.intro = ModuleDoc(
+            """SB_I2C behavioral model.
+            Simulation model of the SB_I2C hard IP as seen from its System Bus,
+            in master mode, with a register file slave on its I2C bus. Each
+            System Bus access is acknowledged on the next cycle. The I2C bus is
+            not modeled at the signal level, but each byte takes 9 SCL periods
+            and each (repeated) START or STOP one more, with the SCL period set
+            by the I2CBRLSB/I2CBRMSB prescaler, so transfers take their real
+            time. It follows the same semantics as the host model in
+            ``c_driver_library/host_sim``:
+
+            - TRRDY is set in transmit mode once I2CTXDR has moved to the shift
+              register, and in receive mode when I2CRXDR holds a byte.
+            - I2CCMDR commands execute when the register is written, writing
+              0x00 has no effect.
+            - After a RD command, bytes are received back-to-back until a RD
+              and ACK command, which NACKs the byte in progress (or the next
+              one). With STO, it is followed by a STOP, else the bus is held
+              for a repeated START.
+            - RARC is set when the last transmitted byte was not acknowledged.
+
+            The slave at ``slave_address`` holds 256 registers, initialized
+            from ``slave_init``. The first byte written after its address sets
+            the register pointer, which auto-increments on each access.
+            """
+        )
+
+        #   Registers
+        cr1 = Signal(8)
+        cmdr = Signal(8)
+        brlsb = Signal(8)
+        brmsb = Signal(2)
+        txdr = Signal(8)
+        rxdr = Signal(8)
+        saddr = Signal(8)
+        irqen = Signal(8)
+        irq = Signal(4)
+        status = Signal(8)
+
+        #   I2C engine
+        txdr_full = Signal()
+        tx_start = Signal()
+        rxdr_full = Signal()
+        busy = Signal()
+        srw = Signal()
+        rarc = Signal()
+        troe = Signal()
+        cksdis = Signal()
+        rx_enabled = Signal()
+        rx_last = Signal()
+        rx_stop = Signal()
+        stop_pending = Signal()
+        shift = Signal(2)
+        shift_start = Signal()
+        shift_last = Signal()
+        shift_data = Signal(8)
+        timer = Signal(16)
+        period = Signal(13)
+
+        #   Slave device
+        addressed = Signal()
+        match = Signal()
+        pointer = Signal(8)
+        pointer_set = Signal()
+        mem = Memory(8, 256, init=slave_init)
+        port = mem.get_port(write_capable=True, async_read=True)
+        self.specials += mem, port
+
+        #   System Bus accesses take one cycle, and the I2C engine only
+        #   changes state in cycles with no access
+        access = Signal()
+        complete = Signal()
+        enabled = Signal()
+        start_rx = Signal()
+        self.comb += [
+            access.eq(sb.stb & ~sb.ack),
+            enabled.eq(cr1[7]),
+            complete.eq((shift != MODEL_SHIFT_IDLE) & (timer == 0) & ~access),
+            start_rx.eq(srw & rx_enabled & ~stop_pending & ~(rxdr_full & ~cksdis)),
+            period.eq((Cat(brlsb, brmsb) + 1) << 2),
+            match.eq(shift_data[1:8] == slave_address),
+            status[1].eq(troe),
+            status[2].eq(Mux(srw, rxdr_full, ~txdr_full)),
+            status[4].eq(srw),
+            status[5].eq(rarc),
+            status[6].eq(busy),
+            status[7].eq((shift == MODEL_SHIFT_TX) | (shift == MODEL_SHIFT_RX)),
+            port.adr.eq(pointer),
+            port.dat_w.eq(shift_data),
+            port.we.eq(
+                complete
+                & (shift == MODEL_SHIFT_TX)
+                & ~shift_start
+                & addressed
+                & ~srw
+                & pointer_set
+            ),
+        ]
+
+        #   Interrupts are latched on the rising edges of I2CSR[3:0]
+        status_last = Signal(4)
+        irq_clear = Signal(4)
+        self.comb += [
+            irq_clear.eq(
+                Mux(
+                    access & sb.we & (sb.adr == SB_I2C_REGS_I2CIRQ),
+                    sb.dat_w[0:4],
+                    0,
+                )
+            ),
+            irqo.eq((irq & irqen[0:4]) != 0),
+        ]
+        self.sync += [
+            status_last.eq(status[0:4]),
+            irq.eq((irq & ~irq_clear) | (status[0:4] & ~status_last & irqen[0:4])),
+        ]
+
+        #   A write to I2CCR1 or I2CBRMSB resets the I2C engine
+        core_reset = [
+            txdr_full.eq(0),
+            tx_start.eq(0),
+            rxdr_full.eq(0),
+            busy.eq(0),
+            srw.eq(0),
+            rarc.eq(0),
+            troe.eq(0),
+            rx_enabled.eq(0),
+            rx_last.eq(0),
+            stop_pending.eq(0),
+            shift.eq(MODEL_SHIFT_IDLE),
+            addressed.eq(0),
+        ]
+
+        #   System Bus
+        self.sync += [
+            sb.ack.eq(access),
+            If(
+                access & sb.we,
+                Case(
+                    sb.adr,
+                    {
+                        SB_I2C_REGS_I2CCR1: [cr1.eq(sb.dat_w)] + core_reset,
+                        SB_I2C_REGS_I2CCMDR: [
+                            cmdr.eq(sb.dat_w),
+                            If(
+                                sb.dat_w != 0,
+                                cksdis.eq(sb.dat_w[2]),
+                                If(
+                                    sb.dat_w & I2CCMDR_STA,
+                                    tx_start.eq(1),
+                                ),
+                                If(
+                                    sb.dat_w & I2CCMDR_WR,
+                                    txdr_full.eq(1),
+                                    If(txdr_full, troe.eq(1)),
+                                ),
+                                If(
+                                    sb.dat_w & I2CCMDR_RD,
+                                    rx_enabled.eq(1),
+                                    If(
+                                        sb.dat_w & (I2CCMDR_ACK | I2CCMDR_STO),
+                                        rx_last.eq(1),
+                                        rx_stop.eq(sb.dat_w[6]),
+                                    ),
+                                ).Elif(
+                                    sb.dat_w & I2CCMDR_STO,
+                                    stop_pending.eq(1),
+                                ),
+                            ),
+                        ],
+                        SB_I2C_REGS_I2CBRLSB: brlsb.eq(sb.dat_w),
+                        SB_I2C_REGS_I2CBRMSB: [brmsb.eq(sb.dat_w)] + core_reset,
+                        SB_I2C_REGS_I2CTXDR: txdr.eq(sb.dat_w),
+                        SB_I2C_REGS_I2CSADDR: saddr.eq(sb.dat_w),
+                        SB_I2C_REGS_I2CIRQEN: irqen.eq(sb.dat_w),
+                    },
+                ),
+            ).Elif(
+                access,
+                Case(
+                    sb.adr,
+                    {
+                        SB_I2C_REGS_I2CCR1: sb.dat_r.eq(cr1),
+                        SB_I2C_REGS_I2CCMDR: sb.dat_r.eq(cmdr),
+                        SB_I2C_REGS_I2CBRLSB: sb.dat_r.eq(brlsb),
+                        SB_I2C_REGS_I2CBRMSB: sb.dat_r.eq(brmsb),
+                        SB_I2C_REGS_I2CSR: sb.dat_r.eq(status),
+                        SB_I2C_REGS_I2CRXDR: [
+                            sb.dat_r.eq(rxdr),
+                            rxdr_full.eq(0),
+                        ],
+                        SB_I2C_REGS_I2CSADDR: sb.dat_r.eq(saddr),
+                        SB_I2C_REGS_I2CIRQEN: sb.dat_r.eq(irqen),
+                        SB_I2C_REGS_I2CIRQ: sb.dat_r.eq(irq),
+                        "default": sb.dat_r.eq(0),
+                    },
+                ),
+            ),
+        ]
+
+        #   I2C engine
+        self.sync += [
+            If(
+                (shift != MODEL_SHIFT_IDLE) & (timer != 0),
+                timer.eq(timer - 1),
+            ),
+            If(
+                ~access & (shift == MODEL_SHIFT_IDLE),
+                If(
+                    enabled & txdr_full,
+                    shift.eq(MODEL_SHIFT_TX),
+                    shift_start.eq(tx_start),
+                    shift_data.eq(txdr),
+                    txdr_full.eq(0),
+                    tx_start.eq(0),
+                    If(
+                        tx_start,
+                        #   (Repeated) START, address and ACK
+                        timer.eq((period << 3) + (period << 1) - 1),
+                        busy.eq(1),
+                        srw.eq(0),
+                        rarc.eq(0),
+                        troe.eq(0),
+                        rx_enabled.eq(0),
+                        rx_last.eq(0),
+                        rx_stop.eq(0),
+                    ).Else(
+                        timer.eq((period << 3) + period - 1),
+                    ),
+                ).Elif(
+                    enabled & start_rx,
+                    shift.eq(MODEL_SHIFT_RX),
+                    shift_last.eq(rx_last),
+                    rx_last.eq(0),
+                    timer.eq((period << 3) + period - 1),
+                ).Elif(
+                    enabled & stop_pending,
+                    shift.eq(MODEL_SHIFT_STOP),
+                    stop_pending.eq(0),
+                    timer.eq(period - 1),
+                ),
+            ).Elif(
+                complete,
+                shift.eq(MODEL_SHIFT_IDLE),
+                Case(
+                    shift,
+                    {
+                        MODEL_SHIFT_TX: If(
+                            shift_start,
+                            addressed.eq(match),
+                            srw.eq(match & shift_data[0]),
+                            rarc.eq(~match),
+                            If(~shift_data[0], pointer_set.eq(0)),
+                        ).Else(
+                            rarc.eq(~addressed | srw),
+                            If(
+                                addressed & ~srw,
+                                If(
+                                    ~pointer_set,
+                                    pointer.eq(shift_data),
+                                    pointer_set.eq(1),
+                                ).Else(
+                                    pointer.eq(pointer + 1),
+                                ),
+                            ),
+                        ),
+                        MODEL_SHIFT_RX: [
+                            If(
+                                rxdr_full,
+                                troe.eq(1),
+                            ).Else(
+                                rxdr.eq(Mux(addressed, port.dat_r, 0xFF)),
+                                rxdr_full.eq(1),
+                                If(addressed, pointer.eq(pointer + 1)),
+                            ),
+                            If(
+                                shift_last,
+                                rx_enabled.eq(0),
+                                stop_pending.eq(rx_stop),
+                            ),
+                        ],
+                        MODEL_SHIFT_STOP: [
+                            addressed.eq(0),
+                            busy.eq(0),
+                            srw.eq(0),
+                            rx_enabled.eq(0),
+                        ],
+                    },
+                ),
+            ).Elif(
+                ~access & (shift == MODEL_SHIFT_RX) & rx_last,
+                #   NACK (and STOP) after the byte in progress
+                shift_last.eq(1),
+                rx_last.eq(0),
+            ),
+        ]
+
+
 class ICE40UP_I2C(Module, AutoCSR, AutoDoc):
     def __init__(
-        self, scl_pin: Signal, sda_pin: Signal, sys_clk: Signal
+        self,
+        scl_pin: Signal,
+        sda_pin: Signal,
+        sys_clk: Signal,
+        with_sb_command: bool = False,
+        sb_command_depth: int = 4,
+        with_wishbone: bool = False,
+        with_status_mirror: bool = False,
+        with_sequencer: bool = False,
+        sequencer_depth: int = 16,
+        with_dma: bool = False,
+        with_irq: bool = False,
+        with_sim_model: bool = False,
+        corner: str = "upper_left",
+        with_bus_recovery: bool = False,
+        with_probe: bool = False,
+        with_target: bool = False,
+        target_depth: int = 16,
     ) -> None:
         self.intro = ModuleDoc(
             """ICE40UP_I2C.
@@ -44,6 +1565,14 @@ class ICE40UP_I2C(Module, AutoCSR, AutoDoc):
             """
         )
 
+        if corner not in SB_I2C_CORNERS:
+            raise ValueError(
+                f"corner must be one of {', '.join(SB_I2C_CORNERS)}, not {corner!r}"
+            )
+
+        #   System Bus masters, in decreasing priority
+        sb_masters = []
+
         #   System Bus Control Signals
         self._sbctrl = CSRStorage(
             size=2,
@@ -81,10 +1610,123 @@ class ICE40UP_I2C(Module, AutoCSR, AutoDoc):
         #   System Bus Data Output
         self._sbdato = CSRStatus(size=8, description="System Data Output.")
 
+        #   Software driven System Bus master. The acknowledgement is held
+        #   until software releases the strobe, and the strobe towards the
+        #   hard IP is released as soon as the acknowledgement arrives.
+        sbacko = Signal()
+        sb_csr = Record(SB_LAYOUT)
+        self.comb += [
+            sb_csr.adr.eq(self._sbadri.storage),
+            sb_csr.dat_w.eq(self._sbdati.storage),
+            sb_csr.we.eq(self._sbctrl.fields.SBRWI),
+            sb_csr.stb.eq(self._sbctrl.fields.SBSTBI & ~sbacko),
+            self._sbstatus.fields.SBACKO.eq(sbacko),
+        ]
+        self.sync += [
+            If(
+                ~self._sbctrl.fields.SBSTBI,
+                sbacko.eq(0),
+            ).Elif(
+                sb_csr.ack,
+                sbacko.eq(1),
+                self._sbdato.status.eq(sb_csr.dat_r),
+            )
+        ]
+
+        if with_wishbone:
+            self._add_wishbone_bridge(sb_masters)
+
+        if with_sb_command:
+            self._add_sb_command(sb_masters, sb_command_depth)
+
+        sb_masters.append(sb_csr)
+
+        #   Masters driven by the CPU, whose accesses the status mirror has to reflect
+        cpu_masters = list(sb_masters)
+
+        if with_sequencer:
+            sb_seq = Record(SB_LAYOUT)
+            self.submodules.sequencer = ICE40UP_I2CSequencer(
+                sb_seq, depth=sequencer_depth
+            )
+            sb_masters.append(sb_seq)
+
+        if with_dma:
+            if not with_sequencer:
+                raise ValueError("with_dma requires with_sequencer")
+            self.submodules.dma = ICE40UP_I2CDMA(self.sequencer)
+
+        if with_probe:
+            sb_probe = Record(SB_LAYOUT)
+            self.submodules.probe = ICE40UP_I2CProbe(sb_probe)
+            sb_masters.append(sb_probe)
+
+        if with_target:
+            sb_target = Record(SB_LAYOUT)
+            self.submodules.target = ICE40UP_I2CTarget(sb_target, depth=target_depth)
+            sb_masters.append(sb_target)
+
+        if with_status_mirror:
+            self._add_status_mirror(sb_masters, cpu_masters)
+
+        #   System Bus of the hard IP
+        sb = Record(SB_LAYOUT)
+        self.submodules.sb_arbiter = SBArbiter(sb_masters, sb)
+
+        #   Interrupt Request, set by the I2CIRQ register
+        irqo = Signal()
+
+        #   Levels of the SCL/SDA lines
+        scli = Signal(reset=1)
+        sdai = Signal(reset=1)
+
+        recovery = None
+        if with_bus_recovery:
+            recovery = ICE40UP_I2CRecovery(scli, sdai)
+            self.submodules.recovery = recovery
+
+        if with_sim_model:
+            #   Behavioral model of the I2C Hard IP, with a slave on its I2C
+            #   bus. The lines are not modeled, and stay high.
+            self.submodules.sim_model = ICE40UP_I2CModel(sb, irqo)
+        else:
+            self._add_hard_ip(
+                sb, irqo, scl_pin, sda_pin, sys_clk, corner, scli, sdai, recovery
+            )
+
+        #   Events
+        if with_irq or with_dma:
+            self.submodules.ev = EventManager()
+            if with_irq:
+                self.ev.i2c = EventSourceLevel(
+                    description="SB_I2C interrupt, cleared through the I2CIRQ register"
+                )
+            if with_dma:
+                self.ev.dma_done = EventSourcePulse(
+                    description="DMA transfer done"
+                )
+            self.ev.finalize()
+            if with_irq:
+                self.comb += self.ev.i2c.trigger.eq(irqo)
+            if with_dma:
+                self.comb += self.ev.dma_done.trigger.eq(self.dma.done)
+
+    def _add_hard_ip(
+        self,
+        sb: Record,
+        irqo: Signal,
+        scl_pin: Signal,
+        sda_pin: Signal,
+        sys_clk: Signal,
+        corner: str,
+        scli: Signal,
+        sdai: Signal,
+        recovery: ICE40UP_I2CRecovery = None,
+    ) -> None:
+        bus_addr74, slave_init_addr = SB_I2C_CORNERS[corner]
+
         #   I2C Signals
-        sdai = Signal()
         sdao = Signal()
-        scli = Signal()
         sclo = Signal()
         sdaoe = Signal()
         scloe = Signal()
@@ -93,43 +1735,42 @@ class ICE40UP_I2C(Module, AutoCSR, AutoDoc):
         self.specials += Instance(
             "SB_I2C",
             #   I2C Slave Parameters
-            #   Use Upper Left Corner I2C Hard IP
-            p_I2C_SLAVE_INIT_ADDR="0b1111100001",
-            p_BUS_ADDR74="0b0001",
+            #   Select the I2C Hard IP of the given corner
+            p_I2C_SLAVE_INIT_ADDR=slave_init_addr,
+            p_BUS_ADDR74=f"0b{bus_addr74:04b}",
             #   System Bus Signals
             i_SBCLKI=sys_clk,
-            i_SBRWI=self._sbctrl.fields.SBRWI,
-            i_SBSTBI=self._sbctrl.fields.SBSTBI,
-            o_SBACKO=self._sbstatus.fields.SBACKO,
+            i_SBRWI=sb.we,
+            i_SBSTBI=sb.stb,
+            o_SBACKO=sb.ack,
             #   System Bus Control Registers Address
-            #   Hardwire top address bits to always use the upper left corner
-            #   I2C Hard IP
-            i_SBADRI7=0b0,
-            i_SBADRI6=0b0,
-            i_SBADRI5=0b0,
-            i_SBADRI4=0b1,
-            i_SBADRI3=self._sbadri.storage[3],
-            i_SBADRI2=self._sbadri.storage[2],
-            i_SBADRI1=self._sbadri.storage[1],
-            i_SBADRI0=self._sbadri.storage[0],
+            #   Hardwire top address bits to the BUS_ADDR74 of the corner
+            i_SBADRI7=(bus_addr74 >> 3) & 0b1,
+            i_SBADRI6=(bus_addr74 >> 2) & 0b1,
+            i_SBADRI5=(bus_addr74 >> 1) & 0b1,
+            i_SBADRI4=(bus_addr74 >> 0) & 0b1,
+            i_SBADRI3=sb.adr[3],
+            i_SBADRI2=sb.adr[2],
+            i_SBADRI1=sb.adr[1],
+            i_SBADRI0=sb.adr[0],
             #   System Bus Data Input
-            i_SBDATI7=self._sbdati.storage[7],
-            i_SBDATI6=self._sbdati.storage[6],
-            i_SBDATI5=self._sbdati.storage[5],
-            i_SBDATI4=self._sbdati.storage[4],
-            i_SBDATI3=self._sbdati.storage[3],
-            i_SBDATI2=self._sbdati.storage[2],
-            i_SBDATI1=self._sbdati.storage[1],
-            i_SBDATI0=self._sbdati.storage[0],
+            i_SBDATI7=sb.dat_w[7],
+            i_SBDATI6=sb.dat_w[6],
+            i_SBDATI5=sb.dat_w[5],
+            i_SBDATI4=sb.dat_w[4],
+            i_SBDATI3=sb.dat_w[3],
+            i_SBDATI2=sb.dat_w[2],
+            i_SBDATI1=sb.dat_w[1],
+            i_SBDATI0=sb.dat_w[0],
             #   System Bus Data Output
-            o_SBDATO7=self._sbdato.status[7],
-            o_SBDATO6=self._sbdato.status[6],
-            o_SBDATO5=self._sbdato.status[5],
-            o_SBDATO4=self._sbdato.status[4],
-            o_SBDATO3=self._sbdato.status[3],
-            o_SBDATO2=self._sbdato.status[2],
-            o_SBDATO1=self._sbdato.status[1],
-            o_SBDATO0=self._sbdato.status[0],
+            o_SBDATO7=sb.dat_r[7],
+            o_SBDATO6=sb.dat_r[6],
+            o_SBDATO5=sb.dat_r[5],
+            o_SBDATO4=sb.dat_r[4],
+            o_SBDATO3=sb.dat_r[3],
+            o_SBDATO2=sb.dat_r[2],
+            o_SBDATO1=sb.dat_r[1],
+            o_SBDATO0=sb.dat_r[0],
             #   I2C Signals
             i_SCLI=scli,
             o_SCLO=sclo,
@@ -137,8 +1778,37 @@ class ICE40UP_I2C(Module, AutoCSR, AutoDoc):
             i_SDAI=sdai,
             o_SDAO=sdao,
             o_SDAOE=sdaoe,
+            #   Interrupt Request
+            o_IRQO=irqo,
         )
 
+        #   Pin drivers, taken over by the bus recovery while it runs
+        scl_oe = Signal()
+        scl_out = Signal()
+        sda_oe = Signal()
+        sda_out = Signal()
+
+        if recovery is not None:
+            self.comb += If(
+                recovery.active,
+                scl_oe.eq(recovery.scl_low),
+                scl_out.eq(0),
+                sda_oe.eq(recovery.sda_low),
+                sda_out.eq(0),
+            ).Else(
+                scl_oe.eq(scloe),
+                scl_out.eq(sclo),
+                sda_oe.eq(sdaoe),
+                sda_out.eq(sdao),
+            )
+        else:
+            self.comb += [
+                scl_oe.eq(scloe),
+                scl_out.eq(sclo),
+                sda_oe.eq(sdaoe),
+                sda_out.eq(sdao),
+            ]
+
         #   Multiplexers for using the same SDA/SCL pins for input/output
         self.specials += Instance(
             "SB_IO",
@@ -149,8 +1819,8 @@ class ICE40UP_I2C(Module, AutoCSR, AutoDoc):
             p_PULLUP=0b1,
             #   I2C Signals
             io_PACKAGE_PIN=scl_pin,
-            i_OUTPUT_ENABLE=scloe,
-            i_D_OUT_0=sclo,
+            i_OUTPUT_ENABLE=scl_oe,
+            i_D_OUT_0=scl_out,
             o_D_IN_0=scli,
         )
 
@@ -163,7 +1833,229 @@ class ICE40UP_I2C(Module, AutoCSR, AutoDoc):
             p_PULLUP=0b1,
             #   I2C Signals
             io_PACKAGE_PIN=sda_pin,
-            i_OUTPUT_ENABLE=sdaoe,
-            i_D_OUT_0=sdao,
+            i_OUTPUT_ENABLE=sda_oe,
+            i_D_OUT_0=sda_out,
             o_D_IN_0=sdai,
         )
+
+    def _add_sb_command(self, sb_masters: list, depth: int) -> None:
+        self.sb_command_doc = ModuleDoc(
+            """System Bus command.
+            Performs a complete System Bus access from a single write to the
+            ``sbcmd`` CSR. The strobe is driven in gateware until the hard IP
+            acknowledges, and for reads the System Bus Data Output is latched
+            in ``sbcmd_status``. Writes to ``sbcmd`` while a command is still
+            in progress are queued in a FIFO and executed in order. A write
+            while FULL is set in ``sbcmd_status`` is dropped, so software must
+            check FULL before posting a command.
+            """
+        )
+
+        #   System Bus Command
+        self._sbcmd = CSRStorage(
+            size=13,
+            fields=[
+                CSRField(
+                    name="DATA",
+                    size=8,
+                    description="""System Bus Data Input""",
+                ),
+                CSRField(
+                    name="ADDR",
+                    size=4,
+                    description="""System Bus Control registers address""",
+                ),
+                CSRField(
+                    name="RW",
+                    size=1,
+                    description="""System Bus Read/Write input. R=0, W=1""",
+                ),
+            ],
+        )
+
+        #   System Bus Command Status
+        self._sbcmd_status = CSRStatus(
+            size=10,
+            fields=[
+                CSRField(
+                    name="DATA",
+                    size=8,
+                    description="""System Bus Data Output of the last command""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="BUSY",
+                    size=1,
+                    description="""Command in progress, DATA is not valid""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="FULL",
+                    size=1,
+                    description="""Command FIFO full, a write to ``sbcmd`` is dropped""",
+                    access=CSRAccess.ReadOnly,
+                ),
+            ],
+        )
+
+        #   Commands are latched when written, so a queued command is never
+        #   overwritten by the next write
+        cmd_fifo = stream.SyncFIFO([("adr", 4), ("dat_w", 8), ("we", 1)], depth)
+        self.submodules.sb_cmd_fifo = cmd_fifo
+
+        #   Command written but not yet strobed on the System Bus
+        self.sb_cmd_pending = Signal()
+
+        sb_cmd = Record(SB_LAYOUT)
+        start = Signal()
+        self.comb += [
+            cmd_fifo.sink.valid.eq(self._sbcmd.re),
+            cmd_fifo.sink.adr.eq(self._sbcmd.fields.ADDR),
+            cmd_fifo.sink.dat_w.eq(self._sbcmd.fields.DATA),
+            cmd_fifo.sink.we.eq(self._sbcmd.fields.RW),
+            start.eq(cmd_fifo.source.valid & ~sb_cmd.stb),
+            cmd_fifo.source.ready.eq(start),
+            self._sbcmd_status.fields.BUSY.eq(cmd_fifo.source.valid | sb_cmd.stb),
+            self._sbcmd_status.fields.FULL.eq(~cmd_fifo.sink.ready),
+            self.sb_cmd_pending.eq(self._sbcmd.re | cmd_fifo.source.valid),
+        ]
+        self.sync += [
+            If(
+                start,
+                sb_cmd.adr.eq(cmd_fifo.source.adr),
+                sb_cmd.dat_w.eq(cmd_fifo.source.dat_w),
+                sb_cmd.we.eq(cmd_fifo.source.we),
+                sb_cmd.stb.eq(1),
+            ).Elif(
+                sb_cmd.ack,
+                sb_cmd.stb.eq(0),
+                self._sbcmd_status.fields.DATA.eq(sb_cmd.dat_r),
+            ),
+        ]
+
+        sb_masters.append(sb_cmd)
+
+    def _add_wishbone_bridge(self, sb_masters: list) -> None:
+        self.wishbone_doc = ModuleDoc(
+            """Wishbone bridge.
+            Maps the SB_I2C registers in the CPU address space through the
+            ``bus`` Wishbone slave interface. Each System Bus register address
+            is a 32-bit word offset, of which the 8 LSBs are used. The Wishbone
+            acknowledgement is held until the hard IP acknowledges, so a
+            register access is a single load or store.
+            """
+        )
+
+        self.bus = wishbone.Interface(data_width=32)
+
+        sb_wb = Record(SB_LAYOUT)
+        self.comb += [
+            sb_wb.adr.eq(self.bus.adr[0:4]),
+            sb_wb.dat_w.eq(self.bus.dat_w[0:8]),
+            sb_wb.we.eq(self.bus.we),
+        ]
+        self.sync += [
+            self.bus.ack.eq(0),
+            If(
+                sb_wb.ack,
+                sb_wb.stb.eq(0),
+                self.bus.ack.eq(1),
+                self.bus.dat_r.eq(sb_wb.dat_r),
+            ).Elif(
+                self.bus.cyc & self.bus.stb & ~self.bus.ack,
+                sb_wb.stb.eq(1),
+            ),
+        ]
+
+        sb_masters.append(sb_wb)
+
+    def _add_status_mirror(self, sb_masters: list, cpu_masters: list) -> None:
+        self.status_mirror_doc = ModuleDoc(
+            """Status mirror.
+            Reads the I2CSR and I2CIRQ registers, alternately, whenever no
+            other System Bus master is requesting the bus, and publishes the
+            latest values in the ``sbmirror`` CSR. It is the lowest priority
+            System Bus master, so software accesses are delayed by at most one
+            System Bus access. VALID is cleared as soon as a System Bus access
+            of the CPU (``sbctrl``, ``sbcmd`` or Wishbone) is requested, or an
+            ``sbcmd`` command is written, and set again once I2CSR has been
+            sampled after the access, so a set VALID guarantees that I2CSR
+            reflects all previously issued CPU accesses. The accesses of the
+            autonomous masters (sequencer, probe, target) do not clear it, as
+            they may poll the System Bus back to back, which would keep VALID
+            clear; their status is read from their own CSRs.
+            Note that I2CIRQ is read in the background, so the
+            auto interrupt clear (I2CIRQEN.IRQINTCLREN) must not be enabled.
+            """
+        )
+
+        #   System Bus Status Mirror
+        self._sbmirror = CSRStatus(
+            size=17,
+            fields=[
+                CSRField(
+                    name="I2CSR",
+                    size=8,
+                    description="""Last sampled I2C Status Register""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="I2CIRQ",
+                    size=8,
+                    description="""Last sampled I2C Interrupt Status Register""",
+                    access=CSRAccess.ReadOnly,
+                ),
+                CSRField(
+                    name="VALID",
+                    size=1,
+                    description="""I2CSR was sampled after the last System Bus access of the CPU""",
+                    access=CSRAccess.ReadOnly,
+                ),
+            ],
+        )
+
+        #   Registers are polled only when the rest of the System Bus masters are idle
+        others_stb = Signal()
+        self.comb += others_stb.eq(reduce(or_, [master.stb for master in sb_masters]))
+
+        #   A sample taken while a CPU access is requested or queued, or
+        #   completing in the same cycle, does not reflect it
+        cpu_stb = Signal()
+        self.comb += cpu_stb.eq(reduce(or_, [master.stb for master in cpu_masters]))
+        stale = Signal()
+        if hasattr(self, "sb_cmd_pending"):
+            self.comb += stale.eq(cpu_stb | self.sb_cmd_pending)
+        else:
+            self.comb += stale.eq(cpu_stb)
+
+        sb_poll = Record(SB_LAYOUT)
+        select_irq = Signal()
+        self.comb += [
+            sb_poll.adr.eq(
+                Mux(select_irq, SB_I2C_REGS_I2CIRQ, SB_I2C_REGS_I2CSR)
+            ),
+            sb_poll.we.eq(0),
+        ]
+        self.sync += [
+            If(
+                sb_poll.ack,
+                sb_poll.stb.eq(0),
+                select_irq.eq(~select_irq),
+                If(
+                    select_irq,
+                    self._sbmirror.fields.I2CIRQ.eq(sb_poll.dat_r),
+                ).Else(
+                    self._sbmirror.fields.I2CSR.eq(sb_poll.dat_r),
+                    self._sbmirror.fields.VALID.eq(1),
+                ),
+            ).Elif(
+                ~sb_poll.stb & ~others_stb,
+                sb_poll.stb.eq(1),
+            ),
+            If(
+                stale,
+                self._sbmirror.fields.VALID.eq(0),
+            ),
+        ]
+
+        sb_masters.append(sb_poll)
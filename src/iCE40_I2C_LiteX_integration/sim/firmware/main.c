@@ -0,0 +1,143 @@
+/*
+ *	Copyright (c) 2024, Signaloid.
+ *
+ *	Permission is hereby granted, free of charge, to any person obtaining a copy
+ *	of this software and associated documentation files (the "Software"), to deal
+ *	in the Software without restriction, including without limitation the rights
+ *	to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ *	copies of the Software, and to permit persons to whom the Software is
+ *	furnished to do so, subject to the following conditions:
+ *
+ *	The above copyright notice and this permission notice shall be included in all
+ *	copies or substantial portions of the Software.
+ *
+ *	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ *	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ *	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ *	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ *	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ *	OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ *	SOFTWARE.
+ */
+
+
+
+/*
+ * 	Firmware of the i2c_sim.py simulation. Runs the C driver library against the SB_I2C behavioral
+ * 	model, and reports the system clock cycles per byte for writes, reads and scans.
+ */
+
+#include <generated/csr.h>
+#include <generated/soc.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "i2c.h"
+
+/*
+ * 	Address of the register file slave of ICE40UP_I2CModel
+ */
+#define SIM_SLAVE_ADDRESS	0x50
+#define SIM_LEN			16
+
+static uint64_t
+sim_cycles(void)
+{
+	timer0_uptime_latch_write(1);
+
+	return timer0_uptime_cycles_read();
+}
+
+static void
+sim_report(const char *name, uint64_t cycles, unsigned bytes)
+{
+	/*
+	 * 	A byte takes 9 SCL periods on the I2C bus
+	 */
+	uint32_t bus_cycles = 9 * 4 * (I2C_BUS_PRESCALER(kSB_I2C_CONFIG_TARGET_I2C_FREQUENCY) + 1);
+
+	printf("%-24s %8lu cycles %6lu cycles/B (bus %lu cycles/B)\n",
+		name,
+		(unsigned long)cycles,
+		(unsigned long)(cycles / bytes),
+		(unsigned long)bus_cycles
+	);
+}
+
+int
+main(void)
+{
+	uint8_t wr[SIM_LEN];
+	uint8_t rd[SIM_LEN];
+	uint64_t start;
+	unsigned found = 0;
+	int failures = 0;
+
+	for (unsigned i = 0; i < SIM_LEN; i++)
+	{
+		wr[i] = 0xA0 + i;
+	}
+
+	printf("\nI2C at %lu Hz, system clock %lu Hz\n",
+		(unsigned long)kSB_I2C_CONFIG_TARGET_I2C_FREQUENCY,
+		(unsigned long)CONFIG_CLOCK_FREQUENCY
+	);
+
+	i2c_init();
+
+	start = sim_cycles();
+	i2c_begin(SIM_SLAVE_ADDRESS, false);
+	i2c_write(0x10);
+	for (unsigned i = 0; i < SIM_LEN; i++)
+	{
+		i2c_write(wr[i]);
+	}
+	i2c_end();
+	sim_report("write: i2c_write()", sim_cycles() - start, SIM_LEN);
+
+	start = sim_cycles();
+	i2c_reg_write(SIM_SLAVE_ADDRESS, 0x20, wr, SIM_LEN);
+	sim_report("write: i2c_reg_write()", sim_cycles() - start, SIM_LEN);
+
+	memset(rd, 0, sizeof(rd));
+	start = sim_cycles();
+	i2c_begin(SIM_SLAVE_ADDRESS, false);
+	i2c_write(0x10);
+	i2c_restart(SIM_SLAVE_ADDRESS, true);
+	for (unsigned i = 0; i < SIM_LEN; i++)
+	{
+		rd[i] = i2c_read(i + 1 == SIM_LEN);
+	}
+	i2c_end();
+	sim_report("read: i2c_read()", sim_cycles() - start, SIM_LEN);
+	failures += memcmp(rd, wr, SIM_LEN) != 0;
+
+	memset(rd, 0, sizeof(rd));
+	start = sim_cycles();
+	failures += i2c_reg_read(SIM_SLAVE_ADDRESS, 0x20, rd, SIM_LEN) != kI2C_STATUS_OK;
+	sim_report("read: i2c_reg_read()", sim_cycles() - start, SIM_LEN);
+	failures += memcmp(rd, wr, SIM_LEN) != 0;
+
+	start = sim_cycles();
+	for (uint8_t address = 0x08; address < 0x78; address++)
+	{
+		found += i2c_scan(address);
+	}
+	sim_report("scan: i2c_scan()", sim_cycles() - start, 0x78 - 0x08);
+	failures += found != 1;
+
+	uint8_t bitmap[16];
+
+	start = sim_cycles();
+	failures += i2c_scan_all(bitmap) != kI2C_STATUS_OK;
+	sim_report("scan: i2c_scan_all()", sim_cycles() - start, 0x78 - 0x08);
+	failures += bitmap[SIM_SLAVE_ADDRESS >> 3] != 1 << (SIM_SLAVE_ADDRESS & 7);
+
+	printf("%s\n", failures == 0 ? "PASS" : "FAIL");
+
+#ifdef CSR_SIM_FINISH_BASE
+	sim_finish_finish_write(1);
+#endif
+
+	return 0;
+}
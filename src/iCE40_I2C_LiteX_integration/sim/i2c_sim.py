@@ -0,0 +1,164 @@
+# 	Copyright (c) 2024, Signaloid.
+#
+# 	Permission is hereby granted, free of charge, to any person obtaining a copy
+# 	of this software and associated documentation files (the "Software"), to
+# 	deal in the Software without restriction, including without limitation the
+# 	rights to use, copy, modify, merge, publish, distribute, sublicense, and/or
+# 	sell copies of the Software, and to permit persons to whom the Software is
+# 	furnished to do so, subject to the following conditions:
+#
+# 	The above copyright notice and this permission notice shall be included in
+# 	all copies or substantial portions of the Software.
+#
+# 	THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+# 	IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+# 	FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+# 	AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+# 	LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+# 	FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER
+# 	DEALINGS IN THE SOFTWARE.
+
+
+
+"""Verilator simulation of an SoC with ICE40UP_I2C and the SB_I2C behavioral model.
+
+Builds a LiteX SoC around ICE40UP_I2C(with_sim_model=True), builds the firmware
+in ``firmware/``, which runs the C driver library against the model, and runs
+the simulation. The firmware reports the system clock cycles per byte for
+writes, reads and scans.
+
+    python3 i2c_sim.py [--with-sb-command] [--with-status-mirror]
+"""
+
+import argparse
+import os
+import subprocess
+
+from litex.build.generic_platform import Pins, Subsignal
+from litex.build.sim import SimPlatform
+from litex.build.sim.config import SimConfig
+from litex.soc.integration.builder import Builder
+from litex.soc.integration.common import get_mem_data
+from litex.soc.integration.soc import SoCRegion
+from litex.soc.integration.soc_core import SoCCore
+from migen.genlib.io import CRG
+
+from iCE40_I2C_LiteX_integration import ICE40UP_I2C
+
+
+_io = [
+    ("sys_clk", 0, Pins(1)),
+    ("sys_rst", 0, Pins(1)),
+    (
+        "serial",
+        0,
+        Subsignal("source_valid", Pins(1)),
+        Subsignal("source_ready", Pins(1)),
+        Subsignal("source_data", Pins(8)),
+        Subsignal("sink_valid", Pins(1)),
+        Subsignal("sink_ready", Pins(1)),
+        Subsignal("sink_data", Pins(8)),
+    ),
+]
+
+
+class Platform(SimPlatform):
+    def __init__(self) -> None:
+        SimPlatform.__init__(self, "SIM", _io)
+
+
+class I2CSimSoC(SoCCore):
+    def __init__(
+        self,
+        sys_clk_freq: int,
+        firmware: str = None,
+        with_sb_command: bool = False,
+        with_status_mirror: bool = False,
+        with_probe: bool = False,
+        with_wishbone: bool = False,
+    ) -> None:
+        platform = Platform()
+
+        SoCCore.__init__(
+            self,
+            platform,
+            sys_clk_freq,
+            ident="iCE40 I2C simulation",
+            uart_name="sim",
+            integrated_rom_size=0x8000,
+            integrated_sram_size=0x2000,
+            integrated_main_ram_size=0x10000,
+            integrated_main_ram_init=(
+                get_mem_data(firmware, endianness="little") if firmware else []
+            ),
+            timer_uptime=True,
+        )
+        self.submodules.crg = CRG(platform.request("sys_clk"))
+
+        #   Boot the firmware from main RAM
+        if firmware:
+            self.add_constant("ROM_BOOT_ADDRESS", self.mem_map["main_ram"])
+
+        #   Lets the firmware end the simulation
+        platform.add_debug(self)
+
+        self.submodules.sb_i2c = ICE40UP_I2C(
+            None,
+            None,
+            self.crg.cd_sys.clk,
+            with_sb_command=with_sb_command,
+            with_status_mirror=with_status_mirror,
+            with_probe=with_probe,
+            with_wishbone=with_wishbone,
+            with_sim_model=True,
+        )
+        if with_wishbone:
+            self.bus.add_slave(
+                "sb_i2c_regs",
+                self.sb_i2c.bus,
+                SoCRegion(origin=0x90000000, size=0x40, cached=False),
+            )
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    parser.add_argument("--sys-clk-freq", type=int, default=48_000_000)
+    parser.add_argument("--with-sb-command", action="store_true")
+    parser.add_argument("--with-status-mirror", action="store_true")
+    parser.add_argument("--with-probe", action="store_true")
+    parser.add_argument("--with-wishbone", action="store_true")
+    parser.add_argument("--output-dir", default="build/i2c_sim")
+    parser.add_argument("--trace", action="store_true", help="Dump a VCD trace")
+    args = parser.parse_args()
+
+    soc_kwargs = dict(
+        sys_clk_freq=args.sys_clk_freq,
+        with_sb_command=args.with_sb_command,
+        with_status_mirror=args.with_status_mirror,
+        with_probe=args.with_probe,
+        with_wishbone=args.with_wishbone,
+    )
+
+    sim_config = SimConfig()
+    sim_config.add_clocker("sys_clk", freq_hz=args.sys_clk_freq)
+    sim_config.add_module("serial2console", "serial")
+
+    #   Generate the software headers and libraries of the SoC
+    soc = I2CSimSoC(**soc_kwargs)
+    builder = Builder(soc, output_dir=args.output_dir)
+    builder.build(sim_config=sim_config, run=False)
+
+    #   Build the firmware against them
+    firmware_dir = os.path.join(os.path.dirname(os.path.abspath(__file__)), "firmware")
+    build_dir = os.path.abspath(args.output_dir)
+    subprocess.check_call(["make", "-C", firmware_dir, f"BUILD_DIR={build_dir}"])
+    firmware = os.path.join(firmware_dir, "firmware.bin")
+
+    #   Run the simulation with the firmware in main RAM
+    soc = I2CSimSoC(firmware=firmware, **soc_kwargs)
+    builder = Builder(soc, output_dir=args.output_dir)
+    builder.build(sim_config=sim_config, trace=args.trace)
+
+
+if __name__ == "__main__":
+    main()